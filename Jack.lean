@@ -5,7 +5,16 @@ import Jack.Main
 import Jack.Error
 import Jack.Types
 import Jack.Address
+import Jack.ByteSlice
 import Jack.Socket
 import Jack.Poll
+import Jack.Drain
+import Jack.PeerTable
+import Jack.RingBuffer
+import Jack.ShmChannel
 import Jack.Options
+import Jack.Cpu
+import Jack.TimerWheel
 import Jack.Async
+import Jack.WriteQueue
+import Jack.ListenerGroup
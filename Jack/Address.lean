@@ -15,21 +15,63 @@ structure IPv4Addr where
 
 namespace IPv4Addr
 
+/-- Convert to 32-bit integer (network byte order) -/
+def toUInt32 (addr : IPv4Addr) : UInt32 :=
+  addr.a.toUInt32 <<< 24 |||
+  addr.b.toUInt32 <<< 16 |||
+  addr.c.toUInt32 <<< 8 |||
+  addr.d.toUInt32
+
+/-- Create from 32-bit integer (network byte order) -/
+def fromUInt32 (n : UInt32) : IPv4Addr :=
+  ⟨(n >>> 24).toUInt8,
+   (n >>> 16 &&& 0xFF).toUInt8,
+   (n >>> 8 &&& 0xFF).toUInt8,
+   (n &&& 0xFF).toUInt8⟩
+
+/-- State of the dotted-decimal scanner: finished octets, the octet being read. -/
+private structure ParseState where
+  acc : UInt32 := 0
+  octet : UInt32 := 0
+  digits : UInt8 := 0
+  dots : UInt8 := 0
+  ok : Bool := true
+
+private def parseStep (st : ParseState) (c : Char) : ParseState :=
+  if !st.ok then st
+  else if c.isDigit then
+    let octet := st.octet * 10 + (c.toNat - '0'.toNat).toUInt32
+    if st.digits ≥ 3 || octet > 255 then { st with ok := false }
+    else { st with octet, digits := st.digits + 1 }
+  else if c == '.' && st.digits > 0 && st.dots < 3 then
+    { st with acc := st.acc <<< 8 ||| st.octet, octet := 0, digits := 0, dots := st.dots + 1 }
+  else { st with ok := false }
+
+/-- Parse "192.168.1.1" straight into its 32-bit form, in one pass over the string. -/
+def parsePacked (s : String) : Option UInt32 :=
+  let st := s.foldl parseStep {}
+  if st.ok && st.dots == 3 && st.digits > 0 then some (st.acc <<< 8 ||| st.octet) else none
+
 /-- Parse an IPv4 address string like "192.168.1.1" -/
-def parse (s : String) : Option IPv4Addr := do
-  let parts := s.splitOn "."
-  if parts.length != 4 then none
-  else
-    let a ← parts[0]?.bind (·.toNat?)
-    let b ← parts[1]?.bind (·.toNat?)
-    let c ← parts[2]?.bind (·.toNat?)
-    let d ← parts[3]?.bind (·.toNat?)
-    if a > 255 || b > 255 || c > 255 || d > 255 then none
-    else some ⟨a.toUInt8, b.toUInt8, c.toUInt8, d.toUInt8⟩
+def parse (s : String) : Option IPv4Addr :=
+  (parsePacked s).map fromUInt32
+
+private def pushOctet (s : String) (n : UInt32) : String :=
+  let digit (d : UInt32) := Char.ofNat ('0'.toNat + d.toNat)
+  let s := if n ≥ 100 then s.push (digit (n / 100)) else s
+  let s := if n ≥ 10 then s.push (digit (n / 10 % 10)) else s
+  s.push (digit (n % 10))
+
+/-- Dotted-decimal form of a 32-bit address. -/
+def formatPacked (n : UInt32) : String :=
+  let s := pushOctet "" (n >>> 24)
+  let s := pushOctet (s.push '.') (n >>> 16 &&& 0xFF)
+  let s := pushOctet (s.push '.') (n >>> 8 &&& 0xFF)
+  pushOctet (s.push '.') (n &&& 0xFF)
 
 /-- Convert to dotted-decimal string -/
 def toString (addr : IPv4Addr) : String :=
-  s!"{addr.a}.{addr.b}.{addr.c}.{addr.d}"
+  formatPacked addr.toUInt32
 
 instance : ToString IPv4Addr := ⟨toString⟩
 
@@ -42,20 +84,6 @@ def loopback : IPv4Addr := ⟨127, 0, 0, 1⟩
 /-- The broadcast address 255.255.255.255 -/
 def broadcast : IPv4Addr := ⟨255, 255, 255, 255⟩
 
-/-- Convert to 32-bit integer (network byte order) -/
-def toUInt32 (addr : IPv4Addr) : UInt32 :=
-  addr.a.toUInt32 <<< 24 |||
-  addr.b.toUInt32 <<< 16 |||
-  addr.c.toUInt32 <<< 8 |||
-  addr.d.toUInt32
-
-/-- Create from 32-bit integer (network byte order) -/
-def fromUInt32 (n : UInt32) : IPv4Addr :=
-  ⟨(n >>> 24).toUInt8,
-   (n >>> 16 &&& 0xFF).toUInt8,
-   (n >>> 8 &&& 0xFF).toUInt8,
-   (n &&& 0xFF).toUInt8⟩
-
 end IPv4Addr
 
 /-- IPv6 address as 16 bytes (network order) -/
@@ -63,23 +91,19 @@ abbrev IPv6Addr := ByteArray
 
 namespace IPv6Addr
 
+/-- Parse an IPv6 literal, with or without brackets. Returns empty bytes on failure. -/
 @[extern "jack_ipv6_parse"]
 opaque parseBytes (s : @& String) : ByteArray
 
-private def stripBrackets (s : String) : String :=
-  match s.toList with
-  | '[' :: rest =>
-    match rest.reverse with
-    | ']' :: innerRev => String.ofList innerRev.reverse
-    | _ => s
-  | _ => s
-
-/-- Parse an IPv6 address string like "::1" or "2001:db8::1". -/
+/-- Parse an IPv6 address string like "::1", "[::1]" or "2001:db8::1". -/
 def parse (s : String) : Option IPv6Addr :=
-  let trimmed := stripBrackets s
-  let bytes := parseBytes trimmed
+  let bytes := parseBytes s
   if bytes.size == 16 then some bytes else none
 
+/-- RFC 5952 text form ("::1", "2001:db8::1"); empty if `addr` is not 16 bytes. -/
+@[extern "jack_ipv6_format"]
+opaque toString (addr : @& IPv6Addr) : String
+
 /-- The "any" address :: (all interfaces). -/
 def any : IPv6Addr := ⟨#[0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0]⟩
 
@@ -88,6 +112,58 @@ def loopback : IPv6Addr := ⟨#[0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 1]
 
 end IPv6Addr
 
+/-- IPv6 address packed into two words (network order: `hi` holds bytes 0-7) plus the
+    zone index of link-local addresses ("fe80::1%2"). No heap bytes, so it compares and
+    hashes as plain scalars. -/
+structure PackedIPv6 where
+  hi : UInt64
+  lo : UInt64
+  scopeId : UInt32 := 0
+  deriving Repr, BEq, Inhabited
+
+namespace PackedIPv6
+
+/-- Parse an IPv6 literal, optionally bracketed and with a "%zone" (index or interface name). -/
+@[extern "jack_ipv6_parse_packed"]
+opaque parse (s : @& String) : Option PackedIPv6
+
+@[extern "jack_ipv6_format_packed"]
+private opaque format (hi lo : UInt64) (scopeId : UInt32) : String
+
+/-- RFC 5952 text form, with "%zone" when `scopeId` is set. -/
+def toString (addr : PackedIPv6) : String := format addr.hi addr.lo addr.scopeId
+
+instance : ToString PackedIPv6 := ⟨toString⟩
+
+private def readBE64 (b : ByteArray) (off : Nat) : UInt64 := Id.run do
+  let mut v : UInt64 := 0
+  for i in [off:off + 8] do
+    v := v <<< 8 ||| b[i]!.toUInt64
+  return v
+
+private def pushBE64 (b : ByteArray) (v : UInt64) : ByteArray := Id.run do
+  let mut out := b
+  for i in [0:8] do
+    out := out.push (v >>> (56 - 8 * i).toUInt64).toUInt8
+  return out
+
+/-- Pack 16 network-order bytes. -/
+def ofBytes? (bytes : IPv6Addr) (scopeId : UInt32 := 0) : Option PackedIPv6 :=
+  if bytes.size == 16 then some { hi := readBE64 bytes 0, lo := readBE64 bytes 8, scopeId }
+  else none
+
+/-- The 16 network-order bytes (the zone index is not part of them). -/
+def toBytes (addr : PackedIPv6) : IPv6Addr :=
+  pushBE64 (pushBE64 ByteArray.empty addr.hi) addr.lo
+
+/-- The "any" address ::. -/
+def any : PackedIPv6 := { hi := 0, lo := 0 }
+
+/-- The loopback address ::1. -/
+def loopback : PackedIPv6 := { hi := 0, lo := 1 }
+
+end PackedIPv6
+
 /-- Socket address (IPv4, IPv6, or Unix domain) -/
 inductive SockAddr where
   | ipv4 (addr : IPv4Addr) (port : UInt16)
@@ -133,12 +209,14 @@ def port : SockAddr → Option UInt16
 /-- Convert to string representation -/
 def toString : SockAddr → String
   | .ipv4 addr port => s!"{addr}:{port}"
-  | .ipv6 _ port => s!"[ipv6]:{port}"
+  | .ipv6 bytes port => s!"[{IPv6Addr.toString bytes}]:{port}"
   | .unix path => s!"unix:{path}"
   | .unixAbstract name => s!"unix:@{name}"
 
 instance : ToString SockAddr := ⟨toString⟩
 
+instance : Inhabited SockAddr := ⟨.ipv4 .any 0⟩
+
 instance : BEq SockAddr where
   beq a b := match a, b with
     | .ipv4 a1 p1, .ipv4 a2 p2 => a1 == a2 && p1 == p2
@@ -147,6 +225,96 @@ instance : BEq SockAddr where
     | .unixAbstract n1, .unixAbstract n2 => n1 == n2
     | _, _ => false
 
+/-- Keyed SipHash-2-4 of the address. The key is random per process, so remote peers
+    cannot choose source addresses that collide. -/
+@[extern "jack_sockaddr_hash"]
+opaque hash (addr : @& SockAddr) : UInt64
+
+instance : Hashable SockAddr := ⟨hash⟩
+
 end SockAddr
 
+/-- IP socket address in packed form: `v4` holds the address as a `UInt32` (network order),
+    `v6` as a `PackedIPv6`. Cheaper than `SockAddr` to store, compare, and use as a map key. -/
+inductive PackedSockAddr where
+  | v4 (addr : UInt32) (port : UInt16)
+  | v6 (addr : PackedIPv6) (port : UInt16)
+  deriving Repr, BEq, Inhabited
+
+namespace PackedSockAddr
+
+/-- Pack an IP socket address; `none` for Unix domain addresses. -/
+def ofSockAddr? : SockAddr → Option PackedSockAddr
+  | .ipv4 addr port => some (.v4 addr.toUInt32 port)
+  | .ipv6 bytes port => (PackedIPv6.ofBytes? bytes).map (.v6 · port)
+  | _ => none
+
+/-- Unpack to a `SockAddr`. `SockAddr` has no zone index, so `scopeId` is dropped. -/
+def toSockAddr : PackedSockAddr → SockAddr
+  | .v4 addr port => .ipv4 (IPv4Addr.fromUInt32 addr) port
+  | .v6 addr port => .ipv6 addr.toBytes port
+
+/-- Parse a numeric IPv4 or IPv6 host (no DNS) with `port`. -/
+def parse (host : String) (port : UInt16) : Option PackedSockAddr :=
+  match IPv4Addr.parsePacked host with
+  | some addr => some (.v4 addr port)
+  | none => (PackedIPv6.parse host).map (.v6 · port)
+
+/-- The port number. -/
+def port : PackedSockAddr → UInt16
+  | .v4 _ p => p
+  | .v6 _ p => p
+
+/-- "1.2.3.4:80" or "[2001:db8::1]:443". -/
+def toString : PackedSockAddr → String
+  | .v4 addr port => s!"{IPv4Addr.formatPacked addr}:{port}"
+  | .v6 addr port => s!"[{addr}]:{port}"
+
+instance : ToString PackedSockAddr := ⟨toString⟩
+
+@[extern "jack_packed_addr_hash_v4"]
+private opaque hashV4 (addr : UInt32) (port : UInt16) : UInt64
+
+@[extern "jack_packed_addr_hash_v6"]
+private opaque hashV6 (hi lo : UInt64) (scopeId : UInt32) (port : UInt16) : UInt64
+
+/-- Same keyed hash as `SockAddr.hash` (with `scopeId` also hashed), computed from the scalars. -/
+def hash : PackedSockAddr → UInt64
+  | .v4 addr port => hashV4 addr port
+  | .v6 addr port => hashV6 addr.hi addr.lo addr.scopeId port
+
+instance : Hashable PackedSockAddr := ⟨hash⟩
+
+end PackedSockAddr
+
+/-- A socket address encoded once into a native `sockaddr`. Sends and connects that take it
+    skip the `SockAddr` conversion (or `inet_pton`) they would otherwise repeat per call. -/
+opaque PreparedAddrPointed : NonemptyType
+def PreparedAddr : Type := PreparedAddrPointed.type
+instance : Nonempty PreparedAddr := PreparedAddrPointed.property
+
+namespace PreparedAddr
+
+/-- Encode `addr`. -/
+@[extern "jack_prepared_addr_of_sockaddr"]
+opaque ofSockAddr (addr : @& SockAddr) : IO PreparedAddr
+
+/-- Parse a numeric IPv4 or IPv6 host (no DNS) and encode it with `port`. -/
+@[extern "jack_prepared_addr_parse"]
+opaque parse (host : @& String) (port : UInt16) : IO PreparedAddr
+
+/-- Decode back into a `SockAddr`. -/
+@[extern "jack_prepared_addr_to_sockaddr"]
+opaque toSockAddr (addr : @& PreparedAddr) : SockAddr
+
+/-- Compare the encoded bytes. -/
+@[extern "jack_prepared_addr_eq"]
+opaque beq (a b : @& PreparedAddr) : Bool
+
+instance : BEq PreparedAddr := ⟨beq⟩
+
+instance : ToString PreparedAddr := ⟨fun a => toString a.toSockAddr⟩
+
+end PreparedAddr
+
 end Jack
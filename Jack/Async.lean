@@ -1,11 +1,12 @@
 /-
   Jack Async Interface
-  Async-friendly API built on non-blocking sockets and Poll.wait.
+  Async-friendly API built on non-blocking sockets and a native epoll/poll reactor core.
 -/
 import Jack.Socket
 import Jack.Poll
+import Jack.TimerWheel
+import Jack.Cpu
 import Std.Data.HashMap
-import Std.Sync.Channel
 import Std.Sync.Mutex
 
 namespace Jack
@@ -16,135 +17,493 @@ namespace Async
 inductive WaitError where
   | canceled
   | shutdown
+  | timedOut
   deriving Repr, BEq, Inhabited
 
+namespace WaitError
+
+/-- The error async operations throw for a failed wait. -/
+def toIOError : WaitError → IO.Error
+  | .canceled => IO.userError "Async wait canceled"
+  | .shutdown => IO.userError "Async manager shut down"
+  | .timedOut => IO.userError "Async wait timed out"
+
+end WaitError
+
 structure CancelHandle where
   cancel : IO Unit
 
+/-- Native state of a composite operation (read exactly, read until, write all)
+    that the reactor advances in C whenever its socket is ready. -/
+opaque IoOpPointed : NonemptyType
+def IoOp : Type := IoOpPointed.type
+instance : Nonempty IoOp := IoOpPointed.property
+
+namespace IoOp
+
+/-- Operation reading exactly `n` bytes. -/
+@[extern "jack_io_op_recv_exact"]
+opaque recvExact (n : UInt32) : IO IoOp
+
+/-- Operation reading through the first `delim`, at most `maxBytes` in total.
+    Peeks before consuming, so no bytes past the delimiter are taken. -/
+@[extern "jack_io_op_recv_until"]
+opaque recvUntil (delim : @& ByteArray) (maxBytes : UInt32) : IO IoOp
+
+/-- Operation writing all of `data`. -/
+@[extern "jack_io_op_send_all"]
+opaque sendAll (data : @& ByteArray) : IO IoOp
+
+/-- Do as much I/O as the socket allows: 0 pending, 1 done, 2 failed. -/
+@[extern "jack_io_op_step"]
+opaque step (op : @& IoOp) (sock : @& Socket) : IO UInt8
+
+/-- Received bytes of a finished operation (empty for sends); throws its failure. -/
+@[extern "jack_io_op_take"]
+opaque take (op : @& IoOp) : IO ByteArray
+
+end IoOp
+
 private structure Waiter where
   socket : Socket
   events : Array PollEvent
+  deadline : Option Nat
   promise : IO.Promise (Except WaitError (Array PollEvent))
+  /-- Composite operation run on readiness; the waiter resolves once it finishes. -/
+  op : Option IoOp := none
+
+/-- What the reactor does when a timer on its wheel expires. -/
+private inductive TimerAction where
+  | expireWaiter (id : UInt64)
+  | fire (promise : IO.Promise (Except WaitError Unit))
 
 private inductive Command where
   | add (id : UInt64) (waiter : Waiter)
   | cancel (id : UInt64)
+  | schedule (id : UInt64) (deadline : Nat) (promise : IO.Promise (Except WaitError Unit))
+  | reschedule (id : UInt64) (deadline : Nat)
+
+/-- Kernel busy-poll settings applied to sockets bound to a reactor. -/
+structure BusyPollConfig where
+  /-- SO_BUSY_POLL in microseconds. -/
+  usec : UInt32 := 50
+  /-- SO_BUSY_POLL_BUDGET; `none` keeps the kernel default. -/
+  budget : Option UInt32 := none
+  /-- SO_PREFER_BUSY_POLL. -/
+  prefer : Bool := true
+  deriving Repr, Inhabited
+
+/-- Apply busy-poll socket options to `sock`. -/
+def BusyPollConfig.apply (cfg : BusyPollConfig) (sock : Socket) : IO Unit := do
+  sock.setBusyPoll cfg.usec
+  if cfg.prefer then
+    sock.setPreferBusyPoll true
+  if let some budget := cfg.budget then
+    sock.setBusyPollBudget budget
+
+/-- Reactor configuration. The defaults give the plain blocking reactor. -/
+structure ReactorConfig where
+  /-- Pin the reactor thread to this CPU (best effort; Linux only). -/
+  cpu : Option Nat := none
+  /-- Userspace spin phase: poll with a zero timeout for up to this many
+      microseconds before blocking. 0 disables spinning. -/
+  spinUs : Nat := 0
+  /-- Busy-poll options applied to sockets bound with `bindSocket`. -/
+  busyPoll : Option BusyPollConfig := none
+  deriving Repr, Inhabited
+
+/-- Reactor counters for tuning the spin phase. -/
+structure ReactorStats where
+  /-- Time spent in the spin phase (nanoseconds). -/
+  spinNs : Nat := 0
+  /-- Zero-timeout polls issued while spinning. -/
+  spinPolls : Nat := 0
+  /-- Ready sockets found while spinning. -/
+  spinEvents : Nat := 0
+  /-- Ready sockets found by blocking polls. -/
+  blockingEvents : Nat := 0
+  deriving Repr, Inhabited
+
+/-- Fraction of events caught during the spin phase (0 when no events were seen). -/
+def ReactorStats.spinHitRatio (s : ReactorStats) : Float :=
+  let total := s.spinEvents + s.blockingEvents
+  if total == 0 then 0.0 else s.spinEvents.toFloat / total.toFloat
+
+/-- Native event loop core: interest registration, the wait call and dispatch run in C
+    (epoll on Linux, poll elsewhere). Ready waiters come back in one batch per wakeup. -/
+opaque ReactorCorePointed : NonemptyType
+def ReactorCore : Type := ReactorCorePointed.type
+instance : Nonempty ReactorCore := ReactorCorePointed.property
+
+namespace ReactorCore
+
+@[extern "jack_reactor_core_new"]
+opaque new : IO ReactorCore
+
+/-- Register a one-shot waiter for `mask` on `sock`, returning its slot. With an `op`,
+    the core steps the operation on readiness and reports the waiter once it finishes. -/
+@[extern "jack_reactor_core_add"]
+opaque add (core : @& ReactorCore) (id : UInt64) (sock : @& Socket) (mask : UInt16)
+    (op : @& Option IoOp) : IO UInt32
+
+/-- Drop a waiter; no-op if it already fired. -/
+@[extern "jack_reactor_core_remove"]
+opaque remove (core : @& ReactorCore) (slot : UInt32) (id : UInt64) : IO Unit
+
+/-- Wait up to `timeoutMs` and return finished waiters as packed `id <<< 16 ||| mask`,
+    plus `woken` if `wake` interrupted the wait. -/
+@[extern "jack_reactor_core_wait"]
+opaque wait (core : @& ReactorCore) (timeoutMs : Int32) : IO (Array UInt64)
+
+/-- Entry `wait` reports for a `wake` call: queued commands need draining. Never a
+    packed waiter (ids do not reach 2^48 - 1). -/
+def woken : UInt64 := 0xFFFFFFFFFFFFFFFF
+
+/-- Number of finished waiters in a `wait` result, not counting `woken`. -/
+def readyCount (ready : Array UInt64) : Nat :=
+  ready.foldl (fun n packed => if packed == woken then n else n + 1) 0
+
+/-- Interrupt a blocked `wait`. Safe from any thread. -/
+@[extern "jack_reactor_core_wake"]
+opaque wake (core : @& ReactorCore) : IO Unit
 
-private structure Manager where
-  chan : Std.CloseableChannel.Sync Command
-  nextId : Std.Mutex UInt64
+end ReactorCore
+
+/-- Native multi-producer, single-consumer queue feeding a reactor thread, with the
+    reactor's atomic id counter. Pushes are a single atomic exchange and never take a lock;
+    the reactor drains everything queued in one call. -/
+opaque CommandQueuePointed : NonemptyType
+def CommandQueue (_α : Type) : Type := CommandQueuePointed.type
+instance {α : Type} : Nonempty (CommandQueue α) := CommandQueuePointed.property
+
+/-- Outcome of `CommandQueue.push`. -/
+inductive PushResult where
+  | queued  -- Added behind items the consumer has not drained yet
+  | first   -- Added to an empty queue: the consumer needs a wakeup
+  | closed  -- The queue is closed; the item may never be drained, so settle it yourself
+  deriving Repr, BEq, Inhabited
+
+namespace CommandQueue
+
+@[extern "jack_cmdq_new"]
+opaque new {α : Type} : IO (CommandQueue α)
+
+/-- Queue `item`. Returns `.first` if the queue was empty, i.e. the consumer needs a wakeup;
+    later pushes in the same batch return `.queued`. Returns `.closed` once the queue is
+    closed, including for a push racing with `close` (which the consumer may or may not
+    have drained). -/
+@[extern "jack_cmdq_push"]
+opaque push {α : Type} (q : @& CommandQueue α) (item : α) : IO PushResult
+
+/-- Take every queued item, oldest first. -/
+@[extern "jack_cmdq_drain"]
+opaque drain {α : Type} (q : @& CommandQueue α) : IO (Array α)
+
+/-- Next id from the queue's counter (starts at 1). -/
+@[extern "jack_cmdq_next_id"]
+opaque nextId {α : Type} (q : @& CommandQueue α) : IO UInt64
+
+/-- Refuse further pushes. The consumer should drain one last time after closing. -/
+@[extern "jack_cmdq_close"]
+opaque close {α : Type} (q : @& CommandQueue α) : IO Unit
+
+end CommandQueue
+
+/-- A reactor: one dedicated thread that polls its sockets and runs its timer wheel. -/
+structure Reactor where
+  config : ReactorConfig
+  commands : CommandQueue Command
+  core : ReactorCore
+  stopping : IO.Ref Bool
+  stats : IO.Ref ReactorStats
   worker : Task (Except IO.Error Unit)
 
-private structure EntryAgg where
-  socket : Socket
-  mask : UInt16
-
-private def mergeMasks (a b : UInt16) : UInt16 :=
-  a ||| b
-
-private def buildEntries (pending : Std.HashMap UInt64 Waiter) : Array PollEntry := Id.run do
-  let mut agg : Std.HashMap UInt32 EntryAgg := {}
-  for (_, waiter) in pending.toList do
-    let fd := waiter.socket.fd
-    let mask := PollEvent.arrayToMask waiter.events
-    match agg.get? fd with
-    | some entry =>
-        agg := agg.insert fd { entry with mask := mergeMasks entry.mask mask }
-    | none =>
-        agg := agg.insert fd { socket := waiter.socket, mask }
-  let mut entries : Array PollEntry := #[]
-  for (_, entry) in agg.toList do
-    entries := entries.push { socket := entry.socket, events := PollEvent.maskToArray entry.mask }
-  return entries
-
-private def handleCommand
-    (pending : Std.HashMap UInt64 Waiter)
-    (cmd : Command) : IO (Std.HashMap UInt64 Waiter) := do
+private structure State where
+  /-- Registered waiters and their slots in the native core. -/
+  pending : Std.HashMap UInt64 (Waiter × UInt32)
+  timers : TimerWheel TimerAction
+
+/-- Upper bound on a single poll when no timer is due sooner. -/
+private def maxPollMs : Nat := 1000
+
+private def handleCommand (core : ReactorCore) (st : State) (cmd : Command) : IO State := do
   match cmd with
   | .add id waiter =>
-      return pending.insert id waiter
+      let slot ← try
+        some <$> core.add id waiter.socket (PollEvent.arrayToMask waiter.events) waiter.op
+      catch _ =>
+        pure none
+      match slot with
+      | none =>
+          -- Closed or invalid descriptor: report it as ready so the caller's retry sees the
+          -- error. An op has already been failed with the errno, which its `take` reports.
+          waiter.promise.resolve (.ok #[.error])
+          return st
+      | some slot =>
+          let timers := match waiter.deadline with
+            | some deadline => st.timers.insert id deadline (.expireWaiter id)
+            | none => st.timers
+          return { pending := st.pending.insert id (waiter, slot), timers }
   | .cancel id =>
-      if let some waiter := pending.get? id then
+      if let some (waiter, slot) := st.pending.get? id then
+        core.remove slot id
         waiter.promise.resolve (.error .canceled)
-      return pending.erase id
-
-private def drainCommands
-    (pending : Std.HashMap UInt64 Waiter)
-    (chan : Std.CloseableChannel.Sync Command) : IO (Std.HashMap UInt64 Waiter) := do
-  let mut pending := pending
-  let mut cmd? ← chan.tryRecv
-  while cmd?.isSome do
-    match cmd? with
-    | some cmd =>
-        pending ← handleCommand pending cmd
-    | none => pure ()
-    cmd? ← chan.tryRecv
-  return pending
-
-private def resolveReady
-    (pending : Std.HashMap UInt64 Waiter)
-    (results : Array PollResult) : IO (Std.HashMap UInt64 Waiter) := do
-  let mut eventMap : Std.HashMap UInt32 UInt16 := {}
-  for res in results do
-    let mask := PollEvent.arrayToMask res.events
-    eventMap := eventMap.insert res.socket.fd mask
-  let mut pending := pending
-  for (id, waiter) in pending.toList do
-    match eventMap.get? waiter.socket.fd with
-    | some mask =>
-        let requested := PollEvent.arrayToMask waiter.events
-        let matched := mask &&& requested
-        if matched != 0 then
-          waiter.promise.resolve (.ok (PollEvent.maskToArray matched))
+      if let some (.fire promise) := st.timers.find? id then
+        promise.resolve (.error .canceled)
+      return { pending := st.pending.erase id, timers := st.timers.cancel id }
+  | .schedule id deadline promise =>
+      return { st with timers := st.timers.insert id deadline (.fire promise) }
+  | .reschedule id deadline =>
+      return { st with timers := st.timers.reschedule id deadline }
+
+private def drainCommands (core : ReactorCore) (st : State) (commands : CommandQueue Command)
+    : IO State := do
+  let mut st := st
+  for cmd in ← commands.drain do
+    st ← handleCommand core st cmd
+  return st
+
+private def fireTimers (core : ReactorCore) (st : State) (nowMs : Nat) : IO State := do
+  let (expired, timers) := st.timers.advance nowMs
+  let mut pending := st.pending
+  for action in expired do
+    match action with
+    | .expireWaiter id =>
+        if let some (waiter, slot) := pending.get? id then
+          core.remove slot id
+          waiter.promise.resolve (.error .timedOut)
           pending := pending.erase id
-    | none => pure ()
-  return pending
+    | .fire promise =>
+        promise.resolve (.ok ())
+  return { pending, timers }
 
-private def resolveAll
-    (pending : Std.HashMap UInt64 Waiter)
-    (err : WaitError) : IO Unit := do
-  for (_, waiter) in pending.toList do
+/-- Resolve a batch of finished waiters (packed `id <<< 16 ||| mask`) from the core. -/
+private def resolveReady (st : State) (ready : Array UInt64) : IO State := do
+  let mut pending := st.pending
+  let mut timers := st.timers
+  for packed in ready do
+    if packed == ReactorCore.woken then
+      continue
+    let id := packed >>> 16
+    if let some (waiter, _) := pending.get? id then
+      waiter.promise.resolve (.ok (PollEvent.maskToArray (packed &&& 0xFFFF).toUInt16))
+      pending := pending.erase id
+      if waiter.deadline.isSome then
+        timers := timers.cancel id
+  return { pending, timers }
+
+private def resolveAll (st : State) (err : WaitError) : IO Unit := do
+  for (_, (waiter, _)) in st.pending.toList do
     waiter.promise.resolve (.error err)
+  for action in st.timers.values do
+    match action with
+    | .fire promise => promise.resolve (.error err)
+    | .expireWaiter _ => pure ()
 
-private partial def managerLoop (chan : Std.CloseableChannel.Sync Command) : IO Unit := do
-  let rec loop (pending : Std.HashMap UInt64 Waiter) : IO Unit := do
-    if pending.isEmpty then
-      let cmd? ← chan.recv
-      match cmd? with
-      | none =>
-          resolveAll pending .shutdown
-          return ()
-      | some cmd =>
-          let pending ← handleCommand pending cmd
-          loop pending
+/-- Poll timeout derived from the timer wheel: block until the next deadline (capped). -/
+private def pollTimeout (timers : TimerWheel TimerAction) (nowMs : Nat) : Int32 :=
+  match timers.nextDeadlineMs? with
+  | some deadline => Int32.ofNat (min (deadline - nowMs) maxPollMs)
+  | none => Int32.ofNat maxPollMs
+
+/-- Spin phase: wait with a zero timeout until something is ready, a `wake` arrives (so
+    new commands are drained at once), or `spinUs` elapses. -/
+private def spinWait (spinUs : Nat) (core : ReactorCore) (stats : IO.Ref ReactorStats)
+    : IO (Array UInt64) := do
+  let start ← IO.monoNanosNow
+  let limit := start + spinUs * 1000
+  let mut polls := 0
+  let mut ready : Array UInt64 := #[]
+  repeat
+    ready ← core.wait 0
+    polls := polls + 1
+    if !ready.isEmpty then
+      break
+    if (← IO.monoNanosNow) ≥ limit then
+      break
+  let spent := (← IO.monoNanosNow) - start
+  let found := ReactorCore.readyCount ready
+  stats.modify fun s => { s with
+    spinNs := s.spinNs + spent
+    spinPolls := s.spinPolls + polls
+    spinEvents := s.spinEvents + found }
+  return ready
+
+private def waitReady (config : ReactorConfig) (core : ReactorCore)
+    (stats : IO.Ref ReactorStats) (timeout : Int32) : IO (Array UInt64) := do
+  if config.spinUs > 0 then
+    let spun ← spinWait config.spinUs core stats
+    if !spun.isEmpty then
+      return spun
+  let ready ← core.wait timeout
+  if config.spinUs > 0 then
+    stats.modify fun s => { s with blockingEvents := s.blockingEvents + ReactorCore.readyCount ready }
+  return ready
+
+private partial def reactorLoop
+    (config : ReactorConfig)
+    (commands : CommandQueue Command)
+    (core : ReactorCore)
+    (stopping : IO.Ref Bool)
+    (stats : IO.Ref ReactorStats) : IO Unit := do
+  if let some cpu := config.cpu then
+    try pinThreadToCpu cpu.toUInt32 catch _ => pure ()
+  let rec loop (st : State) : IO Unit := do
+    if ← stopping.get then
+      let st ← drainCommands core st commands
+      resolveAll st .shutdown
+      return ()
+    let st ← drainCommands core st commands
+    if st.pending.isEmpty && st.timers.isEmpty then
+      -- Idle: the next push onto the empty queue wakes the core.
+      let _ ← core.wait (-1)
+      loop st
     else
-      let pending ← drainCommands pending chan
-      let entries := buildEntries pending
-      let results ← Poll.wait entries 100
-      let pending ← resolveReady pending results
-      loop pending
-  loop {}
-
-private def startManager : IO Manager := do
-  let chan ← Std.CloseableChannel.Sync.new
-  let nextId ← Std.Mutex.new 1
-  let worker ← (managerLoop chan).asTask Task.Priority.dedicated
-  return { chan, nextId, worker }
-
-initialize managerRef : IO.Ref (Option Manager) ← IO.mkRef none
+      let st ← fireTimers core st (← IO.monoMsNow)
+      let ready ← waitReady config core stats (pollTimeout st.timers (← IO.monoMsNow))
+      let st ← resolveReady st ready
+      let st ← fireTimers core st (← IO.monoMsNow)
+      loop st
+  loop { pending := {}, timers := TimerWheel.empty (← IO.monoMsNow) }
+
+namespace Reactor
+
+/-- Start a reactor on its own dedicated thread. -/
+def start (config : ReactorConfig := {}) : IO Reactor := do
+  let commands ← CommandQueue.new
+  let core ← ReactorCore.new
+  let stopping ← IO.mkRef false
+  let stats ← IO.mkRef ({} : ReactorStats)
+  let worker ← (reactorLoop config commands core stopping stats).asTask Task.Priority.dedicated
+  return { config, commands, core, stopping, stats, worker }
+
+/-- CPU this reactor is pinned to, if any. -/
+def cpu (r : Reactor) : Option Nat := r.config.cpu
+
+/-- Snapshot of the reactor's spin-phase counters. Blocking events are only
+    counted when spinning is enabled. -/
+def getStats (r : Reactor) : IO ReactorStats := r.stats.get
+
+private def allocId (r : Reactor) : IO UInt64 :=
+  r.commands.nextId
+
+/-- Queue a command. Only the push that finds the queue empty wakes the reactor; the
+    rest of the batch rides on that wakeup. Returns false if the reactor is stopping and
+    the command may never run. -/
+private def submit (r : Reactor) (cmd : Command) : IO Bool := do
+  match ← r.commands.push cmd with
+  | .first =>
+      r.core.wake
+      return true
+  | .queued => return true
+  | .closed => return false
+
+/-- Stop the reactor thread. Outstanding waits and timers resolve with `WaitError.shutdown`. -/
+def stop (r : Reactor) : IO Unit := do
+  try
+    -- Close before flagging the stop, so the reactor's final drain sees every accepted push.
+    r.commands.close
+    r.stopping.set true
+    r.core.wake
+    let _ ← IO.wait r.worker
+  catch _ =>
+    pure ()
+
+private def addWaiter
+    (r : Reactor)
+    (sock : Socket)
+    (events : Array PollEvent)
+    (deadline : Option Nat)
+    (op : Option IoOp)
+    : IO (Task (Except WaitError (Array PollEvent)) × CancelHandle) := do
+  let id ← r.allocId
+  let promise : IO.Promise (Except WaitError (Array PollEvent)) ← IO.Promise.new
+  let waiter : Waiter := { socket := sock, events, deadline, promise, op }
+  -- Refused once the reactor is stopping (the queue closes first). A push that raced with
+  -- `stop` may also have been drained; resolving twice is harmless.
+  unless ← r.submit (.add id waiter) do
+    promise.resolve (.error .shutdown)
+  let cancel : CancelHandle := {
+    cancel := discard <| r.submit (.cancel id)
+  }
+  return (promise.result!, cancel)
+
+/-- Await events on a socket using this reactor, returning task and cancellation handle. -/
+def awaitEventsCancelable
+    (r : Reactor)
+    (sock : Socket)
+    (events : Array PollEvent)
+    (deadline : Option Nat := none)
+    : IO (Task (Except WaitError (Array PollEvent)) × CancelHandle) :=
+  r.addWaiter sock events deadline none
+
+/-- Hand a composite operation to this reactor: it steps `op` on every readiness
+    report and resolves the task once, when the operation finishes or fails. -/
+def runOpCancelable
+    (r : Reactor)
+    (sock : Socket)
+    (events : Array PollEvent)
+    (op : IoOp)
+    (deadline : Option Nat := none)
+    : IO (Task (Except WaitError (Array PollEvent)) × CancelHandle) :=
+  r.addWaiter sock events deadline (some op)
+
+/-- Start a timer on this reactor's wheel, returning task and cancellation handle. -/
+def sleepCancelable (r : Reactor) (ms : Nat) : IO (Task (Except WaitError Unit) × CancelHandle) := do
+  let id ← r.allocId
+  let promise : IO.Promise (Except WaitError Unit) ← IO.Promise.new
+  unless ← r.submit (.schedule id ((← IO.monoMsNow) + ms) promise) do
+    promise.resolve (.error .shutdown)
+  let cancel : CancelHandle := {
+    cancel := discard <| r.submit (.cancel id)
+  }
+  return (promise.result!, cancel)
+
+end Reactor
+
+initialize managerRef : IO.Ref (Option Reactor) ← IO.mkRef none
 initialize managerMutex : Std.Mutex Unit ← Std.Mutex.new ()
 
-private def getManager : IO Manager := do
+/-- The process-wide default reactor, started on first use. Once published it is read
+    without taking `managerMutex`. -/
+def defaultReactor : IO Reactor := do
+  if let some m ← managerRef.get then
+    return m
   managerMutex.atomically do
     let current ← managerRef.get
     match current with
     | some m => return m
     | none =>
-        let m ← startManager
+        let m ← Reactor.start
         managerRef.set (some m)
         return m
 
-/-- Shutdown the async manager and stop background polling. -/
+@[extern "jack_socket_binding"]
+private opaque socketBinding (sock : @& Socket) : IO (Option Reactor)
+
+@[extern "jack_socket_set_binding"]
+private opaque setSocketBinding (sock : @& Socket) (reactor : Option Reactor) : IO Unit
+
+/-- Route all async waits on `sock` to `reactor`. The binding lives on the socket handle:
+    `Socket.close` (or collecting the socket) releases it, and a later socket that reuses
+    the descriptor does not inherit it. -/
+def bindSocket (sock : Socket) (reactor : Reactor) : IO Unit := do
+  if let some cfg := reactor.config.busyPoll then
+    cfg.apply sock
+  setSocketBinding sock (some reactor)
+
+/-- Drop the reactor binding for `sock` (waits fall back to the default reactor). -/
+def unbindSocket (sock : Socket) : IO Unit :=
+  setSocketBinding sock none
+
+/-- Reactor that serves async waits on `sock`. -/
+def reactorFor (sock : Socket) : IO Reactor := do
+  match ← socketBinding sock with
+  | some r => return r
+  | none => defaultReactor
+
+/-- Shutdown the default reactor and stop background polling.
+    Outstanding waits and timers resolve with `WaitError.shutdown`. -/
 def shutdown : IO Unit := do
   let manager? ← managerMutex.atomically do
     let current ← managerRef.get
@@ -155,111 +514,244 @@ def shutdown : IO Unit := do
         return some m
   match manager? with
   | none => pure ()
-  | some m =>
-      try
-        let _ ← Std.CloseableChannel.Sync.close m.chan
-        let _ := m.worker.get
-        pure ()
-      catch _ =>
-        pure ()
+  | some m => m.stop
+
+/-- Current time on the monotonic clock used for deadlines (milliseconds). -/
+def nowMs : IO Nat := IO.monoMsNow
+
+/-- Absolute deadline `ms` milliseconds from now. -/
+def deadlineIn (ms : Nat) : IO Nat := do
+  return (← IO.monoMsNow) + ms
 
-/-- Await events on a socket, returning task and cancellation handle. -/
+/-- Await events on a socket, returning task and cancellation handle.
+    With a `deadline` (see `deadlineIn`), the task resolves with `WaitError.timedOut`
+    if no requested event arrives in time. Served by the socket's bound reactor. -/
 def awaitEventsCancelable
     (sock : Socket)
     (events : Array PollEvent)
+    (deadline : Option Nat := none)
     : IO (Task (Except WaitError (Array PollEvent)) × CancelHandle) := do
-  let manager ← getManager
-  let id ← manager.nextId.atomically do
-    let current ← get
-    set (current + 1)
-    return current
-  let promise : IO.Promise (Except WaitError (Array PollEvent)) ← IO.Promise.new
-  let waiter : Waiter := { socket := sock, events := events, promise := promise }
-  let _ ← Std.CloseableChannel.Sync.send manager.chan (.add id waiter)
-  let cancel : CancelHandle := {
-    cancel := do
-      let _ ← Std.CloseableChannel.Sync.send manager.chan (.cancel id)
-      pure ()
-  }
-  let task : Task (Except WaitError (Array PollEvent)) := promise.result!
-  return (task, cancel)
+  (← reactorFor sock).awaitEventsCancelable sock events deadline
 
-/-- Await events on a socket. Throws on cancellation/shutdown. -/
-def awaitEvents (sock : Socket) (events : Array PollEvent) : IO (Array PollEvent) := do
-  let (task, _) ← awaitEventsCancelable sock events
+/-- Await events on a socket. Throws on cancellation/shutdown/timeout. -/
+def awaitEvents (sock : Socket) (events : Array PollEvent) (deadline : Option Nat := none)
+    : IO (Array PollEvent) := do
+  let (task, _) ← awaitEventsCancelable sock events deadline
   let result ← IO.wait task
   match result with
   | .ok ev => pure ev
-  | .error .canceled =>
-      throw (IO.userError "Async wait canceled")
-  | .error .shutdown =>
-      throw (IO.userError "Async manager shut down")
+  | .error err => throw err.toIOError
 
 /-- Await readability (includes error/hangup). -/
-def awaitReadable (sock : Socket) : IO (Array PollEvent) :=
-  awaitEvents sock #[.readable, .error, .hangup]
+def awaitReadable (sock : Socket) (deadline : Option Nat := none) : IO (Array PollEvent) :=
+  awaitEvents sock #[.readable, .error, .hangup] deadline
 
 /-- Await writability (includes error/hangup). -/
-def awaitWritable (sock : Socket) : IO (Array PollEvent) :=
-  awaitEvents sock #[.writable, .error, .hangup]
+def awaitWritable (sock : Socket) (deadline : Option Nat := none) : IO (Array PollEvent) :=
+  awaitEvents sock #[.writable, .error, .hangup] deadline
+
+/-- Start a timer on the default reactor's wheel, returning task and cancellation handle. -/
+def sleepCancelable (ms : Nat) : IO (Task (Except WaitError Unit) × CancelHandle) := do
+  (← defaultReactor).sleepCancelable ms
+
+/-- Sleep for `ms` milliseconds using the reactor's timer wheel. -/
+def sleep (ms : Nat) : IO Unit := do
+  let (task, _) ← sleepCancelable ms
+  match ← IO.wait task with
+  | .ok _ => pure ()
+  | .error .shutdown =>
+      throw (IO.userError "Async manager shut down")
+  | .error _ =>
+      throw (IO.userError "Async sleep canceled")
+
+/-- Idle timer: `expired` resolves `timeoutMs` after the most recent `touch`.
+    Re-arming moves the timer on the wheel in O(1), so one per connection is cheap. -/
+structure IdleTimer where
+  timeoutMs : Nat
+  expired : Task (Except WaitError Unit)
+  rearm : Nat → IO Unit
+  cancel : IO Unit
+
+/-- Start an idle timer that expires after `timeoutMs` without a `touch`. -/
+def idleTimer (timeoutMs : Nat) : IO IdleTimer := do
+  let r ← defaultReactor
+  let id ← r.allocId
+  let promise : IO.Promise (Except WaitError Unit) ← IO.Promise.new
+  unless ← r.submit (.schedule id ((← IO.monoMsNow) + timeoutMs) promise) do
+    promise.resolve (.error .shutdown)
+  return {
+    timeoutMs
+    expired := promise.result!
+    rearm := fun deadline => discard <| r.submit (.reschedule id deadline)
+    cancel := discard <| r.submit (.cancel id)
+  }
+
+namespace IdleTimer
+
+/-- Record activity, pushing expiry `timeoutMs` into the future. -/
+def touch (t : IdleTimer) : IO Unit := do
+  t.rearm ((← IO.monoMsNow) + t.timeoutMs)
+
+/-- True once the timer has expired (or was canceled). -/
+def isExpired (t : IdleTimer) : IO Bool :=
+  IO.hasFinished t.expired
+
+end IdleTimer
 
 private def ensureNonBlocking (sock : Socket) : IO Unit :=
   sock.setNonBlocking true
 
 /-- Async receive (waits until readable). -/
-partial def recvAsync (sock : Socket) (maxBytes : UInt32) : IO ByteArray := do
+partial def recvAsync (sock : Socket) (maxBytes : UInt32)
+    (deadline : Option Nat := none) : IO ByteArray := do
   ensureNonBlocking sock
   let rec loop : IO ByteArray := do
     match ← sock.recvTry maxBytes with
     | .ok data => pure data
     | .wouldBlock =>
-        let _ ← awaitReadable sock
+        let _ ← awaitReadable sock deadline
         loop
     | .error err =>
         throw (IO.userError s!"Socket recv error: {err}")
   loop
 
 /-- Async receive from (waits until readable). -/
-partial def recvFromAsync (sock : Socket) (maxBytes : UInt32) : IO (ByteArray × SockAddr) := do
+partial def recvFromAsync (sock : Socket) (maxBytes : UInt32)
+    (deadline : Option Nat := none) : IO (ByteArray × SockAddr) := do
   ensureNonBlocking sock
   let rec loop : IO (ByteArray × SockAddr) := do
     match ← sock.recvFromTry maxBytes with
     | .ok value => pure value
     | .wouldBlock =>
-        let _ ← awaitReadable sock
+        let _ ← awaitReadable sock deadline
+        loop
+    | .error err =>
+        throw (IO.userError s!"Socket recvFrom error: {err}")
+  loop
+
+/-- Async receive of exactly what is queued, at most `cap` bytes (waits until readable). -/
+partial def recvAvailableAsync (sock : Socket) (cap : UInt32 := 1048576)
+    (deadline : Option Nat := none) : IO ByteArray := do
+  ensureNonBlocking sock
+  let rec loop : IO ByteArray := do
+    match ← sock.recvAvailableTry cap with
+    | .ok data => pure data
+    | .wouldBlock =>
+        let _ ← awaitReadable sock deadline
+        loop
+    | .error err =>
+        throw (IO.userError s!"Socket recv error: {err}")
+  loop
+
+/-- Async receive sized by the socket's adaptive hint (see `Socket.recvAdaptiveTry`). -/
+partial def recvAdaptiveAsync (sock : Socket) (cap : UInt32 := 65536)
+    (deadline : Option Nat := none) : IO ByteArray := do
+  ensureNonBlocking sock
+  let rec loop : IO ByteArray := do
+    match ← sock.recvAdaptiveTry cap with
+    | .ok data => pure data
+    | .wouldBlock =>
+        let _ ← awaitReadable sock deadline
+        loop
+    | .error err =>
+        throw (IO.userError s!"Socket recv error: {err}")
+  loop
+
+/-- Async receive of one datagram sized to it (waits until readable). -/
+partial def recvFromExactAsync (sock : Socket) (cap : UInt32 := 65535)
+    (deadline : Option Nat := none) : IO RecvFromExact := do
+  ensureNonBlocking sock
+  let rec loop : IO RecvFromExact := do
+    match ← sock.recvFromExactTry cap with
+    | .ok value => pure value
+    | .wouldBlock =>
+        let _ ← awaitReadable sock deadline
         loop
     | .error err =>
         throw (IO.userError s!"Socket recvFrom error: {err}")
   loop
 
 /-- Async send (waits until writable). Returns bytes sent. -/
-partial def sendAsync (sock : Socket) (data : ByteArray) : IO UInt32 := do
+partial def sendAsync (sock : Socket) (data : ByteArray)
+    (deadline : Option Nat := none) : IO UInt32 := do
   ensureNonBlocking sock
   let rec loop : IO UInt32 := do
     match ← sock.sendTry data with
     | .ok n => pure n
     | .wouldBlock =>
-        let _ ← awaitWritable sock
+        let _ ← awaitWritable sock deadline
         loop
     | .error err =>
         throw (IO.userError s!"Socket send error: {err}")
   loop
 
+/-- Async send of a slice (waits until writable). Returns bytes sent; resume a partial
+    write with `slice.drop n` instead of copying the rest out with `extract`. -/
+partial def sendSliceAsync (sock : Socket) (slice : ByteSlice)
+    (deadline : Option Nat := none) : IO UInt32 := do
+  ensureNonBlocking sock
+  let rec loop : IO UInt32 := do
+    match ← sock.sendSliceTry slice with
+    | .ok n => pure n
+    | .wouldBlock =>
+        let _ ← awaitWritable sock deadline
+        loop
+    | .error err =>
+        throw (IO.userError s!"Socket send error: {err}")
+  loop
+
+/-- Async send of every byte of a slice, resuming partial writes in place. -/
+partial def sendSliceAllAsync (sock : Socket) (slice : ByteSlice)
+    (deadline : Option Nat := none) : IO Unit := do
+  if !slice.isEmpty then
+    let n ← sendSliceAsync sock slice deadline
+    sendSliceAllAsync sock (slice.drop n.toNat) deadline
+
 /-- Async send to address (waits until writable). Returns bytes sent. -/
-partial def sendToAsync (sock : Socket) (data : ByteArray) (addr : SockAddr) : IO UInt32 := do
+partial def sendToAsync (sock : Socket) (data : ByteArray) (addr : SockAddr)
+    (deadline : Option Nat := none) : IO UInt32 := do
   ensureNonBlocking sock
   let rec loop : IO UInt32 := do
     match ← sock.sendToTry data addr with
     | .ok n => pure n
     | .wouldBlock =>
-        let _ ← awaitWritable sock
+        let _ ← awaitWritable sock deadline
+        loop
+    | .error err =>
+        throw (IO.userError s!"Socket sendTo error: {err}")
+  loop
+
+/-- Async send of a slice to an address (waits until writable). Returns bytes sent. -/
+partial def sendToSliceAsync (sock : Socket) (slice : ByteSlice) (addr : SockAddr)
+    (deadline : Option Nat := none) : IO UInt32 := do
+  ensureNonBlocking sock
+  let rec loop : IO UInt32 := do
+    match ← sock.sendToSliceTry slice addr with
+    | .ok n => pure n
+    | .wouldBlock =>
+        let _ ← awaitWritable sock deadline
+        loop
+    | .error err =>
+        throw (IO.userError s!"Socket sendTo error: {err}")
+  loop
+
+/-- Async send to a prepared address (waits until writable). Returns bytes sent. -/
+partial def sendToPreparedAsync (sock : Socket) (data : ByteArray) (addr : PreparedAddr)
+    (deadline : Option Nat := none) : IO UInt32 := do
+  ensureNonBlocking sock
+  let rec loop : IO UInt32 := do
+    match ← sock.sendToPreparedTry data addr with
+    | .ok n => pure n
+    | .wouldBlock =>
+        let _ ← awaitWritable sock deadline
         loop
     | .error err =>
         throw (IO.userError s!"Socket sendTo error: {err}")
   loop
 
 /-- Async accept (waits until readable). -/
-partial def acceptAsync (sock : Socket) : IO Socket := do
+partial def acceptAsync (sock : Socket)
+    (deadline : Option Nat := none) : IO Socket := do
   ensureNonBlocking sock
   let rec loop : IO Socket := do
     match ← sock.acceptTry with
@@ -267,20 +759,21 @@ partial def acceptAsync (sock : Socket) : IO Socket := do
         client.setNonBlocking true
         pure client
     | .wouldBlock =>
-        let _ ← awaitReadable sock
+        let _ ← awaitReadable sock deadline
         loop
     | .error err =>
         throw (IO.userError s!"Socket accept error: {err}")
   loop
 
 /-- Async connect using structured address. -/
-partial def connectAsync (sock : Socket) (addr : SockAddr) : IO Unit := do
+partial def connectAsync (sock : Socket) (addr : SockAddr)
+    (deadline : Option Nat := none) : IO Unit := do
   ensureNonBlocking sock
   let rec loop : IO Unit := do
     match ← sock.connectAddrTry addr with
     | .ok _ => pure ()
     | .wouldBlock =>
-        let _ ← awaitWritable sock
+        let _ ← awaitWritable sock deadline
         match ← sock.getError with
         | none => pure ()
         | some err =>
@@ -290,13 +783,14 @@ partial def connectAsync (sock : Socket) (addr : SockAddr) : IO Unit := do
   loop
 
 /-- Async connect using string host/port. -/
-partial def connectAsyncHost (sock : Socket) (host : String) (port : UInt16) : IO Unit := do
+partial def connectAsyncHost (sock : Socket) (host : String) (port : UInt16)
+    (deadline : Option Nat := none) : IO Unit := do
   ensureNonBlocking sock
   let rec loop : IO Unit := do
     match ← sock.connectTry host port with
     | .ok _ => pure ()
     | .wouldBlock =>
-        let _ ← awaitWritable sock
+        let _ ← awaitWritable sock deadline
         match ← sock.getError with
         | none => pure ()
         | some err =>
@@ -305,6 +799,235 @@ partial def connectAsyncHost (sock : Socket) (host : String) (port : UInt16) : I
         throw (IO.userError s!"Socket connect error: {err}")
   loop
 
+/-- Async TCP Fast Open connect: sends `data` in the SYN when a cookie is cached,
+    otherwise after the handshake. Returns once the connection is established and
+    all of `data` has been handed to the kernel. -/
+partial def connectWithDataAsync (sock : Socket) (addr : SockAddr) (data : ByteArray)
+    (deadline : Option Nat := none) : IO Unit := do
+  ensureNonBlocking sock
+  let sent ← match ← sock.connectWithDataTry addr data with
+    | .ok n => pure n.toNat
+    | .wouldBlock => pure 0
+    | .error err => throw (IO.userError s!"Socket connect error: {err}")
+  let _ ← awaitWritable sock deadline
+  match ← sock.getError with
+  | some err => throw (IO.userError s!"Socket connect error: {err}")
+  | none => pure ()
+  sendSliceAllAsync sock (ByteSlice.ofRange data sent) deadline
+
+/-- Result of a task-returning async operation. -/
+abbrev AsyncTask (α : Type) := Task (Except IO.Error α)
+
+/-- Try `attempt` now; while it would block (`none`), wait for `events` on the reactor and
+    retry from a continuation attached with `IO.bindTask`. No thread is parked in between,
+    so in-flight operations cost memory only. -/
+private partial def retryTask (sock : Socket) (events : Array PollEvent) (deadline : Option Nat)
+    (attempt : IO (Option α)) : IO (AsyncTask α) := do
+  match ← attempt with
+  | some value => return Task.pure (.ok value)
+  | none =>
+      let (wait, _) ← awaitEventsCancelable sock events deadline
+      IO.bindTask wait fun
+        | .ok _ => retryTask sock events deadline attempt
+        | .error err => pure (Task.pure (.error err.toIOError))
+
+/-- Run `start`, reporting a synchronous failure through the returned task. -/
+private def spawnTask (start : IO (AsyncTask α)) : IO (AsyncTask α) := do
+  try start catch e => return Task.pure (.error e)
+
+private def readableEvents : Array PollEvent := #[.readable, .error, .hangup]
+private def writableEvents : Array PollEvent := #[.writable, .error, .hangup]
+
+/-- Receive as a task: resolves when data (or EOF, as empty) arrives. -/
+def recvTask (sock : Socket) (maxBytes : UInt32) (deadline : Option Nat := none)
+    : IO (AsyncTask ByteArray) := spawnTask do
+  ensureNonBlocking sock
+  retryTask sock readableEvents deadline do
+    match ← sock.recvTry maxBytes with
+    | .ok data => pure (some data)
+    | .wouldBlock => pure none
+    | .error err => throw (IO.userError s!"Socket recv error: {err}")
+
+/-- Receive a datagram and its sender as a task. -/
+def recvFromTask (sock : Socket) (maxBytes : UInt32) (deadline : Option Nat := none)
+    : IO (AsyncTask (ByteArray × SockAddr)) := spawnTask do
+  ensureNonBlocking sock
+  retryTask sock readableEvents deadline do
+    match ← sock.recvFromTry maxBytes with
+    | .ok value => pure (some value)
+    | .wouldBlock => pure none
+    | .error err => throw (IO.userError s!"Socket recvFrom error: {err}")
+
+/-- Receive as a task with a buffer sized by the socket's adaptive hint. -/
+def recvAdaptiveTask (sock : Socket) (cap : UInt32 := 65536) (deadline : Option Nat := none)
+    : IO (AsyncTask ByteArray) := spawnTask do
+  ensureNonBlocking sock
+  retryTask sock readableEvents deadline do
+    match ← sock.recvAdaptiveTry cap with
+    | .ok data => pure (some data)
+    | .wouldBlock => pure none
+    | .error err => throw (IO.userError s!"Socket recv error: {err}")
+
+/-- Send as a task; resolves with the number of bytes the kernel accepted. -/
+def sendTask (sock : Socket) (data : ByteArray) (deadline : Option Nat := none)
+    : IO (AsyncTask UInt32) := spawnTask do
+  ensureNonBlocking sock
+  retryTask sock writableEvents deadline do
+    match ← sock.sendTry data with
+    | .ok n => pure (some n)
+    | .wouldBlock => pure none
+    | .error err => throw (IO.userError s!"Socket send error: {err}")
+
+/-- Send a datagram to `addr` as a task. -/
+def sendToTask (sock : Socket) (data : ByteArray) (addr : SockAddr) (deadline : Option Nat := none)
+    : IO (AsyncTask UInt32) := spawnTask do
+  ensureNonBlocking sock
+  retryTask sock writableEvents deadline do
+    match ← sock.sendToTry data addr with
+    | .ok n => pure (some n)
+    | .wouldBlock => pure none
+    | .error err => throw (IO.userError s!"Socket sendTo error: {err}")
+
+/-- Send a slice as a task; resolves with the number of bytes the kernel accepted. -/
+def sendSliceTask (sock : Socket) (slice : ByteSlice) (deadline : Option Nat := none)
+    : IO (AsyncTask UInt32) := spawnTask do
+  ensureNonBlocking sock
+  retryTask sock writableEvents deadline do
+    match ← sock.sendSliceTry slice with
+    | .ok n => pure (some n)
+    | .wouldBlock => pure none
+    | .error err => throw (IO.userError s!"Socket send error: {err}")
+
+/-- Accept as a task; the client is non-blocking. -/
+def acceptTask (sock : Socket) (deadline : Option Nat := none) : IO (AsyncTask Socket) := spawnTask do
+  ensureNonBlocking sock
+  retryTask sock readableEvents deadline do
+    match ← sock.acceptTry with
+    | .ok client =>
+        client.setNonBlocking true
+        pure (some client)
+    | .wouldBlock => pure none
+    | .error err => throw (IO.userError s!"Socket accept error: {err}")
+
+/-- Connect as a task; resolves once the handshake completes. -/
+def connectTask (sock : Socket) (addr : SockAddr) (deadline : Option Nat := none)
+    : IO (AsyncTask Unit) := spawnTask do
+  ensureNonBlocking sock
+  match ← sock.connectAddrTry addr with
+  | .ok _ => return Task.pure (.ok ())
+  | .error err => throw (IO.userError s!"Socket connect error: {err}")
+  | .wouldBlock =>
+      let (wait, _) ← awaitEventsCancelable sock writableEvents deadline
+      IO.bindTask wait fun
+        | .ok _ => do
+            match ← sock.getError with
+            | none => return Task.pure (.ok ())
+            | some err => throw (IO.userError s!"Socket connect error: {err}")
+        | .error err => pure (Task.pure (.error err.toIOError))
+
+/-- Run a composite operation: one attempt on the calling thread, then on the reactor. -/
+private def opTask (sock : Socket) (events : Array PollEvent) (op : IoOp) (deadline : Option Nat)
+    : IO (AsyncTask ByteArray) := spawnTask do
+  ensureNonBlocking sock
+  if (← op.step sock) != 0 then
+    return Task.pure (.ok (← op.take))
+  let (wait, _) ← (← reactorFor sock).runOpCancelable sock events op deadline
+  IO.mapTask (t := wait) fun
+    | .ok _ => op.take
+    | .error err => throw err.toIOError
+
+/-- Byte count for a native operation, which takes a `UInt32`; larger sizes would wrap. -/
+private def opSize (what : String) (n : Nat) : IO UInt32 := do
+  if n ≥ UInt32.size then
+    throw (IO.userError s!"{what}: {n} bytes exceeds the 4 GiB operation limit")
+  return n.toUInt32
+
+/-- Read exactly `n` bytes as a task. The reactor keeps reading natively while the socket
+    is ready and resolves once; EOF first fails the task. `n` must be below 2^32. -/
+def recvExactTask (sock : Socket) (n : Nat) (deadline : Option Nat := none)
+    : IO (AsyncTask ByteArray) := spawnTask do
+  opTask sock readableEvents (← IoOp.recvExact (← opSize "recvExact" n)) deadline
+
+/-- Read through the first occurrence of `delim` (included in the result) as a task.
+    Fails if `maxBytes` arrive without it. `maxBytes` must be below 2^32. -/
+def recvUntilTask (sock : Socket) (delim : ByteArray) (maxBytes : Nat := 65536)
+    (deadline : Option Nat := none) : IO (AsyncTask ByteArray) := spawnTask do
+  opTask sock readableEvents (← IoOp.recvUntil delim (← opSize "recvUntil" maxBytes)) deadline
+
+/-- Write all of `data` as a task, run natively by the reactor. -/
+def sendAllTask (sock : Socket) (data : ByteArray) (deadline : Option Nat := none)
+    : IO (AsyncTask Unit) := spawnTask do
+  let task ← opTask sock writableEvents (← IoOp.sendAll data) deadline
+  IO.mapTask (t := task) fun r => do
+    let _ ← IO.ofExcept r
+
+/-- Read exactly `n` bytes (see `recvExactTask`). -/
+def recvExact (sock : Socket) (n : Nat) (deadline : Option Nat := none) : IO ByteArray := do
+  IO.ofExcept (← IO.wait (← recvExactTask sock n deadline))
+
+/-- Read through `delim`, inclusive (see `recvUntilTask`). -/
+def recvUntil (sock : Socket) (delim : ByteArray) (maxBytes : Nat := 65536)
+    (deadline : Option Nat := none) : IO ByteArray := do
+  IO.ofExcept (← IO.wait (← recvUntilTask sock delim maxBytes deadline))
+
+/-- Write all of `data`, unlike `sendAsync` which returns after a partial write. -/
+def sendAllAsync (sock : Socket) (data : ByteArray) (deadline : Option Nat := none) : IO Unit := do
+  IO.ofExcept (← IO.wait (← sendAllTask sock data deadline))
+
+/-- A set of CPU-pinned reactors. Accepted sockets are bound to the reactor on the
+    CPU that handles their RX softirq (`SO_INCOMING_CPU`), so kernel and user-space
+    processing of a flow stay on one core. -/
+structure ReactorPool where
+  reactors : Array Reactor
+
+namespace ReactorPool
+
+/-- Start `size` reactors (0 = one per CPU); with `pin`, reactor `i` is pinned to CPU `i`.
+    Every reactor uses `config` apart from its CPU. -/
+def start (size : Nat := 0) (pin : Bool := true) (config : ReactorConfig := {}) : IO ReactorPool := do
+  let size ← if size == 0 then do
+      pure (← cpuCount).toNat
+    else
+      pure size
+  let mut reactors := #[]
+  for i in [0:size] do
+    reactors := reactors.push (← Reactor.start { config with cpu := if pin then some i else none })
+  return { reactors }
+
+/-- Reactor for a CPU: the one pinned to it, else `cpu % size`. -/
+def forCpu (pool : ReactorPool) (cpu : Nat) : Option Reactor :=
+  match pool.reactors.find? (·.cpu == some cpu) with
+  | some r => some r
+  | none =>
+      if pool.reactors.isEmpty then none
+      else pool.reactors[cpu % pool.reactors.size]?
+
+/-- Bind `sock` to the reactor on its incoming CPU and return that reactor.
+    Falls back to reactor 0 when the kernel has not recorded a CPU. -/
+def route (pool : ReactorPool) (sock : Socket) : IO Reactor := do
+  let cpu ← try
+    pure ((← sock.getIncomingCpu).map (·.toNat))
+  catch _ =>
+    pure none
+  match pool.forCpu (cpu.getD 0) with
+  | some r =>
+      bindSocket sock r
+      return r
+  | none => defaultReactor
+
+/-- Async accept that routes the new connection to its incoming-CPU reactor. -/
+def acceptAsync (pool : ReactorPool) (listener : Socket) (deadline : Option Nat := none) : IO Socket := do
+  let client ← Async.acceptAsync listener deadline
+  let _ ← pool.route client
+  return client
+
+/-- Stop every reactor in the pool. -/
+def stop (pool : ReactorPool) : IO Unit := do
+  for r in pool.reactors do
+    r.stop
+
+end ReactorPool
+
 end Async
 
 end Jack
@@ -0,0 +1,48 @@
+/-
+  Jack Byte Slices
+  Views into a ByteArray that the send family accepts without copying.
+-/
+
+namespace Jack
+
+/-- `size` bytes of `data` starting at `offset`. Sending a slice hands the kernel a pointer
+    into `data`, so resuming after a partial write needs no `extract`.
+    The FFI clamps out-of-range views to the array. -/
+structure ByteSlice where
+  data : ByteArray
+  offset : Nat
+  size : Nat
+
+namespace ByteSlice
+
+/-- The whole array. -/
+def ofByteArray (data : ByteArray) : ByteSlice := { data, offset := 0, size := data.size }
+
+/-- `size` bytes of `data` from `offset`, clamped to the array. -/
+def ofRange (data : ByteArray) (offset : Nat) (size : Nat := data.size) : ByteSlice :=
+  let offset := min offset data.size
+  { data, offset, size := min size (data.size - offset) }
+
+instance : Coe ByteArray ByteSlice := ⟨ofByteArray⟩
+
+instance : Inhabited ByteSlice := ⟨ofByteArray ByteArray.empty⟩
+
+/-- Index one past the last byte of the view. -/
+def stop (s : ByteSlice) : Nat := s.offset + s.size
+
+def isEmpty (s : ByteSlice) : Bool := s.size == 0
+
+/-- Drop the first `n` bytes (e.g. those a partial send wrote). -/
+def drop (s : ByteSlice) (n : Nat) : ByteSlice :=
+  let n := min n s.size
+  { s with offset := s.offset + n, size := s.size - n }
+
+/-- Keep at most the first `n` bytes. -/
+def take (s : ByteSlice) (n : Nat) : ByteSlice := { s with size := min n s.size }
+
+/-- Copy the viewed bytes into a fresh array. -/
+def toByteArray (s : ByteSlice) : ByteArray := s.data.extract s.offset s.stop
+
+end ByteSlice
+
+end Jack
@@ -0,0 +1,21 @@
+/-
+  Jack CPU Affinity
+  CPU topology queries and thread pinning for reactor threads.
+-/
+
+namespace Jack
+
+/-- Number of online CPUs (at least 1). -/
+@[extern "jack_cpu_count"]
+opaque cpuCount : IO UInt32
+
+/-- CPU the calling thread is currently running on (Linux only). -/
+@[extern "jack_current_cpu"]
+opaque currentCpu : IO UInt32
+
+/-- Pin the calling OS thread to a single CPU (Linux only).
+    Only meaningful on threads that stay put, such as `Task.Priority.dedicated` workers. -/
+@[extern "jack_pin_thread_cpu"]
+opaque pinThreadToCpu (cpu : UInt32) : IO Unit
+
+end Jack
@@ -0,0 +1,66 @@
+/-
+  Jack Drain Operations
+  Native read/accept/write loops that run until EAGAIN, for edge-triggered readiness.
+-/
+import Jack.Socket
+
+namespace Jack
+
+/-- Result of `Socket.recvDrain`. -/
+structure RecvDrain where
+  /-- Everything read, concatenated (stream sockets). -/
+  data : ByteArray
+  /-- True if the budget ran out (or an error was deferred) before EAGAIN. -/
+  stillReady : Bool
+  /-- True if the peer closed the connection. -/
+  eof : Bool
+
+/-- Result of `Socket.acceptDrain`. -/
+structure AcceptDrain where
+  /-- Accepted connections, already non-blocking. -/
+  sockets : Array Socket
+  /-- True if the budget ran out (or an error was deferred) before EAGAIN. -/
+  stillReady : Bool
+
+/-- Result of `Socket.sendDrain`. Scalar fields only, declared by size. -/
+structure SendDrain where
+  /-- Bytes written by this call. -/
+  bytes : UInt64
+  /-- Queue entries written completely. -/
+  chunksSent : UInt32
+  /-- Bytes already written from the next unfinished entry. -/
+  offset : UInt32
+  /-- True if the queue or budget ran out before EAGAIN. -/
+  stillReady : Bool
+  deriving Repr, BEq, Inhabited
+
+namespace Socket
+
+/-- Receive until EAGAIN, EOF or `maxBytes` in one FFI call, into one buffer.
+    An error after some data was read is reported by the next call. -/
+@[extern "jack_socket_recv_drain"]
+opaque recvDrain (sock : @& Socket) (maxBytes : UInt32) : IO RecvDrain
+
+/-- Accept until EAGAIN or `maxCount` connections in one FFI call. -/
+@[extern "jack_socket_accept_drain"]
+opaque acceptDrain (sock : @& Socket) (maxCount : UInt32) : IO AcceptDrain
+
+/-- Write queued chunks with `writev` until EAGAIN, the queue empties or `maxBytes`.
+    `offset` is how much of `queue[0]` an earlier call already wrote. -/
+@[extern "jack_socket_send_drain"]
+opaque sendDrain (sock : @& Socket) (queue : @& Array ByteArray) (offset : UInt32 := 0)
+    (maxBytes : UInt64 := 0xFFFFFFFFFFFFFFFF) : IO SendDrain
+
+end Socket
+
+namespace SendDrain
+
+/-- Queue left to send after a drain: drops finished chunks and trims the next one. -/
+def remaining (r : SendDrain) (queue : Array ByteArray) : Array ByteArray :=
+  let rest := queue.extract r.chunksSent.toNat queue.size
+  if r.offset == 0 then rest
+  else rest.modify 0 fun chunk => chunk.extract r.offset.toNat chunk.size
+
+end SendDrain
+
+end Jack
@@ -0,0 +1,182 @@
+/-
+  Jack Listener Groups
+  SO_REUSEPORT listener groups with one accept loop per listener.
+-/
+import Jack.Socket
+import Jack.Cpu
+
+namespace Jack
+
+namespace Socket
+
+/-- Attach an SO_ATTACH_REUSEPORT_CBPF program that steers each flow to group member
+    `cpu % groupSize`, i.e. the listener owned by the CPU that received it.
+    The program applies to the whole SO_REUSEPORT group (Linux only). -/
+@[extern "jack_socket_attach_reuseport_cpu_bpf"]
+opaque attachReusePortCpuSteering (sock : @& Socket) (groupSize : UInt32) : IO Unit
+
+end Socket
+
+/-- How a listener group spreads incoming work across its loops. -/
+inductive ListenerMode where
+  | reusePort  -- One SO_REUSEPORT socket per loop; the kernel balances flows
+  | shared     -- One socket shared by all loops; blocking accept wakes a single loop
+  deriving Repr, BEq, Inhabited
+
+/-- Listener group configuration. -/
+structure ListenerGroupConfig where
+  /-- Number of loops (and sockets in `reusePort` mode). 0 means one per CPU. -/
+  size : Nat := 0
+  sockType : SocketType := .stream
+  mode : ListenerMode := .reusePort
+  backlog : UInt32 := 128
+  /-- Attach the CPU-steering BPF program (`reusePort` mode only). -/
+  cpuSteering : Bool := false
+  /-- Receive timeout used by loops to notice `stop` (ms). -/
+  pollIntervalMs : UInt32 := 250
+  deriving Repr, Inhabited
+
+/-- A set of listeners bound to the same address. -/
+structure ListenerGroup where
+  /-- Bound address (with the port resolved when binding to port 0). -/
+  addr : SockAddr
+  sockType : SocketType
+  mode : ListenerMode
+  /-- Distinct sockets: one per loop in `reusePort` mode, a single one in `shared` mode. -/
+  sockets : Array Socket
+  /-- Number of loops `serve` starts. -/
+  loops : Nat
+  stopping : IO.Ref Bool
+
+namespace ListenerGroup
+
+private def familyOf : SockAddr → Option AddressFamily
+  | .ipv4 _ _ => some .inet
+  | .ipv6 _ _ => some .inet6
+  | _ => none
+
+/-- Create a listener group bound to `addr` (TCP or UDP).
+    With `cpuSteering`, flows are steered to listener `cpu % size`, so pairing listener `i`
+    with CPU `i` keeps each connection on the core that received it. -/
+def create (addr : SockAddr) (config : ListenerGroupConfig := {}) : IO ListenerGroup := do
+  let family ← match familyOf addr with
+    | some f => pure f
+    | none => throw (IO.userError "ListenerGroup requires an IPv4 or IPv6 address")
+  let loops ← if config.size == 0 then do
+      pure (← cpuCount).toNat
+    else
+      pure config.size
+  let count := if config.mode == .shared then 1 else loops
+  let protocol := if config.sockType == .stream then Protocol.tcp else Protocol.udp
+  let created ← IO.mkRef (#[] : Array Socket)
+  try
+    let mut bound := addr
+    for _ in [0:count] do
+      let sock ← Socket.create family config.sockType protocol
+      created.modify (·.push sock)
+      if config.mode == .reusePort then
+        sock.setReusePort true
+      sock.setRecvTimeoutMs config.pollIntervalMs
+      sock.bindAddr bound
+      -- Later members must bind the port the kernel picked for the first one.
+      bound ← sock.getLocalAddr
+      if config.sockType == .stream then
+        sock.listen config.backlog
+    let sockets ← created.get
+    if config.cpuSteering && config.mode == .reusePort then
+      if let some first := sockets[0]? then
+        first.attachReusePortCpuSteering count.toUInt32
+    let stopping ← IO.mkRef false
+    return { addr := bound, sockType := config.sockType, mode := config.mode, sockets, loops, stopping }
+  catch e =>
+    for sock in (← created.get) do
+      sock.close
+    throw e
+
+/-- Socket served by loop `idx`. -/
+def socketFor (g : ListenerGroup) (idx : Nat) : Option Socket :=
+  if g.sockets.isEmpty then none else g.sockets[idx % g.sockets.size]?
+
+private def isTransient : SocketError → Bool
+  | .connectionAborted => true
+  | .interrupted => true
+  | .timedOut => true
+  | _ => false
+
+/-- Accept loop for one listener. Runs until `stop`; handler errors are dropped. -/
+partial def acceptLoop (g : ListenerGroup) (idx : Nat) (handler : Nat → Socket → IO Unit) : IO Unit := do
+  let some sock := g.socketFor idx
+    | throw (IO.userError "ListenerGroup has no sockets")
+  let rec loop : IO Unit := do
+    if ← g.stopping.get then
+      return ()
+    match ← sock.acceptTry with
+    | .ok client =>
+        try handler idx client catch _ => pure ()
+        loop
+    | .wouldBlock => loop
+    | .error err =>
+        if ← g.stopping.get then
+          return ()
+        if isTransient err then
+          loop
+        else
+          throw (IO.userError s!"Socket accept error: {err}")
+  loop
+
+/-- Receive loop for one datagram listener. Runs until `stop`; handler errors are dropped. -/
+partial def recvLoop (g : ListenerGroup) (idx : Nat) (maxBytes : UInt32)
+    (handler : Nat → Socket → ByteArray → SockAddr → IO Unit) : IO Unit := do
+  let some sock := g.socketFor idx
+    | throw (IO.userError "ListenerGroup has no sockets")
+  let rec loop : IO Unit := do
+    if ← g.stopping.get then
+      return ()
+    match ← sock.recvFromTry maxBytes with
+    | .ok (data, from_) =>
+        if data.size == 0 && (← g.stopping.get) then
+          return ()
+        try handler idx sock data from_ catch _ => pure ()
+        loop
+    | .wouldBlock => loop
+    | .error err =>
+        if ← g.stopping.get then
+          return ()
+        if isTransient err then
+          loop
+        else
+          throw (IO.userError s!"Socket recvFrom error: {err}")
+  loop
+
+/-- Start one accept loop per listener, each on its own dedicated thread.
+    `handler` receives the loop index and the accepted client. -/
+def serve (g : ListenerGroup) (handler : Nat → Socket → IO Unit)
+    : IO (Array (Task (Except IO.Error Unit))) := do
+  let mut tasks := #[]
+  for idx in [0:g.loops] do
+    tasks := tasks.push (← (g.acceptLoop idx handler).asTask Task.Priority.dedicated)
+  return tasks
+
+/-- Start one receive loop per datagram listener, each on its own dedicated thread. -/
+def serveDatagrams (g : ListenerGroup) (maxBytes : UInt32)
+    (handler : Nat → Socket → ByteArray → SockAddr → IO Unit)
+    : IO (Array (Task (Except IO.Error Unit))) := do
+  let mut tasks := #[]
+  for idx in [0:g.loops] do
+    tasks := tasks.push (← (g.recvLoop idx maxBytes handler).asTask Task.Priority.dedicated)
+  return tasks
+
+/-- Stop all loops, wait for them, and close the group's sockets. -/
+def stop (g : ListenerGroup) (tasks : Array (Task (Except IO.Error Unit)) := #[]) : IO Unit := do
+  g.stopping.set true
+  -- Shutting down the read side wakes loops blocked in accept/recv immediately.
+  for sock in g.sockets do
+    try sock.shutdown .read catch _ => pure ()
+  for task in tasks do
+    let _ ← IO.wait task
+  for sock in g.sockets do
+    sock.close
+
+end ListenerGroup
+
+end Jack
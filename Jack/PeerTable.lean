@@ -0,0 +1,79 @@
+/-
+  Jack Peer Table
+  Native peer-address demultiplexing for datagram servers.
+-/
+import Jack.Socket
+
+namespace Jack
+
+/-- Native hash table from IP peer address to session index, keyed with the same
+    SipHash as `SockAddr.hash`. `Socket.recvFromMany` looks senders up in it while
+    receiving, so known peers come back as session indices. Not thread-safe. -/
+opaque PeerTablePointed : NonemptyType
+def PeerTable : Type := PeerTablePointed.type
+instance : Nonempty PeerTable := PeerTablePointed.property
+
+namespace PeerTable
+
+/-- Create a table sized for about `capacity` peers (it grows as needed). -/
+@[extern "jack_peer_table_new"]
+opaque new (capacity : UInt32 := 0) : IO PeerTable
+
+/-- Map `peer` to `session`, replacing any previous mapping. Throws for Unix addresses. -/
+@[extern "jack_peer_table_insert"]
+opaque insert (table : @& PeerTable) (peer : @& SockAddr) (session : UInt32) : IO Unit
+
+/-- Session index of `peer`, if mapped. -/
+@[extern "jack_peer_table_find"]
+opaque find? (table : @& PeerTable) (peer : @& SockAddr) : IO (Option UInt32)
+
+/-- Remove `peer`; returns true if it was mapped. -/
+@[extern "jack_peer_table_erase"]
+opaque erase (table : @& PeerTable) (peer : @& SockAddr) : IO Bool
+
+/-- Number of mapped peers. -/
+@[extern "jack_peer_table_size"]
+opaque size (table : @& PeerTable) : IO Nat
+
+end PeerTable
+
+/-- A datagram from `Socket.recvFromMany`. Senders already in the table come back as their
+    session index, without building a `SockAddr`. `truncated` is set when the datagram was
+    longer than `maxBytes` and `data` holds only its first `maxBytes` bytes. -/
+inductive PeerDatagram where
+  | known (session : UInt32) (data : ByteArray) (truncated : Bool)
+  | unknown (peer : SockAddr) (data : ByteArray) (truncated : Bool)
+  deriving Inhabited
+
+namespace PeerDatagram
+
+/-- The payload. -/
+def data : PeerDatagram → ByteArray
+  | .known _ d _ => d
+  | .unknown _ d _ => d
+
+/-- The datagram did not fit in `maxBytes` and was cut. -/
+def truncated : PeerDatagram → Bool
+  | .known _ _ t => t
+  | .unknown _ _ t => t
+
+end PeerDatagram
+
+namespace Socket
+
+/-- Receive up to `maxMessages` datagrams of at most `maxBytes` each in one call
+    (`recvmmsg` on Linux), resolving each sender through `table`. Blocks for the first
+    datagram on a blocking socket, then returns whatever else is already queued. -/
+@[extern "jack_socket_recv_from_many"]
+opaque recvFromMany (sock : @& Socket) (table : @& PeerTable) (maxMessages : UInt32) (maxBytes : UInt32)
+    : IO (Array PeerDatagram)
+
+/-- Non-blocking `recvFromMany` (MSG_DONTWAIT, even on a blocking socket):
+    `.wouldBlock` if nothing is queued. -/
+@[extern "jack_socket_recv_from_many_try"]
+opaque recvFromManyTry (sock : @& Socket) (table : @& PeerTable) (maxMessages : UInt32) (maxBytes : UInt32)
+    : IO (SocketResult (Array PeerDatagram))
+
+end Socket
+
+end Jack
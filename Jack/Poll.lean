@@ -75,6 +75,13 @@ def connectAddrWithTimeout (sock : Socket) (addr : SockAddr) (timeoutMs : Int32)
       | none => pure (some ())
       | some err => throw (IO.userError s!"Socket connect error: {err}")
 
+/-- Open a TCP (or Unix stream) connection to every address at once, in one call: every
+    connect is started non-blocking, all of them wait on one poll set, and each result is
+    read from SO_ERROR. Results follow `addrs`; connects still pending after `timeoutMs`
+    (-1: no limit) fail with `.timedOut`. Connected sockets are left non-blocking. -/
+@[extern "jack_socket_connect_many"]
+opaque connectMany (addrs : @& Array SockAddr) (timeoutMs : Int32) : IO (Array (Except SocketError Socket))
+
 /-- Accept a connection with a timeout (milliseconds).
     Returns `none` on timeout; socket remains non-blocking. -/
 def acceptWithTimeout (sock : Socket) (timeoutMs : Int32) : IO (Option Socket) := do
@@ -136,4 +143,44 @@ opaque wait (entries : @& Array PollEntry) (timeoutMs : Int32) : IO (Array PollR
 
 end Poll
 
+/-- Persistent poll set: a reusable native `pollfd` array with slot-based registration.
+    Masks are `PollEvent` bits (see `PollEvent.toBit`), so waits allocate only the
+    array of ready slots. Remove a socket's slot before closing the socket. -/
+opaque PollSetPointed : NonemptyType
+def PollSet : Type := PollSetPointed.type
+instance : Nonempty PollSet := PollSetPointed.property
+
+namespace PollSet
+
+/-- Create an empty poll set; `capacity` is a sizing hint and grows as needed. -/
+@[extern "jack_pollset_new"]
+opaque new (capacity : UInt32 := 16) : IO PollSet
+
+/-- Register a socket for the events in `mask`. Returns its slot (O(1); slots are reused). -/
+@[extern "jack_pollset_add"]
+opaque add (ps : @& PollSet) (sock : @& Socket) (mask : UInt16) : IO UInt32
+
+/-- Change the event mask of a slot. -/
+@[extern "jack_pollset_modify"]
+opaque modify (ps : @& PollSet) (slot : UInt32) (mask : UInt16) : IO Unit
+
+/-- Unregister a slot. -/
+@[extern "jack_pollset_remove"]
+opaque remove (ps : @& PollSet) (slot : UInt32) : IO Unit
+
+/-- Number of registered sockets. -/
+@[extern "jack_pollset_size"]
+opaque size (ps : @& PollSet) : IO UInt32
+
+/-- Wait for events and return the ready slots.
+    timeoutMs: -1 for infinite wait, 0 for immediate return, >0 for milliseconds -/
+@[extern "jack_pollset_wait"]
+opaque wait (ps : @& PollSet) (timeoutMs : Int32) : IO (Array UInt32)
+
+/-- Event mask reported for a slot by the last `wait`. -/
+@[extern "jack_pollset_revents"]
+opaque revents (ps : @& PollSet) (slot : UInt32) : IO UInt16
+
+end PollSet
+
 end Jack
@@ -0,0 +1,93 @@
+/-
+  Jack Ring Buffer
+  Double-mapped byte ring for streaming receive and parse without compaction.
+-/
+import Jack.Socket
+
+namespace Jack
+
+/-- Byte ring buffer. On Linux it is backed by a memfd mapped twice back-to-back, so
+    any readable or writable span is contiguous and never needs compacting; elsewhere
+    a plain buffer is used and wrapped spans go through two-segment `recvmsg`/`sendmsg`.
+    Not thread-safe. -/
+opaque RingBufferPointed : NonemptyType
+def RingBuffer : Type := RingBufferPointed.type
+instance : Nonempty RingBuffer := RingBufferPointed.property
+
+namespace RingBuffer
+
+/-- Create a ring with at least `capacity` bytes (rounded up to the page size). -/
+@[extern "jack_ring_create"]
+opaque create (capacity : UInt32) : IO RingBuffer
+
+/-- Total capacity in bytes. -/
+@[extern "jack_ring_capacity"]
+opaque capacity (rb : @& RingBuffer) : IO UInt32
+
+/-- Bytes available to read. -/
+@[extern "jack_ring_readable_bytes"]
+opaque readable (rb : @& RingBuffer) : IO UInt32
+
+/-- Free space in bytes. -/
+@[extern "jack_ring_writable_bytes"]
+opaque writable (rb : @& RingBuffer) : IO UInt32
+
+/-- True if the ring uses the double mapping (false on the fallback path). -/
+@[extern "jack_ring_is_double_mapped"]
+opaque isDoubleMapped (rb : @& RingBuffer) : IO Bool
+
+/-- Append bytes; returns how many fit. -/
+@[extern "jack_ring_write"]
+opaque write (rb : @& RingBuffer) (data : @& ByteArray) : IO UInt32
+
+/-- Copy up to `len` readable bytes starting `skip` bytes in, without consuming them. -/
+@[extern "jack_ring_peek"]
+opaque peek (rb : @& RingBuffer) (skip : UInt32) (len : UInt32) : IO ByteArray
+
+/-- Readable byte at offset `idx`. -/
+@[extern "jack_ring_byte_at"]
+opaque byteAt (rb : @& RingBuffer) (idx : UInt32) : IO UInt8
+
+/-- Offset of the first occurrence of `pattern` at or after `fromIdx`, scanned in place. -/
+@[extern "jack_ring_index_of"]
+opaque indexOf (rb : @& RingBuffer) (pattern : @& ByteArray) (fromIdx : UInt32 := 0) : IO (Option UInt32)
+
+/-- Drop `len` readable bytes. -/
+@[extern "jack_ring_consume"]
+opaque consume (rb : @& RingBuffer) (len : UInt32) : IO Unit
+
+/-- Copy out and consume up to `len` bytes. -/
+def read (rb : RingBuffer) (len : UInt32) : IO ByteArray := do
+  let data ← rb.peek 0 len
+  rb.consume data.size.toUInt32
+  return data
+
+/-- Consume one message terminated by `delim` (delimiter included), if complete. -/
+def readUntil (rb : RingBuffer) (delim : ByteArray) : IO (Option ByteArray) := do
+  match ← rb.indexOf delim with
+  | none => return none
+  | some idx => return some (← rb.read (idx + delim.size.toUInt32))
+
+end RingBuffer
+
+namespace Socket
+
+/-- Receive into the ring's free space in one call. Returns bytes received (0 = EOF). -/
+@[extern "jack_socket_recv_into_ring"]
+opaque recvIntoRing (sock : @& Socket) (rb : @& RingBuffer) (maxBytes : UInt32 := 0xFFFFFFFF) : IO UInt32
+
+/-- Non-blocking `recvIntoRing`. -/
+@[extern "jack_socket_recv_into_ring_try"]
+opaque recvIntoRingTry (sock : @& Socket) (rb : @& RingBuffer) (maxBytes : UInt32 := 0xFFFFFFFF) : IO (SocketResult UInt32)
+
+/-- Send readable bytes from the ring with `sendmsg`, consuming what was sent. -/
+@[extern "jack_socket_send_from_ring"]
+opaque sendFromRing (sock : @& Socket) (rb : @& RingBuffer) (maxBytes : UInt32 := 0xFFFFFFFF) : IO UInt32
+
+/-- Non-blocking `sendFromRing`. -/
+@[extern "jack_socket_send_from_ring_try"]
+opaque sendFromRingTry (sock : @& Socket) (rb : @& RingBuffer) (maxBytes : UInt32 := 0xFFFFFFFF) : IO (SocketResult UInt32)
+
+end Socket
+
+end Jack
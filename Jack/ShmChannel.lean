@@ -0,0 +1,312 @@
+/-
+  Jack Shared-memory Channel
+  Local IPC through SPSC rings in a memfd, negotiated and woken over a Unix socket.
+-/
+import Jack.Socket
+import Jack.Poll
+import Jack.Options
+
+namespace Jack
+
+/-- Shared region holding one single-producer/single-consumer byte ring per direction.
+    Created from a memfd (Linux only) and mapped by both processes. -/
+opaque ShmRegionPointed : NonemptyType
+def ShmRegion : Type := ShmRegionPointed.type
+instance : Nonempty ShmRegion := ShmRegionPointed.property
+
+namespace ShmRegion
+
+/-- Create a region with two rings of at least `ringCapacity` bytes each (Linux only). -/
+@[extern "jack_shm_create"]
+opaque create (ringCapacity : UInt32) : IO ShmRegion
+
+/-- Map a region from a received descriptor. Takes ownership of `fd`. -/
+@[extern "jack_shm_attach"]
+opaque attach (fd : UInt32) : IO ShmRegion
+
+/-- Close a received region descriptor without mapping it. -/
+@[extern "jack_fd_close"]
+opaque discardFd (fd : UInt32) : IO Unit
+
+/-- Backing memfd of a region made by `create`, for passing with SCM_RIGHTS. -/
+@[extern "jack_shm_fd"]
+opaque fd (region : @& ShmRegion) : IO UInt32
+
+/-- Close the backing memfd once the peer has it; the mapping stays valid. -/
+@[extern "jack_shm_release_fd"]
+opaque releaseFd (region : @& ShmRegion) : IO Unit
+
+/-- Capacity of each ring in bytes. -/
+@[extern "jack_shm_capacity"]
+opaque capacity (region : @& ShmRegion) : IO UInt32
+
+/-- Bytes readable from `ring` (0 or 1). -/
+@[extern "jack_shm_readable"]
+opaque readable (region : @& ShmRegion) (ring : UInt32) : IO UInt32
+
+/-- Free space in `ring` (0 or 1). -/
+@[extern "jack_shm_writable"]
+opaque writable (region : @& ShmRegion) (ring : UInt32) : IO UInt32
+
+/-- Append one length-prefixed message; false if the ring is too full (nothing written). -/
+@[extern "jack_shm_write_message"]
+opaque writeMessage (region : @& ShmRegion) (ring : UInt32) (data : @& ByteArray) : IO Bool
+
+/-- Append as much of `data` from `offset` as fits; returns bytes written. -/
+@[extern "jack_shm_write_stream"]
+opaque writeStream (region : @& ShmRegion) (ring : UInt32) (data : @& ByteArray) (offset : UInt32) : IO UInt32
+
+/-- Pop one message, or none if the ring is empty. -/
+@[extern "jack_shm_read_message"]
+opaque readMessage (region : @& ShmRegion) (ring : UInt32) : IO (Option ByteArray)
+
+/-- Copy out and consume up to `maxBytes` (empty if nothing is readable). -/
+@[extern "jack_shm_read_stream"]
+opaque readStream (region : @& ShmRegion) (ring : UInt32) (maxBytes : UInt32) : IO ByteArray
+
+/-- Set or clear the waiting flag of the reader (`side` 0) or writer (`side` 1) of `ring`. -/
+@[extern "jack_shm_set_waiting"]
+opaque setWaiting (region : @& ShmRegion) (ring : UInt32) (side : UInt32) (waiting : Bool) : IO Unit
+
+/-- Clear a waiting flag, returning whether it was set. -/
+@[extern "jack_shm_take_waiting"]
+opaque takeWaiting (region : @& ShmRegion) (ring : UInt32) (side : UInt32) : IO Bool
+
+end ShmRegion
+
+/-- Framing used by a channel. -/
+inductive ShmMode where
+  | message  -- Discrete messages, delivered whole
+  | stream   -- Byte stream; `recvBytes` returns whatever is available
+  deriving Repr, BEq, Inhabited
+
+/-- Shared-memory channel configuration. -/
+structure ShmConfig where
+  /-- Use shared memory; when false (or when either side refuses) data goes over the socket. -/
+  enabled : Bool := true
+  /-- Framing, chosen by the connecting side. -/
+  mode : ShmMode := .message
+  /-- Bytes per ring. A message must fit in one ring with its 4-byte header. -/
+  ringCapacity : UInt32 := 4 * 1024 * 1024
+  /-- Upper bound on a single sleep, as a guard against a lost wakeup (ms). -/
+  wakeTimeoutMs : Int32 := 100
+  deriving Repr, Inhabited
+
+/-- One endpoint of a shared-memory channel over a connected Unix stream socket.
+    Each endpoint must be used by one thread at a time; the two ends may live in
+    different threads or processes. -/
+structure ShmChannel where
+  sock : Socket
+  mode : ShmMode
+  /-- Shared region, or none when the channel fell back to the socket path. -/
+  region : Option ShmRegion
+  txRing : UInt32
+  rxRing : UInt32
+  wakeTimeoutMs : Int32
+  /-- Set once the peer has closed its end of the socket. -/
+  peerClosed : IO.Ref Bool
+
+namespace ShmChannel
+
+private def helloMagic : ByteArray := "JSHM".toUTF8
+private def version : UInt8 := 1
+private def readerSide : UInt32 := 0
+private def writerSide : UInt32 := 1
+
+private def u32le (n : UInt32) : ByteArray :=
+  ⟨#[n.toUInt8, (n >>> 8).toUInt8, (n >>> 16).toUInt8, (n >>> 24).toUInt8]⟩
+
+private def readU32le (b : ByteArray) (off : Nat) : UInt32 :=
+  b[off]!.toUInt32 ||| (b[off + 1]!.toUInt32 <<< 8) |||
+    (b[off + 2]!.toUInt32 <<< 16) ||| (b[off + 3]!.toUInt32 <<< 24)
+
+private def modeByte : ShmMode → UInt8
+  | .message => 0
+  | .stream => 1
+
+private def handshakeError : IO.Error := IO.userError "ShmChannel handshake failed"
+
+private def peerClosedError : IO.Error := IO.userError "ShmChannel peer closed"
+
+/-- Hello: magic, version, mode, shm flag, padding, ring capacity (little-endian). -/
+private def hello (config : ShmConfig) (useShm : Bool) : ByteArray :=
+  helloMagic ++ ⟨#[version, modeByte config.mode, if useShm then 1 else 0, 0]⟩ ++
+    u32le config.ringCapacity
+
+private def make (sock : Socket) (mode : ShmMode) (region : Option ShmRegion)
+    (txRing rxRing : UInt32) (config : ShmConfig) : IO ShmChannel := do
+  if region.isSome then
+    -- The socket only carries wakeup bytes from here on.
+    sock.setNonBlocking true
+  let peerClosed ← IO.mkRef false
+  return { sock, mode, region, txRing, rxRing, wakeTimeoutMs := config.wakeTimeoutMs, peerClosed }
+
+/-- Open a channel from the connecting side of `sock`. Creates the region and passes
+    its memfd to the peer; falls back to the socket if either side declines. -/
+def connect (sock : Socket) (config : ShmConfig := {}) : IO ShmChannel := do
+  let region ← if config.enabled then do
+      try pure (some (← ShmRegion.create config.ringCapacity)) catch _ => pure none
+    else
+      pure none
+  let control ← match region with
+    | some r => do pure ({ fds := #[← r.fd], cred := none } : MsgControl)
+    | none => pure MsgControl.empty
+  let _ ← sock.sendMsgControl #[hello config region.isSome] control
+  let ack ← sock.recv 1
+  if ack.size != 1 then
+    throw handshakeError
+  match region with
+  | some r =>
+      r.releaseFd
+      if ack[0]! == 1 then
+        make sock config.mode (some r) 0 1 config
+      else
+        make sock config.mode none 0 1 config
+  | none => make sock config.mode none 0 1 config
+
+/-- Open a channel from the accepting side of `sock`. The framing is the one the
+    connecting side asked for; `config.enabled := false` forces the socket path. -/
+def accept (sock : Socket) (config : ShmConfig := {}) : IO ShmChannel := do
+  let (parts, control) ← sock.recvMsgControl #[12] 1 false
+  let some msg := parts[0]?
+    | throw handshakeError
+  if msg.size != 12 || (msg.extract 0 4).data != helloMagic.data || msg[4]! != version then
+    for fd in control.fds do
+      try ShmRegion.discardFd fd catch _ => pure ()
+    throw handshakeError
+  let mode := if msg[5]! == 1 then ShmMode.stream else ShmMode.message
+  let offered := msg[6]! == 1
+  let region ← match control.fds[0]? with
+    | some fd =>
+        if config.enabled && offered then do
+          try pure (some (← ShmRegion.attach fd)) catch _ => pure none
+        else do
+          ShmRegion.discardFd fd
+          pure none
+    | none => pure none
+  sock.sendAll ⟨#[if region.isSome then 1 else 0]⟩
+  make sock mode region 1 0 { config with mode }
+
+/-- True if data moves through shared memory rather than the socket. -/
+def usesSharedMemory (ch : ShmChannel) : Bool := ch.region.isSome
+
+/-- Wake the peer with one byte. A full socket buffer already holds pending wakeups. -/
+private def wake (ch : ShmChannel) : IO Unit := do
+  try ch.sock.sendWithFlags ⟨#[1]⟩ ((← SocketMsgFlag.dontWait) ||| (← SocketMsgFlag.noSignal))
+  catch _ => pure ()
+
+/-- Wake the peer if it is sleeping on `side` of `ring`. -/
+private def notify (ch : ShmChannel) (region : ShmRegion) (ring side : UInt32) : IO Unit := do
+  if ← region.takeWaiting ring side then
+    ch.wake
+
+/-- Swallow pending wakeup bytes, noting EOF. -/
+private partial def drainWakeups (ch : ShmChannel) : IO Unit := do
+  match ← ch.sock.recvTry 64 with
+  | .ok data =>
+      if data.size == 0 then
+        ch.peerClosed.set true
+      else
+        drainWakeups ch
+  | .wouldBlock => pure ()
+  | .error _ => ch.peerClosed.set true
+
+/-- Sleep on `side` of `ring` until `ready` holds, a wakeup arrives or the timeout passes.
+    The flag is published before re-checking so a concurrent publish cannot be missed. -/
+private def sleepOn (ch : ShmChannel) (region : ShmRegion) (ring side : UInt32) (ready : IO Bool) : IO Unit := do
+  region.setWaiting ring side true
+  if !(← ready) && !(← ch.peerClosed.get) then
+    let events ← ch.sock.poll #[.readable] ch.wakeTimeoutMs
+    if !events.isEmpty then
+      ch.drainWakeups
+  region.setWaiting ring side false
+
+private partial def recvExact (sock : Socket) (n : Nat) (acc : ByteArray := ByteArray.empty) : IO ByteArray := do
+  if acc.size >= n then
+    return acc
+  let chunk ← sock.recv (n - acc.size).toUInt32
+  if chunk.size == 0 then
+    throw peerClosedError
+  recvExact sock n (acc ++ chunk)
+
+/-- Send one message (message mode). Blocks while the ring is full. -/
+partial def send (ch : ShmChannel) (data : ByteArray) : IO Unit := do
+  match ch.region with
+  | none =>
+      ch.sock.sendAll (u32le data.size.toUInt32)
+      ch.sock.sendAll data
+  | some region =>
+      let need := data.size.toUInt32 + 4
+      let rec loop : IO Unit := do
+        if ← region.writeMessage ch.txRing data then
+          ch.notify region ch.txRing readerSide
+        else if ← ch.peerClosed.get then
+          throw peerClosedError
+        else
+          ch.sleepOn region ch.txRing writerSide (do return (← region.writable ch.txRing) >= need)
+          loop
+      loop
+
+/-- Receive one message (message mode). Blocks until one arrives. -/
+partial def recv (ch : ShmChannel) : IO ByteArray := do
+  match ch.region with
+  | none =>
+      let header ← recvExact ch.sock 4
+      recvExact ch.sock (readU32le header 0).toNat
+  | some region =>
+      let rec loop : IO ByteArray := do
+        match ← region.readMessage ch.rxRing with
+        | some msg =>
+            ch.notify region ch.rxRing writerSide
+            return msg
+        | none =>
+            if ← ch.peerClosed.get then
+              throw peerClosedError
+            ch.sleepOn region ch.rxRing readerSide (do return (← region.readable ch.rxRing) > 0)
+            loop
+      loop
+
+/-- Write all of `data` (stream mode), waking the reader after each chunk.
+    Blocks while the ring is full. -/
+partial def sendBytes (ch : ShmChannel) (data : ByteArray) : IO Unit := do
+  match ch.region with
+  | none => ch.sock.sendAll data
+  | some region =>
+      let rec loop (offset : Nat) : IO Unit := do
+        if offset >= data.size then
+          return ()
+        let n ← region.writeStream ch.txRing data offset.toUInt32
+        if n > 0 then
+          ch.notify region ch.txRing readerSide
+          loop (offset + n.toNat)
+        else if ← ch.peerClosed.get then
+          throw peerClosedError
+        else
+          ch.sleepOn region ch.txRing writerSide (do return (← region.writable ch.txRing) > 0)
+          loop offset
+      loop 0
+
+/-- Read up to `maxBytes` (stream mode). Blocks until some data is available;
+    returns empty at end of stream. -/
+partial def recvBytes (ch : ShmChannel) (maxBytes : UInt32) : IO ByteArray := do
+  match ch.region with
+  | none => ch.sock.recv maxBytes
+  | some region =>
+      let rec loop : IO ByteArray := do
+        let data ← region.readStream ch.rxRing maxBytes
+        if data.size > 0 then
+          ch.notify region ch.rxRing writerSide
+          return data
+        if ← ch.peerClosed.get then
+          return ByteArray.empty
+        ch.sleepOn region ch.rxRing readerSide (do return (← region.readable ch.rxRing) > 0)
+        loop
+      loop
+
+/-- Close the socket. The mapping is released when both ends drop their region. -/
+def close (ch : ShmChannel) : IO Unit :=
+  ch.sock.close
+
+end ShmChannel
+
+end Jack
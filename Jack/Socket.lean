@@ -6,6 +6,7 @@ import Jack.Types
 import Jack.Address
 import Jack.Error
 import Jack.Options
+import Jack.ByteSlice
 
 namespace Jack
 
@@ -16,10 +17,61 @@ structure MsgCred where
   gid : UInt32
   deriving Repr, BEq
 
+/-- A kernel timestamp on CLOCK_REALTIME. -/
+structure KernelTimestamp where
+  sec : UInt64
+  nsec : UInt32
+  deriving Repr, BEq, Inhabited
+
+namespace KernelTimestamp
+
+/-- Nanoseconds since the Unix epoch. -/
+def toNs (ts : KernelTimestamp) : Nat :=
+  ts.sec.toNat * 1000000000 + ts.nsec.toNat
+
+/-- Current CLOCK_REALTIME time, comparable with kernel timestamps. -/
+@[extern "jack_realtime_now"]
+opaque now : IO KernelTimestamp
+
+end KernelTimestamp
+
+/-- Receive timestamps: when the kernel took the packet in (SO_TIMESTAMPNS or
+    SO_TIMESTAMPING software RX), and when the receive call returned it. -/
+structure RxTimestamp where
+  arrival : KernelTimestamp
+  pickup : KernelTimestamp
+  deriving Repr, BEq, Inhabited
+
+namespace RxTimestamp
+
+/-- Time the data spent queued in the kernel before the application picked it up (ns).
+    Separates our own scheduling latency from network latency. -/
+def queueingDelayNs (ts : RxTimestamp) : Nat :=
+  ts.pickup.toNs - ts.arrival.toNs
+
+end RxTimestamp
+
+/-- Point in the send path a TX timestamp was taken at (`ee_info`, SCM_TSTAMP_*). -/
+inductive TxTimestampKind where
+  | sent       -- Handed to the device driver (SCM_TSTAMP_SND)
+  | scheduled  -- Entered the packet scheduler (SCM_TSTAMP_SCHED)
+  | acked      -- All bytes acknowledged by the peer, TCP only (SCM_TSTAMP_ACK)
+  deriving Repr, BEq, Inhabited
+
+/-- A TX timestamp read back from the error queue. `id` counts sends (UDP) or bytes
+    (TCP, the last byte of the send) from when timestamping was enabled. -/
+structure TxTimestamp where
+  timestamp : KernelTimestamp
+  id : UInt32
+  kind : TxTimestampKind
+  deriving Repr, BEq, Inhabited
+
 /-- Control data for sendmsg/recvmsg (SCM_RIGHTS, SCM_CREDENTIALS). -/
 structure MsgControl where
   fds : Array UInt32
   cred : Option MsgCred
+  /-- Receive timestamp, if timestamping is enabled on the socket (ignored on send). -/
+  rxTimestamp : Option RxTimestamp := none
   deriving Repr
 
 namespace MsgControl
@@ -28,6 +80,57 @@ def empty : MsgControl := { fds := #[], cred := none }
 
 end MsgControl
 
+/-- Progress of `Socket.sendFileWith`, per part. Scalar fields only, declared by size. -/
+structure SendFileProgress where
+  headerBytes : UInt64
+  bodyBytes : UInt64
+  trailerBytes : UInt64
+  /-- True if every part was sent; false if the socket would block (resume with the rest). -/
+  complete : Bool
+  deriving Repr, BEq, Inhabited
+
+namespace SendFileProgress
+
+/-- Total bytes sent across headers, body and trailers. -/
+def total (p : SendFileProgress) : UInt64 :=
+  p.headerBytes + p.bodyBytes + p.trailerBytes
+
+end SendFileProgress
+
+/-- Decoded TCP_INFO snapshot. Times are microseconds, rates bytes/second.
+    Fields are declared by size to match the layout the FFI fills in. -/
+structure TcpInfo where
+  pacingRate : UInt64
+  deliveryRate : UInt64
+  bytesAcked : UInt64
+  bytesReceived : UInt64
+  rttUs : UInt32
+  rttVarUs : UInt32
+  minRttUs : UInt32
+  sndCwnd : UInt32
+  sndSsthresh : UInt32
+  /-- Total retransmitted segments over the connection's lifetime. -/
+  retransmits : UInt32
+  /-- Retransmitted segments not yet acknowledged. -/
+  retransOutstanding : UInt32
+  lost : UInt32
+  unacked : UInt32
+  /-- Kernel TCP state (1 = ESTABLISHED). -/
+  state : UInt8
+  deriving Repr, BEq, Inhabited
+
+/-- A datagram received into a buffer sized to it (`Socket.recvFromExact`).
+    Objects first, then scalars by size, to match the layout the FFI fills in. -/
+structure RecvFromExact where
+  /-- The datagram, or its first `cap` bytes if it was larger. -/
+  data : ByteArray
+  sender : SockAddr
+  /-- Full length of the datagram as sent, even when `data` holds less. -/
+  size : UInt32
+  /-- The datagram was larger than `cap`; the rest was discarded. -/
+  truncated : Bool
+  deriving Inhabited
+
 /-- Opaque TCP socket handle -/
 opaque SocketPointed : NonemptyType
 def Socket : Type := SocketPointed.type
@@ -63,6 +166,14 @@ opaque connectAddr (sock : @& Socket) (addr : @& SockAddr) : IO Unit
 @[extern "jack_socket_connect_addr_try"]
 opaque connectAddrTry (sock : @& Socket) (addr : @& SockAddr) : IO (SocketResult Unit)
 
+/-- Connect using a prepared address. -/
+@[extern "jack_socket_connect_prepared"]
+opaque connectPrepared (sock : @& Socket) (addr : @& PreparedAddr) : IO Unit
+
+/-- Connect using a prepared address (non-blocking try). -/
+@[extern "jack_socket_connect_prepared_try"]
+opaque connectPreparedTry (sock : @& Socket) (addr : @& PreparedAddr) : IO (SocketResult Unit)
+
 /-- Bind socket to an address and port (string address) -/
 @[extern "jack_socket_bind"]
 opaque bind (sock : @& Socket) (host : @& String) (port : UInt16) : IO Unit
@@ -91,6 +202,25 @@ opaque recv (sock : @& Socket) (maxBytes : UInt32) : IO ByteArray
 @[extern "jack_socket_recv_try"]
 opaque recvTry (sock : @& Socket) (maxBytes : UInt32) : IO (SocketResult ByteArray)
 
+/-- Receive exactly what the kernel has queued (FIONREAD), at most `cap` bytes, into a buffer
+    of that size. Blocks like `recv` while nothing is queued; empty at EOF. -/
+@[extern "jack_socket_recv_available"]
+opaque recvAvailable (sock : @& Socket) (cap : UInt32 := 1048576) : IO ByteArray
+
+/-- Receive what the kernel has queued, at most `cap` bytes (non-blocking try). -/
+@[extern "jack_socket_recv_available_try"]
+opaque recvAvailableTry (sock : @& Socket) (cap : UInt32 := 1048576) : IO (SocketResult ByteArray)
+
+/-- Receive with a buffer sized from this socket's recent reads (non-blocking try).
+    Starts at 2 KiB, doubles (up to `cap`) when a read fills the buffer and halves
+    (down to 64 bytes) after two reads that use less than half of it. -/
+@[extern "jack_socket_recv_adaptive_try"]
+opaque recvAdaptiveTry (sock : @& Socket) (cap : UInt32 := 65536) : IO (SocketResult ByteArray)
+
+/-- Current `recvAdaptiveTry` buffer size; 0 before the first adaptive read. -/
+@[extern "jack_socket_recv_hint"]
+opaque recvHint (sock : @& Socket) : IO UInt32
+
 /-- Receive data from socket with flags (MSG_PEEK, MSG_DONTWAIT, etc.). -/
 @[extern "jack_socket_recv_flags"]
 opaque recvWithFlags (sock : @& Socket) (maxBytes : UInt32) (flags : UInt32) : IO ByteArray
@@ -111,14 +241,34 @@ opaque sendTry (sock : @& Socket) (data : @& ByteArray) : IO (SocketResult UInt3
 @[extern "jack_socket_send_all"]
 opaque sendAll (sock : @& Socket) (data : @& ByteArray) : IO Unit
 
+/-- Send all bytes of a slice, retrying until they are transmitted. Nothing is copied. -/
+@[extern "jack_socket_send_slice"]
+opaque sendSlice (sock : @& Socket) (slice : @& ByteSlice) : IO Unit
+
+/-- Send a slice (non-blocking try). Returns bytes sent; continue with `slice.drop n`. -/
+@[extern "jack_socket_send_slice_try"]
+opaque sendSliceTry (sock : @& Socket) (slice : @& ByteSlice) : IO (SocketResult UInt32)
+
 /-- Send file contents to socket using sendfile(). If count=0, sends to EOF. -/
 @[extern "jack_socket_send_file"]
 opaque sendFile (sock : @& Socket) (path : @& String) (offset : UInt64) (count : UInt64) : IO UInt64
 
+/-- Send `headers`, a file range and `trailers` in one call. Headers use MSG_MORE inside a
+    TCP_CORK window (sf_hdtr on macOS) so they share segments with the body. If count=0,
+    sends to EOF; a range past the end of the file throws instead of sending a short body.
+    On a non-blocking socket, resume from the reported per-part progress. -/
+@[extern "jack_socket_send_file_with"]
+opaque sendFileWith (sock : @& Socket) (path : @& String) (offset : UInt64) (count : UInt64)
+    (headers trailers : @& Array ByteArray) : IO SendFileProgress
+
 /-- Send data from multiple buffers using sendmsg(). Returns bytes sent. -/
 @[extern "jack_socket_send_msg"]
 opaque sendMsg (sock : @& Socket) (chunks : @& Array ByteArray) : IO UInt32
 
+/-- Send several slices in one sendmsg(). Returns bytes sent. -/
+@[extern "jack_socket_send_msg_slices"]
+opaque sendMsgSlices (sock : @& Socket) (slices : @& Array ByteSlice) : IO UInt32
+
 /-- Send data with control messages (SCM_RIGHTS, SCM_CREDENTIALS). -/
 @[extern "jack_socket_send_msg_control"]
 opaque sendMsgControl (sock : @& Socket) (chunks : @& Array ByteArray) (control : @& MsgControl) : IO UInt32
@@ -190,6 +340,11 @@ def connectHostPort (host : String) (port : UInt16) : IO Socket := do
 @[extern "jack_socket_fd"]
 opaque fd (sock : @& Socket) : UInt32
 
+/-- Stable identifier for maps and metrics: handle-slab generation in the high 32 bits,
+    slot in the low 32. Unlike `fd` it is never shared with a later socket. -/
+@[extern "jack_socket_id"]
+opaque id (sock : @& Socket) : UInt64
+
 /-- Set recv/send timeouts in seconds -/
 @[extern "jack_socket_set_timeout"]
 opaque setTimeout (sock : @& Socket) (timeoutSecs : UInt32) : IO Unit
@@ -218,6 +373,55 @@ opaque setTcpKeepInterval (sock : @& Socket) (seconds : UInt32) : IO Unit
 @[extern "jack_socket_set_tcp_keepcnt"]
 opaque setTcpKeepCount (sock : @& Socket) (count : UInt32) : IO Unit
 
+/-- Enable TCP Fast Open on a listener; `qlen` bounds pending TFO requests. -/
+@[extern "jack_socket_set_tcp_fastopen"]
+opaque setTcpFastOpen (sock : @& Socket) (qlen : UInt32) : IO Unit
+
+/-- Enable TCP_FASTOPEN_CONNECT: `connect` returns at once and the first send rides on the SYN (Linux only). -/
+@[extern "jack_socket_set_tcp_fastopen_connect"]
+opaque setTcpFastOpenConnect (sock : @& Socket) (enabled : Bool) : IO Unit
+
+/-- Connect and send `data` in the SYN (MSG_FASTOPEN). Returns bytes accepted.
+    Without a cookie the kernel completes a normal handshake first; where TFO is
+    unavailable this is `connect` followed by `send`. -/
+@[extern "jack_socket_connect_with_data"]
+opaque connectWithData (sock : @& Socket) (addr : @& SockAddr) (data : @& ByteArray) : IO UInt32
+
+/-- Non-blocking TFO connect. `ok n`: the SYN carried `n` bytes; `wouldBlock`: no cookie yet,
+    only a SYN was sent, so wait for writability and send the data normally. -/
+@[extern "jack_socket_connect_with_data_try"]
+opaque connectWithDataTry (sock : @& Socket) (addr : @& SockAddr) (data : @& ByteArray) : IO (SocketResult UInt32)
+
+/-- Read TCP_INFO, decoded in C (Linux only). -/
+@[extern "jack_socket_tcp_info"]
+opaque tcpInfo (sock : @& Socket) : IO TcpInfo
+
+/-- Sample TCP_INFO for many sockets in one FFI call; `none` where the query fails. -/
+@[extern "jack_socket_tcp_info_many"]
+opaque tcpInfoMany (socks : @& Array Socket) : IO (Array (Option TcpInfo))
+
+/-- Bytes sitting in the kernel send queue, not yet acknowledged by the peer (SIOCOUTQ, Linux only). -/
+@[extern "jack_socket_send_queue_bytes"]
+opaque sendQueueBytes (sock : @& Socket) : IO UInt32
+
+/-- True if data sent in the SYN was acknowledged, i.e. the TFO cookie was accepted (Linux only). -/
+@[extern "jack_socket_fastopen_accepted"]
+opaque fastOpenAccepted (sock : @& Socket) : IO Bool
+
+/-- Enable SO_TIMESTAMPNS: stamp received data with its kernel arrival time. -/
+@[extern "jack_socket_set_timestamp_ns"]
+opaque setTimestampNs (sock : @& Socket) (enable : Bool) : IO Unit
+
+/-- Configure SO_TIMESTAMPING software timestamps (Linux only). `rx` stamps received data;
+    `tx` queues scheduled/sent (and TCP acked) timestamps on the error queue, each tagged
+    with an id (SOF_TIMESTAMPING_OPT_ID) so it can be matched to its send. -/
+@[extern "jack_socket_set_timestamping"]
+opaque setTimestamping (sock : @& Socket) (rx : Bool) (tx : Bool) : IO Unit
+
+/-- Read up to `maxCount` TX timestamps from the error queue without blocking. -/
+@[extern "jack_socket_read_tx_timestamps"]
+opaque readTxTimestamps (sock : @& Socket) (maxCount : UInt32 := 64) : IO (Array TxTimestamp)
+
 /-- Set a raw socket option value. The ByteArray is passed as-is to setsockopt. -/
 @[extern "jack_socket_set_option"]
 opaque setOption (sock : @& Socket) (level : UInt32) (optName : UInt32) (value : @& ByteArray) : IO Unit
@@ -248,6 +452,31 @@ def getReusePort (sock : @& Socket) : IO Bool := do
   let value ← sock.getOptionUInt32 level opt
   return value != 0
 
+/-- Set SO_INCOMING_CPU, asking the kernel to process this socket's RX on `cpu` (Linux only). -/
+@[extern "jack_socket_set_incoming_cpu"]
+opaque setIncomingCpu (sock : @& Socket) (cpu : UInt32) : IO Unit
+
+/-- Get SO_INCOMING_CPU: the CPU that last handled this socket's RX softirq, if known (Linux only). -/
+@[extern "jack_socket_get_incoming_cpu"]
+opaque getIncomingCpu (sock : @& Socket) : IO (Option UInt32)
+
+/-- Set SO_BUSY_POLL: microseconds to busy poll the NIC queue on blocking reads (Linux only).
+    Raising it above `net.core.busy_read` needs CAP_NET_ADMIN. -/
+@[extern "jack_socket_set_busy_poll"]
+opaque setBusyPoll (sock : @& Socket) (usec : UInt32) : IO Unit
+
+/-- Get SO_BUSY_POLL in microseconds (Linux only). -/
+@[extern "jack_socket_get_busy_poll"]
+opaque getBusyPoll (sock : @& Socket) : IO UInt32
+
+/-- Set SO_PREFER_BUSY_POLL: prefer busy polling over softirq processing (Linux only). -/
+@[extern "jack_socket_set_prefer_busy_poll"]
+opaque setPreferBusyPoll (sock : @& Socket) (enabled : Bool) : IO Unit
+
+/-- Set SO_BUSY_POLL_BUDGET: packets processed per busy-poll iteration (Linux only). -/
+@[extern "jack_socket_set_busy_poll_budget"]
+opaque setBusyPollBudget (sock : @& Socket) (budget : UInt32) : IO Unit
+
 /-- Enable or disable SO_KEEPALIVE on a socket. -/
 def setKeepAlive (sock : @& Socket) (enabled : Bool) : IO Unit := do
   let level ← SocketOption.solSocket
@@ -390,10 +619,35 @@ opaque sendToWithFlags (sock : @& Socket) (data : @& ByteArray) (addr : @& SockA
 @[extern "jack_socket_send_to_try"]
 opaque sendToTry (sock : @& Socket) (data : @& ByteArray) (addr : @& SockAddr) : IO (SocketResult UInt32)
 
+/-- Send a slice to a specific address (UDP). -/
+@[extern "jack_socket_send_to_slice"]
+opaque sendToSlice (sock : @& Socket) (slice : @& ByteSlice) (addr : @& SockAddr) : IO Unit
+
+/-- Send a slice to a specific address (UDP, non-blocking try). Returns bytes sent. -/
+@[extern "jack_socket_send_to_slice_try"]
+opaque sendToSliceTry (sock : @& Socket) (slice : @& ByteSlice) (addr : @& SockAddr) : IO (SocketResult UInt32)
+
+/-- Send data to a prepared address (UDP). -/
+@[extern "jack_socket_send_to_prepared"]
+opaque sendToPrepared (sock : @& Socket) (data : @& ByteArray) (addr : @& PreparedAddr) : IO Unit
+
+/-- Send data to a prepared address (UDP, non-blocking try). Returns bytes sent. -/
+@[extern "jack_socket_send_to_prepared_try"]
+opaque sendToPreparedTry (sock : @& Socket) (data : @& ByteArray) (addr : @& PreparedAddr) : IO (SocketResult UInt32)
+
+/-- Receive a datagram and its sender, already encoded for replying with `sendToPrepared`. -/
+@[extern "jack_socket_recv_from_prepared"]
+opaque recvFromPrepared (sock : @& Socket) (maxBytes : UInt32) : IO (ByteArray × PreparedAddr)
+
 /-- Receive data and sender address (UDP) -/
 @[extern "jack_socket_recv_from"]
 opaque recvFrom (sock : @& Socket) (maxBytes : UInt32) : IO (ByteArray × SockAddr)
 
+/-- Receive data and sender address (UDP) with its kernel arrival timestamp, if
+    `setTimestampNs` or `setTimestamping` enabled one. -/
+@[extern "jack_socket_recv_from_timestamped"]
+opaque recvFromTimestamped (sock : @& Socket) (maxBytes : UInt32) : IO (ByteArray × SockAddr × Option RxTimestamp)
+
 /-- Receive data and sender address (UDP) with flags. -/
 @[extern "jack_socket_recv_from_flags"]
 opaque recvFromWithFlags (sock : @& Socket) (maxBytes : UInt32) (flags : UInt32) : IO (ByteArray × SockAddr)
@@ -402,6 +656,15 @@ opaque recvFromWithFlags (sock : @& Socket) (maxBytes : UInt32) (flags : UInt32)
 @[extern "jack_socket_recv_from_try"]
 opaque recvFromTry (sock : @& Socket) (maxBytes : UInt32) : IO (SocketResult (ByteArray × SockAddr))
 
+/-- Receive one datagram into a buffer sized to it, at most `cap` bytes, reporting its full
+    length and whether it was truncated (MSG_PEEK | MSG_TRUNC on Linux). -/
+@[extern "jack_socket_recv_from_exact"]
+opaque recvFromExact (sock : @& Socket) (cap : UInt32 := 65535) : IO RecvFromExact
+
+/-- Receive one datagram sized to it (non-blocking try). -/
+@[extern "jack_socket_recv_from_exact_try"]
+opaque recvFromExactTry (sock : @& Socket) (cap : UInt32 := 65535) : IO (SocketResult RecvFromExact)
+
 end Socket
 
 end Jack
@@ -0,0 +1,208 @@
+/-
+  Jack Timer Wheel
+  Hierarchical timing wheel with O(1) insert and cancel.
+-/
+import Std.Data.HashMap
+
+namespace Jack
+
+/-- A timer stored in a wheel slot. `deadline` is an absolute tick. -/
+structure TimerEntry (α : Type) where
+  id : UInt64
+  deadline : Nat
+  value : α
+
+/-- Hierarchical timing wheel (4 levels × 64 slots).
+    Deadlines are absolute milliseconds on the monotonic clock (`IO.monoMsNow`);
+    `tickMs` sets the resolution. Insert, cancel and reschedule are O(1);
+    advancing costs O(1) per elapsed tick plus O(1) per expired or cascaded timer. -/
+structure TimerWheel (α : Type) where
+  tickMs : Nat
+  now : Nat
+  slots : Array (Std.HashMap UInt64 (TimerEntry α))
+  index : Std.HashMap UInt64 Nat
+
+namespace TimerWheel
+
+private def slotBits : Nat := 6
+private def slotCount : Nat := 64
+private def slotMask : Nat := 63
+private def levelCount : Nat := 4
+
+/-- Tick distance covered by the whole wheel; farther timers are clamped and cascade again. -/
+private def horizon : Nat := slotCount ^ levelCount
+
+/-- Create an empty wheel whose clock starts at `nowMs`. -/
+def empty (nowMs : Nat) (tickMs : Nat := 1) : TimerWheel α :=
+  let tickMs := max tickMs 1
+  { tickMs
+    now := nowMs / tickMs
+    slots := Array.replicate (slotCount * levelCount) {}
+    index := {} }
+
+/-- Number of pending timers. -/
+def size (w : TimerWheel α) : Nat := w.index.size
+
+/-- True if no timers are pending. -/
+def isEmpty (w : TimerWheel α) : Bool := w.index.isEmpty
+
+/-- True if a timer with this id is pending. -/
+def contains (w : TimerWheel α) (id : UInt64) : Bool := w.index.contains id
+
+private def toTick (w : TimerWheel α) (ms : Nat) : Nat :=
+  (ms + w.tickMs - 1) / w.tickMs
+
+private def slotEmpty (w : TimerWheel α) (idx : Nat) : Bool :=
+  match w.slots[idx]? with
+  | some slot => slot.isEmpty
+  | none => true
+
+/-- Flat slot index for a deadline tick relative to the current tick.
+    Overdue deadlines land in the next tick's slot. -/
+private def slotFor (now deadline : Nat) : Nat :=
+  let delta := if deadline ≤ now then 1 else min (deadline - now) (horizon - 1)
+  let target := now + delta
+  let level :=
+    if delta < slotCount then 0
+    else if delta < slotCount ^ 2 then 1
+    else if delta < slotCount ^ 3 then 2
+    else 3
+  level * slotCount + ((target >>> (slotBits * level)) &&& slotMask)
+
+/-- Look up the value of a pending timer. -/
+def find? (w : TimerWheel α) (id : UInt64) : Option α := do
+  let idx ← w.index.get? id
+  let slot ← w.slots[idx]?
+  let entry ← slot.get? id
+  return entry.value
+
+/-- Values of all pending timers, in no particular order. -/
+def values (w : TimerWheel α) : Array α := Id.run do
+  let mut out := #[]
+  for slot in w.slots do
+    for (_, entry) in slot.toList do
+      out := out.push entry.value
+  return out
+
+/-- Remove a timer. O(1); no-op if the id is not pending. -/
+def cancel (w : TimerWheel α) (id : UInt64) : TimerWheel α :=
+  match w.index.get? id with
+  | none => w
+  | some idx =>
+      { w with
+        slots := w.slots.modify idx (·.erase id)
+        index := w.index.erase id }
+
+/-- Schedule `value` under `id` to fire at `deadlineMs`.
+    O(1); replaces any pending timer with the same id. -/
+def insert (w : TimerWheel α) (id : UInt64) (deadlineMs : Nat) (value : α) : TimerWheel α :=
+  let w := w.cancel id
+  let deadline := w.toTick deadlineMs
+  let idx := slotFor w.now deadline
+  { w with
+    slots := w.slots.modify idx (·.insert id { id, deadline, value })
+    index := w.index.insert id idx }
+
+/-- Move a pending timer to a new deadline. O(1); no-op if the id is not pending. -/
+def reschedule (w : TimerWheel α) (id : UInt64) (deadlineMs : Nat) : TimerWheel α :=
+  match w.find? id with
+  | none => w
+  | some value => w.insert id deadlineMs value
+
+/-- Empty one slot of an upper level, re-placing its timers relative to the current tick. -/
+private def cascade (w : TimerWheel α) (idx : Nat) (expired : Array (TimerEntry α))
+    : TimerWheel α × Array (TimerEntry α) := Id.run do
+  let entries := match w.slots[idx]? with
+    | some slot => slot
+    | none => {}
+  if entries.isEmpty then
+    return (w, expired)
+  let mut w := { w with slots := w.slots.set! idx {} }
+  let mut expired := expired
+  for (id, entry) in entries.toList do
+    if entry.deadline ≤ w.now then
+      w := { w with index := w.index.erase id }
+      expired := expired.push entry
+    else
+      let slot := slotFor w.now entry.deadline
+      w := { w with
+        slots := w.slots.modify slot (·.insert id entry)
+        index := w.index.insert id slot }
+  return (w, expired)
+
+/-- Advance the clock by one tick: cascade wrapped levels, then expire the level-0 slot. -/
+private def stepTick (w : TimerWheel α) (expired : Array (TimerEntry α))
+    : TimerWheel α × Array (TimerEntry α) := Id.run do
+  let t := w.now + 1
+  let mut w := { w with now := t }
+  let mut expired := expired
+  for i in [0:levelCount - 1] do
+    let level := levelCount - 1 - i
+    if t % (slotCount ^ level) == 0 then
+      let idx := level * slotCount + ((t >>> (slotBits * level)) &&& slotMask)
+      let r := cascade w idx expired
+      w := r.1
+      expired := r.2
+  let idx := t &&& slotMask
+  let entries := match w.slots[idx]? with
+    | some slot => slot
+    | none => {}
+  if !entries.isEmpty then
+    w := { w with slots := w.slots.set! idx {} }
+    for (id, entry) in entries.toList do
+      w := { w with index := w.index.erase id }
+      expired := expired.push entry
+  return (w, expired)
+
+/-- Earliest tick at which the wheel has work (an expiry or a non-empty cascade). -/
+private def nextTick? (w : TimerWheel α) : Option Nat := Id.run do
+  if w.index.isEmpty then
+    return none
+  let mut best : Option Nat := none
+  for level in [0:levelCount] do
+    let shift := slotBits * level
+    let base := w.now >>> shift
+    for k in [1:slotCount + 1] do
+      let pos := base + k
+      if !w.slotEmpty (level * slotCount + (pos &&& slotMask)) then
+        let tick := pos <<< shift
+        best := some (match best with
+          | some b => min b tick
+          | none => tick)
+        break
+  return best
+
+/-- Advance the wheel to `nowMs`, returning the values of all timers that expired
+    (in deadline order). Idle stretches are skipped rather than stepped through. -/
+def advance (w : TimerWheel α) (nowMs : Nat) : Array α × TimerWheel α := Id.run do
+  let target := nowMs / w.tickMs
+  if target ≤ w.now then
+    return (#[], w)
+  if w.index.isEmpty then
+    return (#[], { w with now := target })
+  let mut w := w
+  let mut expired : Array (TimerEntry α) := #[]
+  while w.now < target && !w.index.isEmpty do
+    let t := w.now + 1
+    if w.slotEmpty (t &&& slotMask) && t % slotCount != 0 then
+      let next := match w.nextTick? with
+        | some n => min n target
+        | none => target
+      if next > t then
+        w := { w with now := next - 1 }
+    let r := stepTick w expired
+    w := r.1
+    expired := r.2
+  if w.now < target then
+    w := { w with now := target }
+  return (expired.map (·.value), w)
+
+/-- Earliest time (ms) at which `advance` has work to do, or `none` when empty.
+    Never later than the earliest pending deadline, so it is safe to use as a
+    poll timeout; upper-level timers report the tick at which they cascade. -/
+def nextDeadlineMs? (w : TimerWheel α) : Option Nat :=
+  w.nextTick?.map (· * w.tickMs)
+
+end TimerWheel
+
+end Jack
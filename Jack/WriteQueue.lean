@@ -0,0 +1,219 @@
+/-
+  Jack Write Queue
+  Per-connection outbound queue flushed by the reactor, with watermark backpressure.
+-/
+import Jack.Drain
+import Jack.Async
+import Std.Sync.Mutex
+
+namespace Jack
+
+/-- Write queue limits, in bytes. The watermarks count bytes queued in user space,
+    plus the kernel send queue when `includeKernelQueue` is set. -/
+structure WriteQueueConfig where
+  /-- Producers should pause once this many bytes are pending. -/
+  highWatermark : Nat := 256 * 1024
+  /-- A paused queue becomes writable again once pending bytes drop to this level. -/
+  lowWatermark : Nat := 64 * 1024
+  /-- Cap on bytes queued in user space; `enqueue` rejects data beyond it. -/
+  maxBytes : Nat := 4 * 1024 * 1024
+  /-- Count the kernel send queue (`Socket.sendQueueBytes`) toward the watermarks. -/
+  includeKernelQueue : Bool := false
+  /-- Re-check interval while paused on kernel-queued bytes alone (ms). -/
+  kernelPollMs : Nat := 5
+  deriving Repr, Inhabited
+
+/-- Outcome of `WriteQueue.enqueue`. -/
+inductive EnqueueResult where
+  | accepted  -- Sent or queued, below the high watermark
+  | paused    -- Queued, but at the high watermark: wait for `whenWritable` before producing more
+  | rejected  -- Dropped: queuing it would exceed `maxBytes`
+  deriving Repr, BEq, Inhabited
+
+private structure WriteQueueState where
+  /-- Unsent chunks; `offset` bytes of the first one are already written. -/
+  chunks : Array ByteArray := #[]
+  offset : Nat := 0
+  /-- Bytes left to write from `chunks`. -/
+  queued : Nat := 0
+  /-- A flush owns the queue: running now, or armed on the reactor. -/
+  flushing : Bool := false
+  /-- Crossed the high watermark and not yet back at the low one. -/
+  paused : Bool := false
+  /-- Released when `paused` clears. -/
+  writable : Option (IO.Promise Unit) := none
+  /-- First write error; the queue is dropped and later `enqueue` calls rethrow it. -/
+  failure : Option IO.Error := none
+
+/-- What a flush step needs next. -/
+private inductive FlushNext where
+  | idle      -- Nothing left to write
+  | writable  -- Data left: wait for writability on the reactor
+  | poll      -- Paused on the kernel queue alone: re-read it after `kernelPollMs`
+
+/-- Per-connection outbound queue. `enqueue` never blocks: what the socket does not take
+    right away is written by the reactor as the socket becomes writable, and memory is
+    bounded by `maxBytes`. -/
+structure WriteQueue where
+  sock : Socket
+  config : WriteQueueConfig
+  state : Std.Mutex WriteQueueState
+
+namespace WriteQueue
+
+/-- Wrap a socket in a write queue. The socket is switched to non-blocking mode. -/
+def new (sock : Socket) (config : WriteQueueConfig := {}) : IO WriteQueue := do
+  sock.setNonBlocking true
+  return { sock, config, state := ← Std.Mutex.new {} }
+
+private def kernelBytes (q : WriteQueue) : IO Nat := do
+  if !q.config.includeKernelQueue then
+    return 0
+  try
+    return (← q.sock.sendQueueBytes).toNat
+  catch _ =>
+    return 0
+
+/-- Apply the watermarks to `st`, returning the waiters to release if it left the paused state. -/
+private def watermarks (cfg : WriteQueueConfig) (st : WriteQueueState) (kernel : Nat)
+    : WriteQueueState × Option (IO.Promise Unit) :=
+  let level := st.queued + kernel
+  if st.paused && (level ≤ cfg.lowWatermark || st.failure.isSome) then
+    ({ st with paused := false, writable := none }, st.writable)
+  else if !st.paused && level ≥ cfg.highWatermark && st.failure.isNone then
+    ({ st with paused := true }, none)
+  else
+    (st, none)
+
+/-- Write whatever the socket takes now and decide how the flush continues. -/
+private def flushStep (q : WriteQueue) : IO (FlushNext × Option (IO.Promise Unit)) :=
+  q.state.atomically do
+    let mut st ← get
+    if st.failure.isNone && !st.chunks.isEmpty then
+      try
+        let r ← q.sock.sendDrain st.chunks st.offset.toUInt32
+        st := { st with
+          chunks := st.chunks.extract r.chunksSent.toNat st.chunks.size
+          offset := r.offset.toNat
+          queued := st.queued - r.bytes.toNat }
+      catch e =>
+        st := { st with chunks := #[], offset := 0, queued := 0, failure := some e }
+    let (next, release) := watermarks q.config st (← q.kernelBytes)
+    st := next
+    let step :=
+      if st.failure.isSome then FlushNext.idle
+      else if !st.chunks.isEmpty then FlushNext.writable
+      else if st.paused then FlushNext.poll
+      else FlushNext.idle
+    set { st with flushing := match step with | .idle => false | _ => true }
+    return (step, release)
+
+/-- Drop everything queued after a reactor failure and release paused producers. -/
+private def fail (q : WriteQueue) (err : IO.Error) : IO Unit := do
+  let release ← q.state.atomically do
+    let st ← get
+    set { st with
+      chunks := #[], offset := 0, queued := 0, flushing := false, paused := false
+      writable := none, failure := st.failure <|> some err }
+    return st.writable
+  if let some p := release then
+    p.resolve ()
+
+/-- Run flush steps until the queue is idle, continuing from reactor callbacks;
+    no thread waits while the socket is full. -/
+private partial def pump (q : WriteQueue) : IO Unit := do
+  let (next, release) ← q.flushStep
+  if let some p := release then
+    p.resolve ()
+  try
+    match next with
+    | .idle => pure ()
+    | .writable =>
+        let (wait, _) ← Async.awaitEventsCancelable q.sock #[.writable, .error, .hangup]
+        let _ ← IO.mapTask (t := wait) fun
+          | .ok _ => q.pump
+          | .error err => q.fail err.toIOError
+    | .poll =>
+        let (wait, _) ← (← Async.reactorFor q.sock).sleepCancelable q.config.kernelPollMs
+        let _ ← IO.mapTask (t := wait) fun
+          | .ok _ => q.pump
+          | .error err => q.fail err.toIOError
+  catch e =>
+    q.fail e
+
+/-- Queue `data` without blocking. Bytes the socket accepts right away are written
+    immediately; the rest is flushed by the reactor. Returns `.paused` once the high watermark
+    is reached and `.rejected` (queuing nothing) if `maxBytes` would be exceeded.
+    Throws the first write error once the connection has failed. -/
+def enqueue (q : WriteQueue) (data : ByteArray) : IO EnqueueResult := do
+  let kernel ← q.kernelBytes
+  let admitted ← q.state.atomically do
+    let st ← get
+    if let some err := st.failure then
+      throw err
+    if st.queued + data.size > q.config.maxBytes then
+      return none
+    let st := if data.size == 0 then st
+      else { st with chunks := st.chunks.push data, queued := st.queued + data.size }
+    let (st, release) := watermarks q.config st kernel
+    -- Claim the flush unless one is already running or armed.
+    set { st with flushing := true }
+    return some (!st.flushing, release)
+  match admitted with
+  | none => return .rejected
+  | some (claimed, release) =>
+      if let some p := release then
+        p.resolve ()
+      if claimed then
+        q.pump
+      let st ← q.state.atomically get
+      if let some err := st.failure then
+        throw err
+      return if st.paused then .paused else .accepted
+
+/-- Bytes queued in user space, not yet handed to the kernel. -/
+def queuedBytes (q : WriteQueue) : IO Nat := do
+  return (← q.state.atomically get).queued
+
+/-- Bytes counted against the watermarks: `queuedBytes`, plus the kernel send queue
+    when `includeKernelQueue` is set. -/
+def pendingBytes (q : WriteQueue) : IO Nat := do
+  return (← q.queuedBytes) + (← q.kernelBytes)
+
+/-- False between reaching the high watermark and draining back to the low one. -/
+def isWritable (q : WriteQueue) : IO Bool := do
+  return !(← q.state.atomically get).paused
+
+/-- The write error that failed the connection, if any. -/
+def error? (q : WriteQueue) : IO (Option IO.Error) := do
+  return (← q.state.atomically get).failure
+
+/-- "Writable again" signal: resolves immediately if the queue is not paused, otherwise once
+    pending bytes drop to the low watermark or the connection fails. -/
+def whenWritable (q : WriteQueue) : IO (Task Unit) := do
+  let promise? ← q.state.atomically do
+    let st ← get
+    if !st.paused then
+      return none
+    match st.writable with
+    | some p => return some p
+    | none =>
+        let p : IO.Promise Unit ← IO.Promise.new
+        set { st with writable := some p }
+        return some p
+  match promise? with
+  | none => return Task.pure ()
+  | some p => return p.result!
+
+/-- Queue `data`, first waiting for `whenWritable` if the queue is paused.
+    Throws if it still does not fit under `maxBytes`. -/
+def send (q : WriteQueue) (data : ByteArray) : IO Unit := do
+  if !(← q.isWritable) then
+    IO.wait (← q.whenWritable)
+  match ← q.enqueue data with
+  | .rejected => throw (IO.userError "Write queue limit exceeded")
+  | _ => pure ()
+
+end WriteQueue
+
+end Jack
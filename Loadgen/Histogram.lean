@@ -0,0 +1,126 @@
+/-
+  Jack Load Generator: HDR Histogram
+  Log-linear histogram with a fixed relative error, for latency recording.
+-/
+
+namespace Jack.Loadgen
+
+/-- High-dynamic-range histogram of values in `0 ... highest`.
+    Values are bucketed by powers of two, each bucket split into linear sub-buckets, so every
+    recorded value is kept to `sigFigs` significant digits while memory grows with
+    `log2 highest`. Same layout as HdrHistogram with a unit of 1. -/
+structure Histogram where
+  highest : Nat
+  sigFigs : Nat
+  /-- log2 of half the sub-bucket count. -/
+  subBucketHalfMagnitude : Nat
+  counts : Array Nat
+  totalCount : Nat := 0
+  minValue : Nat := 0
+  maxValue : Nat := 0
+  /-- Exact sum of recorded values, for the mean. -/
+  sum : Nat := 0
+  /-- Values above `highest`, recorded as `highest`. -/
+  saturated : Nat := 0
+  deriving Inhabited
+
+namespace Histogram
+
+/-- Empty histogram tracking `0 ... highest` (at least 2) to `sigFigs` (1-5) significant digits. -/
+def new (highest : Nat) (sigFigs : Nat := 3) : Histogram := Id.run do
+  let highest := max highest 2
+  let sigFigs := min (max sigFigs 1) 5
+  -- Sub-buckets per bucket: the power of two covering 2 * 10^sigFigs.
+  let subBucketMagnitude := Nat.log2 (2 * 10 ^ sigFigs - 1) + 1
+  let halfMagnitude := subBucketMagnitude - 1
+  let mut untrackable := 2 ^ subBucketMagnitude
+  let mut buckets := 1
+  while untrackable ≤ highest do
+    untrackable := untrackable * 2
+    buckets := buckets + 1
+  return {
+    highest, sigFigs
+    subBucketHalfMagnitude := halfMagnitude
+    counts := Array.replicate ((buckets + 1) * 2 ^ halfMagnitude) 0 }
+
+private def subBucketMask (h : Histogram) : Nat := 2 ^ (h.subBucketHalfMagnitude + 1) - 1
+
+/-- Slot of `v` in `counts`. -/
+def indexOf (h : Histogram) (v : Nat) : Nat :=
+  let bucket := Nat.log2 (v ||| h.subBucketMask) - h.subBucketHalfMagnitude
+  let subBucket := v >>> bucket
+  ((bucket + 1) <<< h.subBucketHalfMagnitude) + subBucket - 2 ^ h.subBucketHalfMagnitude
+
+/-- Lowest value stored in slot `i`, and the width of the range the slot covers. -/
+private def slotRange (h : Histogram) (i : Nat) : Nat × Nat :=
+  let half := 2 ^ h.subBucketHalfMagnitude
+  let top := i >>> h.subBucketHalfMagnitude
+  if top == 0 then
+    (i, 1)
+  else
+    let bucket := top - 1
+    let subBucket := (i &&& (half - 1)) + half
+    (subBucket <<< bucket, 1 <<< bucket)
+
+/-- Largest value that lands in the same slot as `v`. -/
+def highestEquivalent (h : Histogram) (v : Nat) : Nat :=
+  let (low, width) := h.slotRange (h.indexOf v)
+  low + width - 1
+
+/-- Record one value (values above `highest` count as `highest`). -/
+def record (h : Histogram) (v : Nat) (count : Nat := 1) : Histogram :=
+  if count == 0 then h else
+  let (v, saturated) := if v > h.highest then (h.highest, h.saturated + count) else (v, h.saturated)
+  { h with
+    counts := h.counts.modify (h.indexOf v) (· + count)
+    totalCount := h.totalCount + count
+    minValue := if h.totalCount == 0 then v else min h.minValue v
+    maxValue := max h.maxValue v
+    sum := h.sum + v * count
+    saturated }
+
+/-- Add every value recorded in `other` (same `highest` and `sigFigs`). -/
+def merge (h other : Histogram) : Histogram :=
+  if other.totalCount == 0 then h
+  else if h.totalCount == 0 then other
+  else
+    { h with
+      counts := h.counts.zipWith (· + ·) other.counts
+      totalCount := h.totalCount + other.totalCount
+      minValue := min h.minValue other.minValue
+      maxValue := max h.maxValue other.maxValue
+      sum := h.sum + other.sum
+      saturated := h.saturated + other.saturated }
+
+/-- Exact mean of the recorded values. -/
+def mean (h : Histogram) : Float :=
+  if h.totalCount == 0 then 0.0 else h.sum.toFloat / h.totalCount.toFloat
+
+/-- Value at percentile `p` (0-100): the highest equivalent value of the slot that holds
+    the `ceil(p% * count)`-th smallest recording, capped at the true maximum. -/
+def valueAtPercentile (h : Histogram) (p : Float) : Nat := Id.run do
+  if h.totalCount == 0 then
+    return 0
+  let p := if p < 0.0 then 0.0 else if p > 100.0 then 100.0 else p
+  let target := max 1 (p / 100.0 * h.totalCount.toFloat).ceil.toUInt64.toNat
+  let mut seen := 0
+  for i in [0:h.counts.size] do
+    seen := seen + h.counts[i]!
+    if seen ≥ target then
+      let (low, width) := h.slotRange i
+      return min (low + width - 1) h.maxValue
+  return h.maxValue
+
+/-- Non-empty slots as `(highest equivalent value, count)`, in increasing order. -/
+def buckets (h : Histogram) : Array (Nat × Nat) := Id.run do
+  let mut out := #[]
+  for i in [0:h.counts.size] do
+    let c := h.counts[i]!
+    if c > 0 then
+      let (low, width) := h.slotRange i
+      out := out.push (low + width - 1, c)
+  return out
+
+end Histogram
+
+end Jack.Loadgen
@@ -0,0 +1,254 @@
+/-
+  jack_loadgen
+  Open-loop load generator for Jack-based servers, with HDR latency histograms and JSON output.
+-/
+import Jack
+import Loadgen.Histogram
+import Loadgen.Runner
+
+open Jack
+open Jack.Loadgen
+
+private def usage : String :=
+  "usage: jack_loadgen [options] [tcp://HOST:PORT | udp://HOST:PORT | unix://PATH]
+
+  --rate N            requests per second across all connections (1000)
+  --duration MS       length of the run in milliseconds (10000)
+  --connections N     concurrent connections (16)
+  --reactors N        reactors to spread connections over, 0 = one per CPU (0)
+  --pattern P         echo | fixed | http (echo)
+  --size N            request size in bytes for echo/fixed (64)
+  --response-size N   response size in bytes for fixed (64)
+  --path PATH         request path for http (/)
+  --drain MS          wait for outstanding responses after the last send (2000)
+  --serve             start an in-process server for the pattern and target it
+  --output FILE       write the JSON report to FILE instead of stdout"
+
+private structure Options where
+  config : LoadConfig := {}
+  target : Option String := none
+  serve : Bool := false
+  output : Option String := none
+
+private def parseTarget (cfg : LoadConfig) (target : String) : Except String LoadConfig := do
+  let hostPort (rest : String) : Except String (String × UInt16) := do
+    let parts := rest.splitOn ":"
+    let some portText := parts.getLast?
+      | throw s!"missing port in {target}"
+    let some port := portText.toNat?
+      | throw s!"bad port in {target}"
+    let host := ":".intercalate (parts.dropLast)
+    let host := if host.startsWith "[" && host.endsWith "]" then (host.drop 1).dropRight 1 else host
+    return (host, port.toUInt16)
+  if target.startsWith "tcp://" then
+    let (host, port) ← hostPort (target.drop 6)
+    return { cfg with transport := .tcp, host, port }
+  if target.startsWith "udp://" then
+    let (host, port) ← hostPort (target.drop 6)
+    return { cfg with transport := .udp, host, port }
+  if target.startsWith "unix://" then
+    return { cfg with transport := .unix, path := target.drop 7 }
+  throw s!"unknown target {target}"
+
+private def parseNat (flag value : String) : Except String Nat :=
+  match value.toNat? with
+  | some n => pure n
+  | none => throw s!"{flag} expects a number, got {value}"
+
+private def parsePattern : String → Except String Pattern
+  | "echo" => pure .echo
+  | "fixed" => pure .fixed
+  | "http" => pure .http
+  | other => throw s!"unknown pattern {other}"
+
+private partial def parseArgs (opts : Options) : List String → Except String Options
+  | [] => pure opts
+  | "--serve" :: rest => parseArgs { opts with serve := true } rest
+  | flag :: value :: rest => do
+      let cfg := opts.config
+      let opts ← match flag with
+        | "--rate" => do pure { opts with config := { cfg with rate := ← parseNat flag value } }
+        | "--duration" => do pure { opts with config := { cfg with durationMs := ← parseNat flag value } }
+        | "--connections" => do pure { opts with config := { cfg with connections := ← parseNat flag value } }
+        | "--reactors" => do pure { opts with config := { cfg with reactors := ← parseNat flag value } }
+        | "--size" => do pure { opts with config := { cfg with requestSize := ← parseNat flag value } }
+        | "--response-size" => do pure { opts with config := { cfg with responseSize := ← parseNat flag value } }
+        | "--drain" => do pure { opts with config := { cfg with drainMs := ← parseNat flag value } }
+        | "--path" => pure { opts with config := { cfg with httpPath := value } }
+        | "--output" => pure { opts with output := some value }
+        | "--pattern" => do pure { opts with config := { cfg with pattern := ← parsePattern value } }
+        | _ =>
+            if flag.startsWith "--" then throw s!"unknown option {flag}"
+            else return { opts with target := some flag }
+      if flag.startsWith "--" then parseArgs opts rest else parseArgs opts (value :: rest)
+  | [target] =>
+      if target.startsWith "--" then throw s!"missing value for {target}"
+      else pure { opts with target := some target }
+
+/-! ## In-process server (`--serve`) -/
+
+private partial def readExact (sock : Socket) (n : Nat) : IO (Option ByteArray) := do
+  let rec loop (acc : ByteArray) : IO (Option ByteArray) := do
+    if acc.size ≥ n then
+      return some acc
+    let chunk ← sock.recv (n - acc.size).toUInt32
+    if chunk.size == 0 then
+      return none
+    loop (acc ++ chunk)
+  loop ByteArray.empty
+
+private def findHeadEnd (buf : ByteArray) : Option Nat := Id.run do
+  if buf.size < 4 then
+    return none
+  for i in [0:buf.size - 3] do
+    if buf[i]! == 13 && buf[i+1]! == 10 && buf[i+2]! == 13 && buf[i+3]! == 10 then
+      return some (i + 4)
+  return none
+
+private def httpResponse (bodySize : Nat) : ByteArray :=
+  s!"HTTP/1.1 200 OK\r\nContent-Length: {bodySize}\r\n\r\n".toUTF8 ++
+    ByteArray.mk (Array.replicate bodySize 0x62)
+
+/-- Serve one stream connection until the client closes it. -/
+private partial def serveStream (cfg : LoadConfig) (client : Socket) : IO Unit := do
+  let reply := ByteArray.mk (Array.replicate cfg.responseSize 0x62)
+  let http := httpResponse cfg.responseSize
+  let rec loop (pending : ByteArray) : IO Unit := do
+    match cfg.pattern with
+    | .echo =>
+        let data ← client.recv 65536
+        if data.size > 0 then
+          client.sendAll data
+          loop pending
+    | .fixed =>
+        if let some _ ← readExact client cfg.requestSize then
+          client.sendAll reply
+          loop pending
+    | .http =>
+        match findHeadEnd pending with
+        | some headEnd =>
+            client.sendAll http
+            loop (pending.extract headEnd pending.size)
+        | none =>
+            let data ← client.recv 65536
+            if data.size > 0 then
+              loop (pending ++ data)
+  try loop ByteArray.empty catch _ => pure ()
+  client.close
+
+/-- Start a loopback server for `cfg.pattern` and point `cfg` at it. -/
+private def startServer (cfg : LoadConfig) : IO (LoadConfig × Socket) := do
+  match cfg.transport with
+  | .udp =>
+      let sock ← Socket.create .inet .dgram .udp
+      sock.bindAddr (SockAddr.ipv4Loopback 0)
+      let port := ((← sock.getLocalAddr).port).getD 0
+      let _ ← IO.asTask (prio := .dedicated) do
+        while true do
+          let (data, peer) ← sock.recvFrom 65535
+          let reply := if cfg.pattern == .echo then data
+            else ByteArray.mk (Array.replicate cfg.responseSize 0x62)
+          sock.sendTo reply peer
+      return ({ cfg with host := "127.0.0.1", port }, sock)
+  | transport =>
+      let (listener, cfg) ← if transport == .unix then do
+          let path := s!"/tmp/jack_loadgen_{← IO.monoNanosNow}.sock"
+          let sock ← Socket.create .unix .stream .default
+          sock.bindAddr (.unix path)
+          pure (sock, { cfg with path })
+        else do
+          let sock ← Socket.create .inet .stream .tcp
+          sock.bindAddr (SockAddr.ipv4Loopback 0)
+          let port := ((← sock.getLocalAddr).port).getD 0
+          pure (sock, { cfg with host := "127.0.0.1", port })
+      listener.listen 1024
+      let _ ← IO.asTask (prio := .dedicated) do
+        while true do
+          let client ← listener.accept
+          if transport == .tcp then
+            client.setTcpNoDelay true
+          let _ ← IO.asTask (prio := .dedicated) (serveStream cfg client)
+      return (cfg, listener)
+
+/-! ## Report -/
+
+private def jsonString (s : String) : String := Id.run do
+  let mut out := "\""
+  for c in s.toList do
+    out := out ++ match c with
+      | '"' => "\\\""
+      | '\\' => "\\\\"
+      | '\n' => "\\n"
+      | c => if c.toNat < 0x20 then "?" else c.toString
+  return out ++ "\""
+
+private def targetString (cfg : LoadConfig) : String :=
+  match cfg.transport with
+  | .unix => s!"unix://{cfg.path}"
+  | t => s!"{t}://{cfg.host}:{cfg.port}"
+
+/-- JSON report: run parameters, counters, latency percentiles and the raw HDR buckets
+    (`[highest equivalent value, count]` pairs, microseconds) for offline merging. -/
+def reportJson (cfg : LoadConfig) (r : LoadResult) : String :=
+  let h := r.latency
+  let pct (p : Float) := toString (h.valueAtPercentile p)
+  let buckets := ",".intercalate (h.buckets.toList.map fun (v, c) => s!"[{v},{c}]")
+  let errors := ",".intercalate (r.errors.toList.map jsonString)
+  "{" ++
+    s!"\"target\":{jsonString (targetString cfg)}," ++
+    s!"\"transport\":\"{cfg.transport}\",\"pattern\":\"{cfg.pattern}\"," ++
+    s!"\"rate\":{cfg.rate},\"duration_ms\":{cfg.durationMs}," ++
+    s!"\"connections\":{cfg.connections},\"reactors\":{cfg.reactors}," ++
+    s!"\"request_size\":{cfg.requestSize},\"response_size\":{cfg.responseSize}," ++
+    s!"\"sent\":{r.sent},\"received\":{r.received},\"dropped\":{r.dropped}," ++
+    s!"\"timeouts\":{r.timeouts},\"bad_status\":{r.badStatus}," ++
+    s!"\"elapsed_ns\":{r.elapsedNs},\"throughput_rps\":{r.throughput}," ++
+    "\"latency_us\":{" ++
+      s!"\"count\":{h.totalCount},\"min\":{h.minValue},\"mean\":{h.mean}," ++
+      s!"\"p50\":{pct 50.0},\"p90\":{pct 90.0},\"p99\":{pct 99.0}," ++
+      s!"\"p99_9\":{pct 99.9},\"p99_99\":{pct 99.99},\"max\":{h.maxValue}," ++
+      s!"\"saturated\":{h.saturated},\"significant_digits\":{h.sigFigs}," ++
+      s!"\"buckets\":[{buckets}]" ++
+    "}," ++
+    s!"\"errors\":[{errors}]" ++
+  "}"
+
+private def runWith (opts : Options) : IO UInt32 := do
+  let mut cfg := opts.config
+  if let some target := opts.target then
+    match parseTarget cfg target with
+    | .ok c => cfg := c
+    | .error msg =>
+        IO.eprintln s!"jack_loadgen: {msg}"
+        return 2
+  let mut server : Option Socket := none
+  if opts.serve then
+    let (c, sock) ← startServer cfg
+    cfg := c
+    server := some sock
+  let result ← run cfg
+  let json := reportJson cfg result
+  match opts.output with
+  | some path => IO.FS.writeFile path (json ++ "\n")
+  | none => IO.println json
+  let h := result.latency
+  IO.eprintln s!"sent {result.sent}, received {result.received}, dropped {result.dropped}, timeouts {result.timeouts}; {result.throughput} req/s"
+  IO.eprintln s!"latency us: p50 {h.valueAtPercentile 50.0}, p99 {h.valueAtPercentile 99.0}, p99.9 {h.valueAtPercentile 99.9}, max {h.maxValue}"
+  for err in result.errors do
+    IO.eprintln s!"error: {err}"
+  Async.shutdown
+  if let some sock := server then
+    if cfg.transport == .unix then
+      try IO.FS.removeFile cfg.path catch _ => pure ()
+    sock.close
+  return if result.errors.isEmpty && result.received > 0 then 0 else 1
+
+def main (args : List String) : IO UInt32 := do
+  if args.contains "--help" || args.contains "-h" then
+    IO.println usage
+    return 0
+  match parseArgs {} args with
+  | .ok opts => runWith opts
+  | .error msg =>
+      IO.eprintln s!"jack_loadgen: {msg}\n{usage}"
+      return 2
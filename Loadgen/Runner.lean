@@ -0,0 +1,412 @@
+/-
+  Jack Load Generator: Runner
+  Open-loop request schedule over many connections, latency measured from intended send time.
+-/
+import Jack
+import Loadgen.Histogram
+import Std.Data.HashMap
+import Std.Sync.Mutex
+
+namespace Jack.Loadgen
+
+open Jack.Async
+
+/-- Transport used to reach the target. -/
+inductive Transport where
+  | tcp
+  | udp
+  | unix  -- Unix domain stream socket
+  deriving Repr, BEq, Inhabited
+
+namespace Transport
+
+def toString : Transport → String
+  | .tcp => "tcp"
+  | .udp => "udp"
+  | .unix => "unix"
+
+instance : ToString Transport := ⟨Transport.toString⟩
+
+end Transport
+
+/-- Request/response pattern. -/
+inductive Pattern where
+  | echo   -- Send `requestSize` bytes, expect the same bytes back
+  | fixed  -- Send `requestSize` bytes, expect `responseSize` bytes back
+  | http   -- HTTP/1.1 GET with keep-alive; the response is framed by Content-Length
+  deriving Repr, BEq, Inhabited
+
+namespace Pattern
+
+def toString : Pattern → String
+  | .echo => "echo"
+  | .fixed => "fixed"
+  | .http => "http"
+
+instance : ToString Pattern := ⟨Pattern.toString⟩
+
+end Pattern
+
+/-- Load run parameters. -/
+structure LoadConfig where
+  transport : Transport := .tcp
+  host : String := "127.0.0.1"
+  port : UInt16 := 9000
+  /-- Socket path for the `unix` transport. -/
+  path : String := ""
+  /-- Requests per second across all connections. -/
+  rate : Nat := 1000
+  durationMs : Nat := 10000
+  connections : Nat := 16
+  /-- Reactors the connections are spread over (0 = one per CPU). -/
+  reactors : Nat := 0
+  pattern : Pattern := .echo
+  requestSize : Nat := 64
+  responseSize : Nat := 64
+  httpPath : String := "/"
+  /-- How long to wait for outstanding responses after the last send (ms). -/
+  drainMs : Nat := 2000
+  /-- Largest latency the histogram tracks (µs); slower responses count at this value. -/
+  maxLatencyUs : Nat := 60 * 1000 * 1000
+  deriving Repr, Inhabited
+
+/-- Outcome of a load run. Latencies are in microseconds. -/
+structure LoadResult where
+  latency : Histogram
+  sent : Nat
+  received : Nat
+  /-- Requests dropped on the client: write queue over its cap, or a full UDP send buffer. -/
+  dropped : Nat
+  /-- Requests still unanswered when the drain window closed. -/
+  timeouts : Nat
+  /-- HTTP responses with a non-2xx status. -/
+  badStatus : Nat
+  errors : Array String
+  elapsedNs : Nat
+
+namespace LoadResult
+
+/-- Completed responses per second over the whole run. -/
+def throughput (r : LoadResult) : Float :=
+  if r.elapsedNs == 0 then 0.0 else r.received.toFloat * 1.0e9 / r.elapsedNs.toFloat
+
+end LoadResult
+
+/-- Intended send times (monotonic ns) of requests awaiting a response. Stream responses
+    arrive in order; UDP echo responses are matched by the sequence number they carry. -/
+private structure Inflight where
+  fifo : Std.Queue Nat := .empty
+  bySeq : Std.HashMap UInt64 Nat := {}
+
+private structure Conn where
+  sock : Socket
+  reactor : Reactor
+  queue : Option WriteQueue
+  /-- First request's intended send time and the spacing between requests (ns). -/
+  startNs : Nat
+  intervalNs : Nat
+  count : Nat
+  next : IO.Ref Nat
+  inflight : Std.Mutex Inflight
+  latency : IO.Ref Histogram
+  sent : IO.Ref Nat
+  received : IO.Ref Nat
+  dropped : IO.Ref Nat
+  badStatus : IO.Ref Nat
+  error : IO.Ref (Option String)
+
+private def Conn.intended (c : Conn) (i : Nat) : Nat := c.startNs + i * c.intervalNs
+
+private def encodeSeq (seq : UInt64) (payload : ByteArray) : ByteArray := Id.run do
+  let mut out := payload
+  for i in [0:min 8 payload.size] do
+    out := out.set! i (seq >>> (8 * i).toUInt64).toUInt8
+  return out
+
+private def decodeSeq (data : ByteArray) : Option UInt64 := Id.run do
+  if data.size < 8 then
+    return none
+  let mut seq : UInt64 := 0
+  for i in [0:8] do
+    seq := seq ||| (data[i]!.toUInt64 <<< (8 * i).toUInt64)
+  return some seq
+
+/-- Request bytes for the configured pattern. -/
+def requestPayload (cfg : LoadConfig) : ByteArray :=
+  match cfg.pattern with
+  | .http =>
+      s!"GET {cfg.httpPath} HTTP/1.1\r\nHost: {cfg.host}\r\n\r\n".toUTF8
+  | _ =>
+      -- UDP echo requests carry an 8-byte sequence number.
+      let size := if cfg.transport == .udp then max cfg.requestSize 8 else cfg.requestSize
+      ByteArray.mk (Array.replicate size 0x61)
+
+/-- Content-Length and whether the status is 2xx, from an HTTP response head. -/
+private def parseHttpHead (head : ByteArray) : Bool × Nat := Id.run do
+  let text := String.fromUTF8! head
+  let lines := text.splitOn "\r\n"
+  let ok := match lines.head? with
+    | some status => (status.splitOn " ").getD 1 "" |>.startsWith "2"
+    | none => false
+  let mut length := 0
+  for line in lines.drop 1 do
+    match line.splitOn ":" with
+    | name :: rest =>
+        if name.trim.toLower == "content-length" then
+          length := (":".intercalate rest).trim.toNat?.getD 0
+    | [] => pure ()
+  return (ok, length)
+
+private def record (c : Conn) (intendedNs : Nat) : IO Unit := do
+  let nowNs ← IO.monoNanosNow
+  let latencyUs := (nowNs - intendedNs) / 1000
+  c.latency.modify (·.record latencyUs)
+  c.received.modify (· + 1)
+
+private def noteError (c : Conn) (err : IO.Error) : IO Unit := do
+  if (← c.error.get).isNone then
+    c.error.set (some (toString err))
+
+/-- Send one request, remembering its intended time before any byte can be answered. -/
+private def sendOne (c : Conn) (cfg : LoadConfig) (payload : ByteArray) (i : Nat) : IO Unit := do
+  let intended := c.intended i
+  match c.queue with
+  | some q =>
+      let queued ← c.inflight.atomically do
+        let r ← q.enqueue payload
+        if r == .rejected then
+          return false
+        modify fun st => { st with fifo := st.fifo.enqueue intended }
+        return true
+      if queued then c.sent.modify (· + 1) else c.dropped.modify (· + 1)
+  | none =>
+      let seq := i.toUInt64
+      let payload := if cfg.pattern == .echo then encodeSeq seq payload else payload
+      let result ← c.inflight.atomically do
+        let r ← c.sock.sendTry payload
+        if let .ok _ := r then
+          modify fun st =>
+            if cfg.pattern == .echo then { st with bySeq := st.bySeq.insert seq intended }
+            else { st with fifo := st.fifo.enqueue intended }
+        return r
+      match result with
+      | .ok _ => c.sent.modify (· + 1)
+      | .wouldBlock => c.dropped.modify (· + 1)
+      | .error err => throw (IO.userError s!"Socket send error: {err}")
+
+/-- Open-loop sender: on each reactor timer tick, send every request whose intended time has
+    passed (a late tick catches up without moving the schedule), then sleep until the next. -/
+private partial def sendLoop (c : Conn) (cfg : LoadConfig) (payload : ByteArray)
+    : IO (AsyncTask Unit) := do
+  let nowNs ← IO.monoNanosNow
+  let mut i ← c.next.get
+  while i < c.count && c.intended i ≤ nowNs do
+    sendOne c cfg payload i
+    i := i + 1
+  c.next.set i
+  if i ≥ c.count then
+    return Task.pure (.ok ())
+  let waitMs := (c.intended i - nowNs + 999999) / 1000000
+  let (wait, _) ← c.reactor.sleepCancelable waitMs
+  IO.bindTask wait fun
+    | .ok _ => sendLoop c cfg payload
+    | .error err => pure (Task.pure (.error err.toIOError))
+
+/-- Read one response on a stream connection; resolves with whether it was a success. -/
+private def readResponse (c : Conn) (cfg : LoadConfig) (deadline : Nat) : IO (AsyncTask Bool) := do
+  match cfg.pattern with
+  | .echo =>
+      let t ← recvExactTask c.sock cfg.requestSize (some deadline)
+      IO.mapTask (t := t) fun r => do
+        let _ ← IO.ofExcept r
+        return true
+  | .fixed =>
+      let t ← recvExactTask c.sock cfg.responseSize (some deadline)
+      IO.mapTask (t := t) fun r => do
+        let _ ← IO.ofExcept r
+        return true
+  | .http =>
+      let head ← recvUntilTask c.sock "\r\n\r\n".toUTF8 (deadline := some deadline)
+      IO.bindTask head fun
+        | .error err => pure (Task.pure (.error err))
+        | .ok bytes => do
+            let (ok, length) := parseHttpHead bytes
+            if length == 0 then
+              return Task.pure (.ok ok)
+            let body ← recvExactTask c.sock length (some deadline)
+            IO.mapTask (t := body) fun r => do
+              let _ ← IO.ofExcept r
+              return ok
+
+private def allAnswered (c : Conn) : IO Bool := do
+  return (← c.received.get) + (← c.dropped.get) ≥ c.count
+
+/-- Stream receiver: one response per outstanding request, in order, until every request is
+    answered or `deadline` passes. -/
+private partial def recvStream (c : Conn) (cfg : LoadConfig) (deadline : Nat)
+    : IO (AsyncTask Unit) := do
+  if ← allAnswered c then
+    return Task.pure (.ok ())
+  let t ← readResponse c cfg deadline
+  IO.bindTask t fun
+    | .ok ok => do
+        let intended ← c.inflight.atomically do
+          let st ← get
+          match st.fifo.dequeue? with
+          | some (t, rest) =>
+              set { st with fifo := rest }
+              return some t
+          | none => return none
+        if let some t := intended then
+          record c t
+        if !ok then
+          c.badStatus.modify (· + 1)
+        recvStream c cfg deadline
+    | .error err => do
+        if toString err != "Async wait timed out" then
+          noteError c err
+        return Task.pure (.ok ())
+
+/-- Datagram receiver: echo responses are matched by sequence number, so loss and
+    reordering only cost the affected requests. -/
+private partial def recvDatagrams (c : Conn) (cfg : LoadConfig) (deadline : Nat)
+    : IO (AsyncTask Unit) := do
+  if ← allAnswered c then
+    return Task.pure (.ok ())
+  let t ← recvTask c.sock 65535 (some deadline)
+  IO.bindTask t fun
+    | .ok data => do
+        let intended ← c.inflight.atomically do
+          let st ← get
+          if cfg.pattern == .echo then
+            match decodeSeq data with
+            | some seq =>
+                set { st with bySeq := st.bySeq.erase seq }
+                return st.bySeq.get? seq
+            | none => return none
+          else
+            match st.fifo.dequeue? with
+            | some (t, rest) =>
+                set { st with fifo := rest }
+                return some t
+            | none => return none
+        if let some t := intended then
+          record c t
+        recvDatagrams c cfg deadline
+    | .error err => do
+        if toString err != "Async wait timed out" then
+          noteError c err
+        return Task.pure (.ok ())
+
+private def targetAddr (cfg : LoadConfig) : IO SockAddr := do
+  if cfg.transport == .unix then
+    return .unix cfg.path
+  match SockAddr.fromHostPort cfg.host cfg.port with
+  | some addr => return addr
+  | none =>
+      match (← SockAddr.resolveHostPort cfg.host cfg.port)[0]? with
+      | some addr => return addr
+      | none => throw (IO.userError s!"Cannot resolve {cfg.host}")
+
+private def familyOf : SockAddr → AddressFamily
+  | .ipv4 _ _ => .inet
+  | .ipv6 _ _ => .inet6
+  | _ => .unix
+
+private def openConnection (cfg : LoadConfig) (addr : SockAddr) : IO Socket := do
+  let sock ← match cfg.transport with
+    | .tcp => Socket.create (familyOf addr) .stream .tcp
+    | .udp => Socket.create (familyOf addr) .dgram .udp
+    | .unix => Socket.create .unix .stream .default
+  try
+    sock.connectAddr addr
+    if cfg.transport == .tcp then
+      sock.setTcpNoDelay true
+    sock.setNonBlocking true
+    return sock
+  catch e =>
+    sock.close
+    throw e
+
+/-- Run the load described by `cfg` against its target.
+    Each connection sends `rate / connections` requests per second on a fixed schedule,
+    regardless of how fast responses come back, and each latency is measured from the
+    request's intended send time, so a stalled server shows up as latency rather than as a
+    lower send rate (no coordinated omission). -/
+def run (cfg : LoadConfig) : IO LoadResult := do
+  if cfg.pattern == .http && cfg.transport == .udp then
+    throw (IO.userError "HTTP requires a stream transport")
+  let connections := max cfg.connections 1
+  let rate := max cfg.rate 1
+  let addr ← targetAddr cfg
+  let pool ← ReactorPool.start cfg.reactors (pin := false)
+  let payload := requestPayload cfg
+  let intervalNs := connections * 1000000000 / rate
+  let durationNs := cfg.durationMs * 1000000
+  let startNs := (← IO.monoNanosNow) + 10000000
+  let mut conns : Array Conn := #[]
+  try
+    for idx in [0:connections] do
+      let sock ← openConnection cfg addr
+      let reactor ← match pool.reactors[idx % pool.reactors.size]? with
+        | some r => pure r
+        | none => defaultReactor
+      bindSocket sock reactor
+      let queue ← if cfg.transport == .udp then pure none else do
+        pure (some (← WriteQueue.new sock))
+      -- Stagger connections evenly across one interval.
+      let offset := idx * intervalNs / connections
+      let count := if offset ≥ durationNs then 0 else (durationNs - offset + intervalNs - 1) / intervalNs
+      conns := conns.push {
+        sock, reactor, queue, count, intervalNs
+        startNs := startNs + offset
+        next := ← IO.mkRef 0
+        inflight := ← Std.Mutex.new {}
+        latency := ← IO.mkRef (Histogram.new cfg.maxLatencyUs)
+        sent := ← IO.mkRef 0
+        received := ← IO.mkRef 0
+        dropped := ← IO.mkRef 0
+        badStatus := ← IO.mkRef 0
+        error := ← IO.mkRef none }
+  catch e =>
+    for c in conns do
+      c.sock.close
+    pool.stop
+    throw e
+  let deadlineMs := (startNs + durationNs) / 1000000 + cfg.drainMs
+  let mut tasks := #[]
+  for c in conns do
+    let sender ← try sendLoop c cfg payload catch e => pure (Task.pure (.error e))
+    let receiver ← try
+      if cfg.transport == .udp then recvDatagrams c cfg deadlineMs
+      else recvStream c cfg deadlineMs
+    catch e =>
+      pure (Task.pure (.error e))
+    tasks := tasks.push (c, sender, receiver)
+  for (c, sender, receiver) in tasks do
+    if let .error err ← IO.wait sender then
+      noteError c err
+    let _ ← IO.wait receiver
+  let elapsedNs := (← IO.monoNanosNow) - startNs
+  let mut latency := Histogram.new cfg.maxLatencyUs
+  let mut sent := 0
+  let mut received := 0
+  let mut dropped := 0
+  let mut badStatus := 0
+  let mut errors := #[]
+  for c in conns do
+    latency := latency.merge (← c.latency.get)
+    sent := sent + (← c.sent.get)
+    received := received + (← c.received.get)
+    dropped := dropped + (← c.dropped.get)
+    badStatus := badStatus + (← c.badStatus.get)
+    if let some err ← c.error.get then
+      errors := errors.push err
+    unbindSocket c.sock
+    c.sock.close
+  pool.stop
+  return {
+    latency, sent, received, dropped, badStatus, errors, elapsedNs
+    timeouts := sent - received }
+
+end Jack.Loadgen
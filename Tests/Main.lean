@@ -1,5 +1,7 @@
 import Crucible
 import Jack
+import Loadgen.Histogram
+import Loadgen.Runner
 open Crucible
 open Jack
 
@@ -119,6 +121,35 @@ test "IPv4Addr toUInt32/fromUInt32" := do
   let addr3 : IPv4Addr := ⟨192, 168, 1, 100⟩
   ensure (IPv4Addr.fromUInt32 addr3.toUInt32 == addr3) "roundtrip private"
 
+test "Packed IPv4 parse and format" := do
+  ensure (IPv4Addr.parsePacked "10.0.200.7" == some 0x0A00C807) "parse packed"
+  ensure (IPv4Addr.parsePacked "1.2.3.4.5" == none) "reject too many parts"
+  ensure (IPv4Addr.parsePacked "1.2.3.1000" == none) "reject long octet"
+  ensure (IPv4Addr.parsePacked "1..3.4" == none) "reject empty octet"
+  ensure (IPv4Addr.formatPacked 0x0A00C807 == "10.0.200.7") "format packed"
+
+test "PackedIPv6 parse, format and bytes" := do
+  let some addr := PackedIPv6.parse "[2001:db8::1]"
+    | ensure false "parse bracketed"
+  ensure (addr.hi == 0x20010DB800000000 && addr.lo == 1) "packed words"
+  ensure (addr.toString == "2001:db8::1") "compressed format"
+  ensure (PackedIPv6.ofBytes? addr.toBytes == some addr) "bytes roundtrip"
+  let some scoped := PackedIPv6.parse "fe80::1%3"
+    | ensure false "parse scoped"
+  ensure (scoped.scopeId == 3) "zone index"
+  ensure (scoped.toString == "fe80::1%3") "scoped format"
+  ensure (PackedIPv6.parse "fe80::1%no-such-if0" == none) "reject unknown zone"
+  ensure (PackedIPv6.loopback.toString == "::1") "loopback format"
+
+test "PackedSockAddr conversions" := do
+  ensure ((PackedSockAddr.parse "127.0.0.1" 80).map (·.toString) == some "127.0.0.1:80") "v4 parse"
+  let some v6 := PackedSockAddr.parse "::1" 443
+    | ensure false "v6 parse"
+  ensure (v6.toString == "[::1]:443") "v6 format"
+  ensure (v6.toSockAddr == SockAddr.ipv6Loopback 443) "v6 unpack"
+  ensure (PackedSockAddr.ofSockAddr? (SockAddr.ipv4Loopback 8080) == some (.v4 0x7F000001 8080)) "v4 pack"
+  ensure (PackedSockAddr.ofSockAddr? (.unix "/tmp/x") == none) "unix has no packed form"
+
 test "SockAddr.ipv4 construction and accessors" := do
   let addr := SockAddr.ipv4Loopback 8080
   ensure (addr.port == some 8080) "port accessor"
@@ -131,7 +162,18 @@ test "SockAddr.ipv6 construction and accessors" := do
   let bytes : ByteArray := ⟨#[0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0]⟩
   let addr := SockAddr.ipv6 bytes 8080
   ensure (addr.port == some 8080) "ipv6 port accessor"
-  ensure (addr.toString == "[ipv6]:8080") "ipv6 toString"
+  ensure (addr.toString == "[::]:8080") "ipv6 toString"
+  ensure ((SockAddr.ipv6Loopback 443).toString == "[::1]:443") "ipv6 loopback toString"
+
+test "SockAddr and PackedSockAddr hashing" := do
+  let a := SockAddr.ipv4Loopback 8080
+  ensure (hash a == hash (SockAddr.ipv4Loopback 8080)) "equal addresses hash equal"
+  ensure (hash a != hash (SockAddr.ipv4Loopback 8081)) "port changes hash"
+  ensure ((PackedSockAddr.ofSockAddr? a).map hash == some (hash a)) "packed hash matches"
+  let v6 := SockAddr.ipv6Loopback 443
+  ensure ((PackedSockAddr.ofSockAddr? v6).map hash == some (hash v6)) "packed v6 hash matches"
+  let m : Std.HashMap SockAddr Nat := Std.HashMap.empty.insert a 1
+  ensure (m.get? (SockAddr.ipv4Loopback 8080) == some 1) "usable as map key"
 
 test "SockAddr.unix construction and accessors" := do
   let addr := SockAddr.unix "/tmp/test.sock"
@@ -245,6 +287,40 @@ test "recvWithFlags MSG_PEEK does not consume" := do
   a.close
   b.close
 
+test "recvAvailable returns exactly the queued bytes" := do
+  let (a, b) ← Socket.pair .unix .stream .default
+  a.sendAll (ByteArray.mk (Array.replicate 3000 0x61))
+  let data ← b.recvAvailable
+  ensure (data.size == 3000) "one read takes the whole queue"
+  a.sendAll "0123456789".toUTF8
+  let capped ← b.recvAvailable 4
+  ensure (String.fromUTF8! capped == "0123") "cap bounds the read"
+  match ← b.recvAvailableTry with
+  | .ok rest => ensure (String.fromUTF8! rest == "456789") "try reads the remainder"
+  | _ => ensure false "expected queued data"
+  match ← b.recvAvailableTry with
+  | .wouldBlock => pure ()
+  | _ => ensure false "expected wouldBlock"
+  a.close
+  ensure ((← b.recvAvailable).size == 0) "EOF is empty"
+  b.close
+
+test "recvAdaptiveTry grows and shrinks its buffer" := do
+  let (a, b) ← Socket.pair .unix .stream .default
+  ensure ((← b.recvHint) == 0) "no hint before the first read"
+  a.sendAll (ByteArray.mk (Array.replicate 5000 0x61))
+  match ← b.recvAdaptiveTry with
+  | .ok data => ensure (data.size == 2048) "first read uses the default size"
+  | _ => ensure false "expected data"
+  ensure ((← b.recvHint) == 4096) "full read doubles the hint"
+  let _ ← b.recv 4096
+  for _ in [0:2] do
+    a.sendAll "x".toUTF8
+    let _ ← b.recvAdaptiveTry
+  ensure ((← b.recvHint) == 2048) "two small reads halve the hint"
+  a.close
+  b.close
+
 test "connectHostPort resolves IPv4/IPv6" := do
   let server ← Socket.new
   server.bind "127.0.0.1" 0
@@ -267,6 +343,36 @@ test "connectHostPort resolves IPv4/IPv6" := do
 
   let _ ← IO.ofExcept clientTask.get
 
+test "connectMany fans out and reports per address" := do
+  let a ← Socket.new
+  a.bind "127.0.0.1" 0
+  a.listen 4
+  let b ← Socket.new
+  b.bind "127.0.0.1" 0
+  b.listen 4
+  -- A port with nothing listening on it
+  let closed ← Socket.new
+  closed.bind "127.0.0.1" 0
+  let refusedAddr ← closed.getLocalAddr
+  closed.close
+  let results ← Socket.connectMany #[← a.getLocalAddr, refusedAddr, ← b.getLocalAddr] 2000
+  ensure (results.size == 3) "one result per address"
+  match results[0]!, results[1]!, results[2]! with
+  | .ok c1, .error err, .ok c2 =>
+      ensure (err == .connectionRefused) "refused address reported"
+      let s1 ← a.accept
+      let s2 ← b.accept
+      c1.sendAll "one".toUTF8
+      ensure (String.fromUTF8! (← s1.recv 16) == "one") "first connection works"
+      c2.close
+      c1.close
+      s1.close
+      s2.close
+  | _, _, _ => ensure false "unexpected connectMany results"
+  ensure ((← Socket.connectMany #[] 100).isEmpty) "empty input"
+  a.close
+  b.close
+
 test "connectAddrWithTimeout succeeds" := do
   let server ← Socket.new
   server.bind "127.0.0.1" 0
@@ -286,6 +392,20 @@ test "connectAddrWithTimeout succeeds" := do
       server.close
       ensure false "connect timed out"
 
+test "connectPrepared reaches a listener" := do
+  let server ← Socket.new
+  server.bind "127.0.0.1" 0
+  server.listen 1
+  let port := ((← server.getLocalAddr).port).getD 0
+  let addr ← PreparedAddr.parse "127.0.0.1" port
+  ensure (addr.toSockAddr == SockAddr.ipv4Loopback port) "prepared address decodes"
+  let client ← Socket.new
+  client.connectPrepared addr
+  let conn ← server.accept
+  conn.close
+  client.close
+  server.close
+
 test "acceptWithTimeout returns none then some" := do
   let server ← Socket.new
   server.bind "127.0.0.1" 0
@@ -396,6 +516,96 @@ test "UDP send/recv" := do
   server.close
   client.close
 
+test "UDP sendToSlice" := do
+  let server ← Socket.create .inet .dgram .udp
+  server.bindAddr (SockAddr.ipv4Loopback 0)
+  let serverAddr ← server.getLocalAddr
+  let client ← Socket.create .inet .dgram .udp
+  let frame := "[[datagram]]".toUTF8
+  client.sendToSlice ((ByteSlice.ofByteArray frame).drop 2 |>.take 8) serverAddr
+  let (data, _) ← server.recvFrom 1024
+  ensure (String.fromUTF8! data == "datagram") "datagram carries the slice only"
+  server.close
+  client.close
+
+test "UDP prepared reply" := do
+  let server ← Socket.create .inet .dgram .udp
+  server.bindAddr (SockAddr.ipv4Loopback 0)
+  let serverAddr ← PreparedAddr.ofSockAddr (← server.getLocalAddr)
+  let client ← Socket.create .inet .dgram .udp
+  client.bindAddr (SockAddr.ipv4Loopback 0)
+  client.sendToPrepared "ping".toUTF8 serverAddr
+  let (data, peer) ← server.recvFromPrepared 1024
+  ensure (String.fromUTF8! data == "ping") "server received ping"
+  ensure (peer.toSockAddr == (← client.getLocalAddr)) "sender address decodes"
+  ensure (peer == (← PreparedAddr.ofSockAddr (← client.getLocalAddr))) "prepared addresses compare"
+  server.sendToPrepared "pong".toUTF8 peer
+  let (reply, _) ← client.recvFrom 1024
+  ensure (String.fromUTF8! reply == "pong") "client received pong"
+  server.close
+  client.close
+
+test "UDP recvFromExact reports size and truncation" := do
+  let server ← Socket.create .inet .dgram .udp
+  server.bindAddr (SockAddr.ipv4Loopback 0)
+  let serverAddr ← server.getLocalAddr
+  let client ← Socket.create .inet .dgram .udp
+  client.bindAddr (SockAddr.ipv4Loopback 0)
+  client.sendTo (ByteArray.mk (Array.replicate 300 0x61)) serverAddr
+  let small ← server.recvFromExact
+  ensure (small.data.size == 300 && small.size == 300) "buffer sized to the datagram"
+  ensure (!small.truncated) "not truncated"
+  ensure (small.sender == (← client.getLocalAddr)) "sender reported"
+  client.sendTo (ByteArray.mk (Array.replicate 3000 0x62)) serverAddr
+  let big ← server.recvFromExact 1000
+  ensure (big.data.size == 1000) "data capped"
+  ensure (big.size == 3000 && big.truncated) "full length and truncation reported"
+  match ← server.recvFromExactTry with
+  | .wouldBlock => pure ()
+  | _ => ensure false "expected wouldBlock"
+  server.close
+  client.close
+
+test "UDP recvFromMany demuxes by peer" := do
+  let server ← Socket.create .inet .dgram .udp
+  server.bindAddr (SockAddr.ipv4Loopback 0)
+  let serverAddr ← server.getLocalAddr
+  let known ← Socket.create .inet .dgram .udp
+  known.bindAddr (SockAddr.ipv4Loopback 0)
+  let stranger ← Socket.create .inet .dgram .udp
+  stranger.bindAddr (SockAddr.ipv4Loopback 0)
+  let table ← PeerTable.new
+  table.insert (← known.getLocalAddr) 7
+  ensure ((← table.find? (← known.getLocalAddr)) == some 7) "find mapped peer"
+  known.sendTo "a".toUTF8 serverAddr
+  stranger.sendTo "b".toUTF8 serverAddr
+  let mut got : Array PeerDatagram := #[]
+  while got.size < 2 do
+    got := got ++ (← server.recvFromMany table 8 1500)
+  let mut sawKnown := false
+  let mut sawStranger := false
+  for d in got do
+    match d with
+    | .known session data truncated =>
+        sawKnown := session == 7 && String.fromUTF8! data == "a" && !truncated
+    | .unknown peer data truncated =>
+        sawStranger := peer == (← stranger.getLocalAddr) && String.fromUTF8! data == "b" && !truncated
+  ensure sawKnown "known peer returned as its session"
+  ensure sawStranger "unknown peer returned with its address"
+  ensure (← table.erase (← known.getLocalAddr)) "erase mapped peer"
+  ensure ((← table.size) == 0) "table empty"
+  let start ← IO.monoMsNow
+  match ← server.recvFromManyTry table 8 1500 with
+  | .wouldBlock => pure ()
+  | _ => ensure false "expected wouldBlock"
+  ensure ((← IO.monoMsNow) - start < 1000) "try does not wait for the receive timeout"
+  stranger.sendTo (ByteArray.mk (Array.replicate 100 0x61)) serverAddr
+  let cut ← server.recvFromMany table 8 16
+  ensure (cut.size == 1 && cut[0]!.truncated && cut[0]!.data.size == 16) "oversized datagram reported as truncated"
+  server.close
+  known.close
+  stranger.close
+
 test "UDP roundtrip" := do
   let server ← Socket.create .inet .dgram .udp
   server.bindAddr (SockAddr.ipv4Loopback 0)
@@ -434,6 +644,54 @@ test "UDP IPv6 send/recv" := do
   server.close
   client.close
 
+test "UDP receive timestamps" := do
+  let server ← Socket.create .inet .dgram .udp
+  server.bindAddr (SockAddr.ipv4Loopback 0)
+  let serverAddr ← server.getLocalAddr
+  server.setTimestampNs true
+  let client ← Socket.create .inet .dgram .udp
+  let before ← KernelTimestamp.now
+  client.sendTo "stamp".toUTF8 serverAddr
+  let (data, _, ts?) ← server.recvFromTimestamped 1024
+  ensure (String.fromUTF8! data == "stamp") "payload received"
+  match ts? with
+  | some ts =>
+      ensure (ts.arrival.toNs + 1000000 >= before.toNs) "arrival after send"
+      ensure (ts.pickup.toNs >= ts.arrival.toNs) "picked up after arrival"
+      ensure (ts.queueingDelayNs < 10000000000) "queueing delay is sane"
+  | none => ensure false "expected an arrival timestamp"
+  client.sendTo "again".toUTF8 serverAddr
+  let (_, ctrl) ← server.recvMsgControl #[16] 0 false
+  ensure ctrl.rxTimestamp.isSome "recvMsgControl reports the timestamp"
+  server.close
+  client.close
+
+test "UDP TX timestamps from the error queue" := do
+  let server ← Socket.create .inet .dgram .udp
+  server.bindAddr (SockAddr.ipv4Loopback 0)
+  let serverAddr ← server.getLocalAddr
+  let client ← Socket.create .inet .dgram .udp
+  try
+    client.setTimestamping (rx := false) (tx := true)
+    client.sendTo "a".toUTF8 serverAddr
+    client.sendTo "b".toUTF8 serverAddr
+    let mut stamps : Array TxTimestamp := #[]
+    for _ in [0:50] do
+      stamps := stamps ++ (← client.readTxTimestamps)
+      if stamps.any (fun t => t.kind == .sent && t.id == 1) then
+        break
+      IO.sleep 2
+    -- OPT_ID numbers datagrams from 0 in send order
+    if !System.Platform.isOSX && !System.Platform.isWindows then
+      ensure (stamps.any (fun t => t.kind == .sent && t.id == 1)) "sent stamp for the second datagram"
+    for t in stamps do
+      ensure (t.id <= 1) "ids match the two sends"
+      ensure (t.timestamp.sec > 0) "timestamp is set"
+  catch e =>
+    ensure (toString e == "Operation not supported") s!"unexpected error: {e}"
+  server.close
+  client.close
+
 -- ========== Poll Tests ==========
 
 testSuite "Jack.Poll"
@@ -562,10 +820,305 @@ test "Poll.wait multiple sockets identifies correct socket" := do
   sock2.close
   sender.close
 
+-- ========== Timer Wheel Tests ==========
+
+testSuite "Jack.TimerWheel"
+
+test "TimerWheel fires timers in deadline order" := do
+  let w : TimerWheel String := TimerWheel.empty 1000
+  let w := w.insert 1 1050 "b"
+  let w := w.insert 2 1010 "a"
+  let w := w.insert 3 6000 "c"
+  ensure (w.size == 3) "three pending"
+  let (fired, w) := w.advance 1009
+  ensure fired.isEmpty "nothing due yet"
+  let (fired, w) := w.advance 1100
+  ensure (fired == #["a", "b"]) "near timers fire in order"
+  let (fired, w) := w.advance 5999
+  ensure fired.isEmpty "far timer not due"
+  let (fired, w) := w.advance 6000
+  ensure (fired == #["c"]) "far timer cascades and fires"
+  ensure w.isEmpty "wheel drained"
+
+test "TimerWheel cancel and reschedule" := do
+  let w : TimerWheel Nat := TimerWheel.empty 0
+  let w := w.insert 1 100 1
+  let w := w.insert 2 200 2
+  let w := w.cancel 1
+  ensure (!w.contains 1) "canceled timer removed"
+  let w := w.reschedule 2 50
+  let (fired, w) := w.advance 60
+  ensure (fired == #[2]) "rescheduled timer fires early"
+  let w := w.reschedule 2 500
+  ensure (w.size == 0) "reschedule of fired id is a no-op"
+
+test "TimerWheel nextDeadlineMs" := do
+  let w : TimerWheel Nat := TimerWheel.empty 0 10
+  ensure (w.nextDeadlineMs? == none) "empty wheel has no deadline"
+  let w := w.insert 1 95 1
+  match w.nextDeadlineMs? with
+  | some d => ensure (d ≤ 100 && d > 0) "next deadline within one tick"
+  | none => ensure false "expected deadline"
+
+test "PollSet add/modify/remove and wait" := do
+  let ps ← PollSet.new 2
+  let sock1 ← Socket.create .inet .dgram .udp
+  sock1.bindAddr (SockAddr.ipv4Loopback 0)
+  let addr1 ← sock1.getLocalAddr
+  let sock2 ← Socket.create .inet .dgram .udp
+  sock2.bindAddr (SockAddr.ipv4Loopback 0)
+  let sock3 ← Socket.create .inet .dgram .udp
+
+  let readable := PollEvent.readable.toBit
+  let slot1 ← ps.add sock1 readable
+  let slot2 ← ps.add sock2 readable
+  let slot3 ← ps.add sock3 readable
+  ensure ((← ps.size) == 3) "three registered (grew past capacity)"
+
+  let idle ← ps.wait 0
+  ensure idle.isEmpty "nothing ready"
+
+  sock3.sendTo "hi".toUTF8 addr1
+  let ready ← ps.wait 1000
+  ensure (ready == #[slot1]) "only sock1 ready"
+  ensure ((← ps.revents slot1) &&& readable != 0) "revents readable"
+
+  ps.modify slot3 PollEvent.writable.toBit
+  let ready ← ps.wait 0
+  ensure (ready.contains slot1 && ready.contains slot3) "writable slot reported"
+
+  ps.remove slot2
+  ensure ((← ps.size) == 2) "slot removed"
+  let reused ← ps.add sock2 readable
+  ensure (reused == slot2) "freed slot reused"
+
+  sock1.close
+  sock2.close
+  sock3.close
+
+-- ========== Drain Tests ==========
+
+testSuite "Jack.Drain"
+
+test "recvDrain reads until EAGAIN" := do
+  let (a, b) ← Socket.pair .unix .stream .default
+  b.setNonBlocking true
+  a.sendAll "hello ".toUTF8
+  a.sendAll "world".toUTF8
+  let r ← b.recvDrain 4096
+  ensure (String.fromUTF8! r.data == "hello world") "all queued data read"
+  ensure (!r.stillReady) "drained to EAGAIN"
+  ensure (!r.eof) "peer still open"
+  a.close
+  let r ← b.recvDrain 4096
+  ensure r.eof "eof after peer close"
+  b.close
+
+test "recvDrain respects budget" := do
+  let (a, b) ← Socket.pair .unix .stream .default
+  b.setNonBlocking true
+  a.sendAll "0123456789".toUTF8
+  let r ← b.recvDrain 4
+  ensure (r.data.size == 4) "budget bounds read"
+  ensure r.stillReady "more data pending"
+  a.close
+  b.close
+
+test "sendDrain writes queue and reports progress" := do
+  let (a, b) ← Socket.pair .unix .stream .default
+  a.setNonBlocking true
+  let queue := #["ab".toUTF8, ByteArray.empty, "cde".toUTF8]
+  let r ← a.sendDrain queue
+  ensure (r.bytes == 5) "all bytes written"
+  ensure (r.chunksSent == 3) "all chunks done"
+  ensure r.stillReady "queue emptied before EAGAIN"
+  let got ← b.recv 16
+  ensure (String.fromUTF8! got == "abcde") "peer received queue in order"
+  let part ← a.sendDrain queue (maxBytes := 3)
+  ensure (part.chunksSent == 2 && part.offset == 1) "stopped inside third chunk"
+  ensure ((part.remaining queue).map (·.size) == #[2]) "remaining trims sent bytes"
+  a.close
+  b.close
+
+test "acceptDrain accepts all pending connections" := do
+  let server ← Socket.new
+  server.bind "127.0.0.1" 0
+  server.listen 8
+  server.setNonBlocking true
+  let addr ← server.getLocalAddr
+  let c1 ← Socket.new
+  c1.connectAddr addr
+  let c2 ← Socket.new
+  c2.connectAddr addr
+  let _ ← server.poll #[.readable] 1000
+  IO.sleep 20
+  let r ← server.acceptDrain 16
+  ensure (r.sockets.size == 2) "both connections accepted"
+  ensure (!r.stillReady) "drained to EAGAIN"
+  for s in r.sockets do
+    s.close
+  c1.close
+  c2.close
+  server.close
+
+-- ========== Ring Buffer Tests ==========
+
+testSuite "Jack.RingBuffer"
+
+test "ring buffer wraps without compaction" := do
+  let rb ← RingBuffer.create 1
+  let cap ← rb.capacity
+  ensure (cap ≥ 1) "capacity rounded up"
+  -- Move the head near the end so the next write wraps.
+  let filler := ByteArray.mk (Array.replicate (cap.toNat - 3) 0)
+  let _ ← rb.write filler
+  rb.consume filler.size.toUInt32
+  let n ← rb.write "hello\nworld".toUTF8
+  ensure (n == 11) "write across the wrap point"
+  ensure ((← rb.readable) == 11) "readable count"
+  ensure ((← rb.indexOf "\n".toUTF8) == some 5) "delimiter found across wrap"
+  ensure ((← rb.byteAt 6) == 'w'.toNat.toUInt8) "byteAt"
+  match ← rb.readUntil "\n".toUTF8 with
+  | some line => ensure (String.fromUTF8! line == "hello\n") "line extracted"
+  | none => ensure false "expected a line"
+  ensure (String.fromUTF8! (← rb.read 16) == "world") "rest read"
+  ensure ((← rb.readable) == 0) "ring empty"
+
+test "recvIntoRing and sendFromRing" := do
+  let (a, b) ← Socket.pair .unix .stream .default
+  let rb ← RingBuffer.create 4096
+  a.sendAll "ping pong".toUTF8
+  let n ← b.recvIntoRing rb
+  ensure (n == 9) "received into ring"
+  let sent ← b.sendFromRing rb
+  ensure (sent == 9) "sent from ring"
+  ensure ((← rb.readable) == 0) "sent bytes consumed"
+  let echoed ← a.recv 16
+  ensure (String.fromUTF8! echoed == "ping pong") "echo through ring"
+  b.setNonBlocking true
+  match ← b.recvIntoRingTry rb with
+  | .wouldBlock => pure ()
+  | _ => ensure false "expected wouldBlock"
+  a.close
+  b.close
+
+-- ========== Shared-memory Channel Tests ==========
+
+testSuite "Jack.ShmChannel"
+
+test "ShmChannel message mode round trip" := do
+  let (a, b) ← Socket.pair .unix .stream .default
+  let acceptTask ← IO.asTask (ShmChannel.accept b)
+  let tx ← ShmChannel.connect a
+  let rx ← IO.ofExcept acceptTask.get
+  ensure (tx.usesSharedMemory == rx.usesSharedMemory) "both ends agree on transport"
+  tx.send "hello".toUTF8
+  tx.send ByteArray.empty
+  rx.send "back".toUTF8
+  ensure (String.fromUTF8! (← rx.recv) == "hello") "first message"
+  ensure ((← rx.recv).size == 0) "empty message kept as a message"
+  ensure (String.fromUTF8! (← tx.recv) == "back") "reverse direction"
+  tx.close
+  rx.close
+
+test "ShmChannel applies backpressure when the ring is full" := do
+  let (a, b) ← Socket.pair .unix .stream .default
+  let acceptTask ← IO.asTask (ShmChannel.accept b)
+  let tx ← ShmChannel.connect a { ringCapacity := 4096 }
+  let rx ← IO.ofExcept acceptTask.get
+  let msg := ByteArray.mk (Array.replicate 1000 7)
+  let sendTask ← IO.asTask do
+    for _ in [0:64] do
+      tx.send msg
+  let mut total := 0
+  for _ in [0:64] do
+    total := total + (← rx.recv).size
+  let _ ← IO.ofExcept sendTask.get
+  ensure (total == 64000) "all messages delivered through a small ring"
+  tx.close
+  rx.close
+
+test "ShmChannel stream mode delivers bytes in order" := do
+  let (a, b) ← Socket.pair .unix .stream .default
+  let acceptTask ← IO.asTask (ShmChannel.accept b)
+  let tx ← ShmChannel.connect a { mode := .stream, ringCapacity := 4096 }
+  let rx ← IO.ofExcept acceptTask.get
+  ensure (rx.mode == .stream) "acceptor adopts the connector's mode"
+  let data := ByteArray.mk ((Array.range 10000).map (·.toUInt8))
+  let sendTask ← IO.asTask (tx.sendBytes data)
+  let mut got := ByteArray.empty
+  while got.size < data.size do
+    got := got ++ (← rx.recvBytes 3000)
+  let _ ← IO.ofExcept sendTask.get
+  ensure (got.data == data.data) "stream contents preserved"
+  tx.close
+  rx.close
+
+test "ShmChannel falls back to the socket when disabled" := do
+  let (a, b) ← Socket.pair .unix .stream .default
+  let acceptTask ← IO.asTask (ShmChannel.accept b { enabled := false })
+  let tx ← ShmChannel.connect a
+  let rx ← IO.ofExcept acceptTask.get
+  ensure (!tx.usesSharedMemory && !rx.usesSharedMemory) "socket path on both ends"
+  tx.send "framed".toUTF8
+  tx.send "twice".toUTF8
+  ensure (String.fromUTF8! (← rx.recv) == "framed") "first framed message"
+  ensure (String.fromUTF8! (← rx.recv) == "twice") "second framed message"
+  tx.close
+  rx.close
+
 -- ========== Async Tests ==========
 
 testSuite "Jack.Async"
 
+test "command queue batches wakeups and keeps order" := do
+  let q : Jack.Async.CommandQueue Nat ← Jack.Async.CommandQueue.new
+  ensure ((← q.push 1) == .first) "first push into an empty queue asks for a wakeup"
+  ensure ((← q.push 2) == .queued) "second push rides on the same wakeup"
+  let _ ← q.push 3
+  ensure ((← q.drain) == #[1, 2, 3]) "drained oldest first"
+  ensure ((← q.push 4) == .first) "empty again after drain"
+  q.close
+  ensure ((← q.push 5) == .closed) "push after close is refused"
+  ensure ((← q.drain) == #[4]) "pushes after close are dropped"
+
+test "waits racing with reactor stop resolve with shutdown" := do
+  let (a, b) ← Socket.pair .unix .stream .default
+  for _ in [0:20] do
+    let reactor ← Jack.Async.Reactor.start
+    let stopper ← IO.asTask reactor.stop
+    let mut waits : Array (Task (Except Jack.Async.WaitError (Array PollEvent))) := #[]
+    for _ in [0:50] do
+      let (wait, _) ← reactor.awaitEventsCancelable b #[.readable]
+      waits := waits.push wait
+      let (nap, _) ← reactor.sleepCancelable 60000
+      waits := waits.push (nap.map fun r => r.map fun _ => (#[] : Array PollEvent))
+    let _ ← IO.wait stopper
+    for wait in waits do
+      match ← IO.wait wait with
+      | .error .shutdown => pure ()
+      | _ => ensure false "every wait settles with shutdown"
+  a.close
+  b.close
+
+test "command queue from many producers" := do
+  let q : Jack.Async.CommandQueue (Nat × UInt64) ← Jack.Async.CommandQueue.new
+  let producers ← (List.range 8).mapM fun p => IO.asTask do
+    for i in [0:1000] do
+      let _ ← q.push (p * 1000 + i, ← q.nextId)
+  for t in producers do
+    let _ ← IO.ofExcept t.get
+  let items ← q.drain
+  ensure (items.size == 8000) "every push drained"
+  let ids := items.map (·.2) |>.qsort (· < ·)
+  let mut unique := true
+  for i in [1:ids.size] do
+    if ids[i]! == ids[i-1]! then unique := false
+  ensure unique "ids are unique"
+  for p in [0:8] do
+    let mine := items.filter (fun (v, _) => v / 1000 == p) |>.map (·.1)
+    ensure (mine == (Array.range 1000).map (p * 1000 + ·)) s!"producer {p} order kept"
+
 test "recvFromAsync waits for data" := do
   let server ← Socket.create .inet .dgram .udp
   server.bindAddr (SockAddr.ipv4Loopback 0)
@@ -601,6 +1154,358 @@ test "connectAsync + acceptAsync" := do
   let _ ← IO.ofExcept acceptTask.get
   server.close
 
+test "async sleep waits on the timer wheel" := do
+  let start ← Jack.Async.nowMs
+  Jack.Async.sleep 30
+  let elapsed := (← Jack.Async.nowMs) - start
+  ensure (elapsed ≥ 30) s!"slept at least 30ms (got {elapsed})"
+
+test "recvAsync deadline times out" := do
+  let sock ← Socket.create .inet .dgram .udp
+  sock.bindAddr (SockAddr.ipv4Loopback 0)
+  let deadline ← Jack.Async.deadlineIn 20
+  let timedOut ← try
+    let _ ← Jack.Async.recvAsync sock 1024 (some deadline)
+    pure false
+  catch _ =>
+    pure true
+  ensure timedOut "recv past deadline should throw"
+  sock.close
+
+test "idle timer rearms on touch" := do
+  let timer ← Jack.Async.idleTimer 50
+  Jack.Async.sleep 30
+  timer.touch
+  Jack.Async.sleep 30
+  ensure (!(← timer.isExpired)) "touch pushed expiry out"
+  match ← IO.wait timer.expired with
+  | .ok _ => pure ()
+  | .error _ => ensure false "idle timer should expire"
+
+test "reactor pool routes accepted sockets" := do
+  let pool ← Jack.Async.ReactorPool.start 1
+  let server ← Socket.new
+  server.bind "127.0.0.1" 0
+  server.listen 1
+  let serverAddr ← server.getLocalAddr
+
+  let acceptTask ← IO.asTask do
+    let client ← pool.acceptAsync server
+    let data ← Jack.Async.recvAsync client 1024
+    client.close
+    return data
+
+  let client ← Socket.new
+  Jack.Async.connectAsync client serverAddr
+  let _ ← client.send "hi".toUTF8
+  let data ← IO.ofExcept acceptTask.get
+  ensure (String.fromUTF8! data == "hi") "routed reactor served recv"
+  client.close
+  server.close
+  pool.stop
+
+test "SO_INCOMING_CPU get/set" := do
+  let sock ← Socket.create .inet .dgram .udp
+  try
+    sock.setIncomingCpu 0
+    let _ ← sock.getIncomingCpu
+  catch e =>
+    if toString e != "Operation not supported" then
+      throw e
+  sock.close
+
+test "spinning reactor reports spin stats" := do
+  let reactor ← Jack.Async.Reactor.start { spinUs := 200 }
+  let server ← Socket.create .inet .dgram .udp
+  server.bindAddr (SockAddr.ipv4Loopback 0)
+  let serverAddr ← server.getLocalAddr
+  Jack.Async.bindSocket server reactor
+
+  -- An idle wait guarantees at least one spin phase before the timeout fires.
+  let (idle, _) ← Jack.Async.awaitEventsCancelable server #[.readable] (some (← Jack.Async.deadlineIn 5))
+  let _ ← IO.wait idle
+
+  let recvTask ← IO.asTask (Jack.Async.recvFromAsync server 1024)
+  let client ← Socket.create .inet .dgram .udp
+  client.sendTo "spin".toUTF8 serverAddr
+  let (data, _) ← IO.ofExcept recvTask.get
+  ensure (String.fromUTF8! data == "spin") "received via spinning reactor"
+
+  let stats ← reactor.getStats
+  ensure (stats.spinPolls > 0) "spin phase ran"
+  ensure (stats.spinEvents + stats.blockingEvents > 0) "events counted"
+  let ratio := stats.spinHitRatio
+  ensure (ratio >= 0.0 && ratio <= 1.0) "ratio in range"
+
+  Jack.Async.unbindSocket server
+  reactor.stop
+  server.close
+  client.close
+
+test "spinning reactor drains commands woken during the spin" := do
+  let reactor ← Jack.Async.Reactor.start { spinUs := 50000 }
+  -- A long timer keeps the reactor out of its idle wait, so it spins then blocks.
+  let (_, keepBusy) ← reactor.sleepCancelable 10000
+  IO.sleep 5
+  for _ in [0:5] do
+    let start ← IO.monoMsNow
+    let (nap, _) ← reactor.sleepCancelable 1
+    let _ ← IO.wait nap
+    ensure ((← IO.monoMsNow) - start < 500) "timer added mid-spin fires without waiting out the poll"
+  keepBusy.cancel
+  reactor.stop
+
+test "reactor binding does not follow a reused descriptor" := do
+  let reactor ← Jack.Async.Reactor.start { spinUs := 1 }
+  let first ← Socket.create .inet .dgram .udp
+  Jack.Async.bindSocket first reactor
+  ensure ((← Jack.Async.reactorFor first).config.spinUs == 1) "bound reactor serves the socket"
+  let fd := first.fd
+  first.close
+  ensure ((← Jack.Async.reactorFor first).config.spinUs == 0) "close released the binding"
+  let second ← Socket.create .inet .dgram .udp
+  ensure (second.id != first.id) "fresh socket id"
+  ensure (second.fd == fd) "descriptor reused"
+  ensure ((← Jack.Async.reactorFor second).config.spinUs == 0) "binding not inherited"
+  reactor.stop
+  second.close
+
+test "stale waiter is not woken by a reused descriptor" := do
+  let (old, oldPeer) ← Socket.pair .unix .stream .default
+  let (stale, _) ← Jack.Async.awaitEventsCancelable old #[.readable] (some (← Jack.Async.deadlineIn 2000))
+  IO.sleep 20
+  let fd := old.fd
+  old.close
+  -- The lowest free descriptor is handed out next; retry in case another thread took it.
+  let mut spare : Array Socket := #[]
+  let mut pair ← Socket.pair .unix .stream .default
+  for _ in [0:16] do
+    if pair.1.fd == fd then
+      break
+    spare := spare.push pair.1 |>.push pair.2
+    pair ← Socket.pair .unix .stream .default
+  let (fresh, freshPeer) := pair
+  ensure (fresh.fd == fd) "descriptor reused"
+  -- Same fd and interest as the closed socket: the core must register it anew.
+  freshPeer.sendAll "x".toUTF8
+  let (live, _) ← Jack.Async.awaitEventsCancelable fresh #[.readable] (some (← Jack.Async.deadlineIn 2000))
+  match ← IO.wait live with
+  | .ok events => ensure (events.contains .readable) "new socket sees its data"
+  | .error _ => ensure false "new socket wait failed"
+  match ← IO.wait stale with
+  | .ok events => ensure (!events.contains .readable && events.contains .error) "stale waiter gets an error"
+  | .error _ => ensure false "stale waiter should finish, not time out"
+  for sock in spare do
+    sock.close
+  oldPeer.close
+  fresh.close
+  freshPeer.close
+
+test "busy poll socket options" := do
+  let sock ← Socket.create .inet .dgram .udp
+  try
+    sock.setBusyPoll 0
+    let usec ← sock.getBusyPoll
+    ensure (usec == 0) "busy poll roundtrip"
+  catch e =>
+    if toString e != "Operation not supported" then
+      throw e
+  sock.close
+
+test "TCP Fast Open over loopback" := do
+  -- Needs net.ipv4.tcp_fastopen=3 for cookies; otherwise falls back to a normal handshake.
+  let server ← Socket.new
+  server.bind "127.0.0.1" 0
+  try server.setTcpFastOpen 16 catch _ => pure ()
+  server.listen 16
+  let serverAddr ← server.getLocalAddr
+
+  let acceptTask ← IO.asTask do
+    let client ← server.accept
+    let data ← client.recv 1024
+    client.close
+    return data
+
+  let client ← Socket.new
+  let sent ← client.connectWithData serverAddr "tfo".toUTF8
+  ensure (sent == 3) "initial data accepted"
+  let data ← IO.ofExcept acceptTask.get
+  ensure (String.fromUTF8! data == "tfo") "server received initial data"
+  client.close
+  server.close
+
+test "async TCP Fast Open connect" := do
+  let server ← Socket.new
+  server.bind "127.0.0.1" 0
+  try server.setTcpFastOpen 16 catch _ => pure ()
+  server.listen 16
+  let serverAddr ← server.getLocalAddr
+
+  let acceptTask ← IO.asTask do
+    let client ← server.accept
+    let data ← client.recv 1024
+    client.close
+    return data
+
+  let client ← Socket.new
+  Jack.Async.connectWithDataAsync client serverAddr "hello".toUTF8
+  let data ← IO.ofExcept acceptTask.get
+  ensure (String.fromUTF8! data == "hello") "server received data"
+  client.close
+  server.close
+
+test "task-returning recv resolves without a waiting thread" := do
+  let mut pairs : Array (Socket × Socket) := #[]
+  let mut tasks : Array (Jack.Async.AsyncTask ByteArray) := #[]
+  for _ in [0:256] do
+    let (a, b) ← Socket.pair .unix .stream .default
+    pairs := pairs.push (a, b)
+    tasks := tasks.push (← Jack.Async.recvTask b 16)
+  for task in tasks do
+    ensure (!(← IO.hasFinished task)) "pending until data arrives"
+  for (a, _) in pairs do
+    a.sendAll "x".toUTF8
+  for task in tasks do
+    let data ← IO.ofExcept (← IO.wait task)
+    ensure (String.fromUTF8! data == "x") "each recv completes"
+  for (a, b) in pairs do
+    a.close
+    b.close
+
+test "task-returning accept/connect/send chain" := do
+  let server ← Socket.new
+  server.bind "127.0.0.1" 0
+  server.listen 16
+  let serverAddr ← server.getLocalAddr
+  -- Echo one message: accept, then recv, then send, all chained with bindTask
+  let echo ← IO.bindTask (← Jack.Async.acceptTask server) fun
+    | .ok conn => do
+        IO.bindTask (← Jack.Async.recvTask conn 64) fun
+          | .ok data => Jack.Async.sendAllTask conn data
+          | .error e => pure (Task.pure (.error e))
+    | .error e => pure (Task.pure (.error e))
+  let client ← Socket.new
+  let _ ← IO.ofExcept (← IO.wait (← Jack.Async.connectTask client serverAddr))
+  let _ ← IO.ofExcept (← IO.wait (← Jack.Async.sendAllTask client "echo".toUTF8))
+  let _ ← IO.ofExcept (← IO.wait echo)
+  let reply ← IO.ofExcept (← IO.wait (← Jack.Async.recvTask client 64))
+  ensure (String.fromUTF8! reply == "echo") "echoed through the chain"
+  client.close
+  server.close
+
+test "task-returning recv honors deadlines" := do
+  let (a, b) ← Socket.pair .unix .stream .default
+  let task ← Jack.Async.recvTask b 16 (← Jack.Async.deadlineIn 20)
+  match ← IO.wait task with
+  | .ok _ => ensure false "expected timeout"
+  | .error e => ensure (toString e == "Async wait timed out") "timed out"
+  a.close
+  b.close
+
+test "recvExact collects split writes" := do
+  let (a, b) ← Socket.pair .unix .stream .default
+  let task ← Jack.Async.recvExactTask b 10
+  a.sendAll "01234".toUTF8
+  IO.sleep 10
+  a.sendAll "56789extra".toUTF8
+  let data ← IO.ofExcept (← IO.wait task)
+  ensure (String.fromUTF8! data == "0123456789") "exactly ten bytes"
+  let rest ← Jack.Async.recvExact b 5
+  ensure (String.fromUTF8! rest == "extra") "remaining bytes left in the socket"
+  match ← IO.wait (← Jack.Async.recvExactTask b (2 ^ 32 + 1)) with
+  | .error _ => pure ()
+  | .ok _ => ensure false "sizes past UInt32 are rejected, not wrapped"
+  a.close
+  b.close
+
+test "recvUntil stops at the delimiter" := do
+  let (a, b) ← Socket.pair .unix .stream .default
+  a.sendAll "GET / HTTP/1.1\r\n\r\nbody".toUTF8
+  let head ← Jack.Async.recvUntil b "\r\n\r\n".toUTF8
+  ensure (String.fromUTF8! head == "GET / HTTP/1.1\r\n\r\n") "header through delimiter"
+  let body ← Jack.Async.recvExact b 4
+  ensure (String.fromUTF8! body == "body") "bytes past the delimiter untouched"
+  a.sendAll "no delimiter here".toUTF8
+  try
+    let _ ← Jack.Async.recvUntil b "\n".toUTF8 (maxBytes := 8)
+    ensure false "expected limit error"
+  catch e =>
+    ensure (toString e == "Delimiter not found within limit") s!"unexpected error: {e}"
+  a.close
+  b.close
+
+test "sendAllAsync writes payloads larger than the socket buffer" := do
+  let (a, b) ← Socket.pair .unix .stream .default
+  let payload := ByteArray.mk (Array.replicate (4 * 1024 * 1024) 42)
+  let sendTask ← Jack.Async.sendAllTask a payload
+  let got ← Jack.Async.recvExact b payload.size
+  let _ ← IO.ofExcept (← IO.wait sendTask)
+  ensure (got.size == payload.size) "whole payload delivered"
+  a.close
+  b.close
+
+test "reactor serves a reader and a writer on one socket" := do
+  let (a, b) ← Socket.pair .unix .stream .default
+  b.setNonBlocking true
+  let (readTask, _) ← Jack.Async.awaitEventsCancelable b #[.readable]
+  let (writeTask, _) ← Jack.Async.awaitEventsCancelable b #[.writable]
+  match ← IO.wait writeTask with
+  | .ok events => ensure (events.contains .writable) "writer resolved"
+  | .error _ => ensure false "writer wait failed"
+  ensure (!(← IO.hasFinished readTask)) "reader still waiting"
+  a.sendAll "r".toUTF8
+  match ← IO.wait readTask with
+  | .ok events => ensure (events.contains .readable) "reader resolved"
+  | .error _ => ensure false "reader wait failed"
+  a.close
+  b.close
+
+test "sendQueueBytes counts unread data" := do
+  let (a, b) ← Socket.pair .unix .stream .default
+  a.sendAll (ByteArray.mk (Array.replicate 1000 7))
+  try
+    let queued ← a.sendQueueBytes
+    ensure (queued > 0) "unread bytes still charged to the sender"
+  catch e =>
+    ensure (toString e == "Operation not supported") s!"unexpected error: {e}"
+  a.close
+  b.close
+
+test "WriteQueue pauses at the high watermark and resumes at the low one" := do
+  let (a, b) ← Socket.pair .unix .stream .default
+  let q ← WriteQueue.new a { highWatermark := 64 * 1024, lowWatermark := 16 * 1024 }
+  let chunk := ByteArray.mk (Array.replicate (16 * 1024) 5)
+  let mut total := 0
+  let mut paused := false
+  for _ in [0:128] do
+    if !paused then
+      let r ← q.enqueue chunk
+      total := total + chunk.size
+      paused := r == .paused
+  ensure paused "producer told to pause"
+  ensure (!(← q.isWritable)) "queue not writable while paused"
+  ensure ((← q.queuedBytes) ≥ 64 * 1024) "backlog held in user space"
+  let writable ← q.whenWritable
+  let got ← Jack.Async.recvExact b total
+  IO.wait writable
+  ensure (got.size == total) "reactor flushed the whole backlog"
+  ensure (← q.isWritable) "writable again after draining"
+  ensure ((← q.queuedBytes) == 0) "queue empty"
+  a.close
+  b.close
+
+test "WriteQueue rejects data beyond its memory cap" := do
+  let (a, b) ← Socket.pair .unix .stream .default
+  let q ← WriteQueue.new a { maxBytes := 32 * 1024 }
+  let big ← q.enqueue (ByteArray.mk (Array.replicate (64 * 1024) 1))
+  ensure (big == .rejected) "over-cap data rejected"
+  let small ← q.enqueue "ok".toUTF8
+  ensure (small == .accepted) "small data accepted"
+  let got ← Jack.Async.recvExact b 2
+  ensure (String.fromUTF8! got == "ok") "only accepted data delivered"
+  a.close
+  b.close
+
 test "async shutdown" := do
   Jack.Async.shutdown
 
@@ -676,6 +1581,31 @@ test "sendMsg/recvMsg roundtrip" := do
   a.close
   b.close
 
+test "sendSlice sends a sub-range without copying" := do
+  let (a, b) ← Socket.pair .unix .stream .default
+  let data := "xxhello, worldyy".toUTF8
+  a.sendSlice (ByteSlice.ofRange data 2 12)
+  let got ← b.recv 64
+  ensure (String.fromUTF8! got == "hello, world") "only the viewed bytes sent"
+  let _ ← a.sendMsgSlices #[ByteSlice.ofRange data 2 5, ByteSlice.ofRange data 7 7]
+  let got ← b.recv 64
+  ensure (String.fromUTF8! got == "hello, world") "sendmsg over slices"
+  a.sendSlice (ByteSlice.ofRange data 14 100)
+  let got ← b.recv 64
+  ensure (String.fromUTF8! got == "yy") "oversized view clamped to the array"
+  a.close
+  b.close
+
+test "sendSliceAllAsync resumes partial writes in place" := do
+  let (a, b) ← Socket.pair .unix .stream .default
+  let payload := ByteArray.mk (Array.replicate (2 * 1024 * 1024) 9)
+  let writer ← IO.asTask (Jack.Async.sendSliceAllAsync a payload)
+  let got ← Jack.Async.recvExact b payload.size
+  let _ ← IO.ofExcept (← IO.wait writer)
+  ensure (got.size == payload.size) "whole payload delivered"
+  a.close
+  b.close
+
 test "sendMsgControl SCM_RIGHTS" := do
   let dir ← IO.FS.createTempDir
   let path : System.FilePath := dir / "jack_fdpass.txt"
@@ -733,6 +1663,45 @@ test "sendFile sends contents" := do
 
   IO.FS.removeFile path
 
+test "sendFileWith sends headers, body and trailers" := do
+  let path : System.FilePath := "/tmp/jack_sendfile_with_test.txt"
+  IO.FS.writeBinFile path "BODY".toUTF8
+
+  let server ← Socket.new
+  server.bind "127.0.0.1" 0
+  server.listen 1
+  let serverAddr ← server.getLocalAddr
+  let client ← Socket.new
+  client.connectAddr serverAddr
+  let peer ← server.accept
+
+  let headers := #["HTTP/1.1 200 OK\r\n".toUTF8, "\r\n".toUTF8]
+  let trailers := #["<end>".toUTF8]
+  let progress ← client.sendFileWith path.toString 0 0 headers trailers
+  ensure progress.complete "all parts sent"
+  ensure (progress.headerBytes == 19 && progress.bodyBytes == 4 && progress.trailerBytes == 5)
+    "per-part byte counts"
+  ensure (progress.total == 28) "total"
+
+  let mut got := ByteArray.empty
+  while got.size < 28 do
+    let chunk ← peer.recv 64
+    if chunk.isEmpty then break
+    got := got ++ chunk
+  ensure (String.fromUTF8! got == "HTTP/1.1 200 OK\r\n\r\nBODY<end>") "parts arrive in order"
+
+  let rejected ← try
+    let _ ← client.sendFileWith path.toString 0 10 headers trailers
+    pure false
+  catch _ =>
+    pure true
+  ensure rejected "range past EOF is not framed as complete"
+
+  peer.close
+  client.close
+  server.close
+  IO.FS.removeFile path
+
 test "out-of-band data" := do
   let server ← Socket.new
   server.bind "127.0.0.1" 0
@@ -1031,6 +2000,89 @@ test "set/get IPV6_V6ONLY" := do
   ensure (roundtrip == initial) "option roundtrip"
   sock.close
 
+test "tcpInfo on connected socket" := do
+  let server ← Socket.new
+  server.bind "127.0.0.1" 0
+  server.listen 1
+  let serverAddr ← server.getLocalAddr
+  let client ← Socket.new
+  client.connectAddr serverAddr
+  let peer ← server.accept
+  client.sendAll "ping".toUTF8
+  let _ ← peer.recv 4
+  try
+    let info ← client.tcpInfo
+    ensure (info.state == 1) "established"
+    ensure (info.bytesAcked ≥ 4 || info.unacked > 0) "data accounted"
+    let many ← Socket.tcpInfoMany #[client, peer]
+    ensure (many.size == 2) "one sample per socket"
+    ensure (many.all Option.isSome) "both sampled"
+  catch e =>
+    if toString e != "Operation not supported" then
+      throw e
+  peer.close
+  client.close
+  server.close
+
+-- ========== Listener Group Tests ==========
+
+testSuite "Jack.ListenerGroup"
+
+test "reuseport TCP group accepts on every listener" := do
+  let group ← ListenerGroup.create (SockAddr.ipv4Loopback 0) { size := 2 }
+  ensure (group.sockets.size == 2) "one socket per loop"
+  let accepted ← IO.mkRef (0 : Nat)
+  let loops ← group.serve fun _ client => do
+    accepted.modify (· + 1)
+    client.close
+  for _ in [0:4] do
+    let client ← Socket.new
+    client.connectAddr group.addr
+    client.close
+  let mut waited := 0
+  while (← accepted.get) < 4 && waited < 200 do
+    IO.sleep 10
+    waited := waited + 1
+  group.stop loops
+  ensure ((← accepted.get) == 4) "all connections accepted"
+
+test "shared TCP group uses one socket" := do
+  let group ← ListenerGroup.create (SockAddr.ipv4Loopback 0) { size := 3, mode := .shared }
+  ensure (group.sockets.size == 1) "single shared socket"
+  ensure (group.loops == 3) "three accept loops"
+  let loops ← group.serve fun _ client => client.close
+  let client ← Socket.new
+  client.connectAddr group.addr
+  client.close
+  group.stop loops
+
+test "reuseport UDP group receives datagrams" := do
+  let group ← ListenerGroup.create (SockAddr.ipv4Loopback 0) { size := 2, sockType := .dgram }
+  let received ← IO.mkRef (0 : Nat)
+  let loops ← group.serveDatagrams 1024 fun _ _ data _ => do
+    if String.fromUTF8! data == "ping" then
+      received.modify (· + 1)
+  let client ← Socket.create .inet .dgram .udp
+  client.sendTo "ping".toUTF8 group.addr
+  let mut waited := 0
+  while (← received.get) < 1 && waited < 200 do
+    IO.sleep 10
+    waited := waited + 1
+  client.close
+  group.stop loops
+  ensure ((← received.get) == 1) "datagram received"
+
+test "cpu steering program attaches when supported" := do
+  let group ← try
+    ListenerGroup.create (SockAddr.ipv4Loopback 0) { size := 2, cpuSteering := true }
+  catch e =>
+    if toString e == "Operation not supported" || toString e == "Invalid argument" then
+      return ()
+    else
+      throw e
+  ensure (group.sockets.size == 2) "group created with steering"
+  group.stop
+
 -- ========== Multicast/Broadcast Tests ==========
 
 testSuite "Jack.Multicast"
@@ -1109,6 +2161,60 @@ test "ipv6 multicast join/leave" := do
       if skipped then
         ensure true "ipv6 multicast not supported"
 
+-- ========== Load Generator Tests ==========
+
+testSuite "Jack.Loadgen"
+
+test "Histogram keeps three significant digits" := do
+  let h := (List.range 1000).foldl (fun h i => h.record ((i + 1) * 1000)) (Loadgen.Histogram.new 60000000)
+  ensure (h.totalCount == 1000) "all values counted"
+  ensure (h.minValue == 1000 && h.maxValue == 1000000) "exact min and max"
+  let p50 := h.valueAtPercentile 50.0
+  ensure (p50 ≥ 500000 && p50 ≤ 500500) s!"p50 within 0.1%: {p50}"
+  let p99 := h.valueAtPercentile 99.0
+  ensure (p99 ≥ 990000 && p99 ≤ 991000) s!"p99 within 0.1%: {p99}"
+  ensure (h.valueAtPercentile 100.0 == 1000000) "p100 is the maximum"
+  ensure (h.highestEquivalent 1500 == 1500) "small values are exact"
+
+test "Histogram merge and saturation" := do
+  let a := (Loadgen.Histogram.new 1000).record 10 (count := 3)
+  let b := ((Loadgen.Histogram.new 1000).record 20).record 5000
+  let m := a.merge b
+  ensure (m.totalCount == 5) "counts added"
+  ensure (m.saturated == 1 && m.maxValue == 1000) "out-of-range value clamped"
+  ensure (m.buckets.foldl (fun acc (_, c) => acc + c) 0 == 5) "buckets cover every value"
+
+test "open-loop run against a loopback echo server" := do
+  let server ← Socket.create .inet .stream .tcp
+  server.bindAddr (SockAddr.ipv4Loopback 0)
+  server.listen 16
+  let port := ((← server.getLocalAddr).port).getD 0
+  let serverTask ← IO.asTask do
+    let mut clients := #[]
+    for _ in [0:2] do
+      let client ← server.accept
+      let echo ← IO.asTask do
+        let mut connected := true
+        while connected do
+          let data ← client.recv 4096
+          if data.size == 0 then
+            connected := false
+          else
+            client.sendAll data
+        client.close
+      clients := clients.push echo
+    for t in clients do
+      let _ ← IO.wait t
+  let result ← Loadgen.run {
+    port, rate := 400, durationMs := 250, connections := 2, reactors := 1
+    requestSize := 32, drainMs := 1000 }
+  ensure (result.sent > 50) s!"requests sent on schedule: {result.sent}"
+  ensure (result.received == result.sent) "every request answered"
+  ensure (result.latency.totalCount == result.received) "one latency per response"
+  ensure result.errors.isEmpty s!"no errors: {result.errors}"
+  let _ ← IO.wait serverTask
+  server.close
+
 -- ========== Benchmarks ==========
 
 namespace Bench
@@ -3,12 +3,17 @@
  * BSD socket bindings using POSIX sockets
  */
 
+#ifdef __linux__
+#define _GNU_SOURCE
+#endif
+
 #include <lean/lean.h>
 #include <sys/socket.h>
 #include <sys/un.h>
 #include <netinet/in.h>
 #include <netinet/ip6.h>
 #include <netinet/tcp.h>
+#include <net/if.h>
 #include <arpa/inet.h>
 #include <netdb.h>
 #include <unistd.h>
@@ -18,16 +23,33 @@
 #include <poll.h>
 #include <stdio.h>
 #include <sys/uio.h>
+#include <sys/ioctl.h>
 #include <sys/stat.h>
 #include <sys/time.h>
+#include <time.h>
+#include <sys/mman.h>
+#include <stdatomic.h>
 #include <limits.h>
 #include <stddef.h>
+#include <pthread.h>
 #if defined(__has_include)
 #if __has_include(<sys/sendfile.h>)
 #include <sys/sendfile.h>
 #define JACK_HAVE_SENDFILE 1
 #endif
 #endif
+#ifdef __linux__
+#include <linux/filter.h>
+#include <linux/net_tstamp.h>
+#include <linux/errqueue.h>
+#include <sched.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#endif
+
+/* Chunk size and iovec batch used by the drain and multi-buffer send loops */
+#define JACK_DRAIN_CHUNK (64 * 1024)
+#define JACK_DRAIN_IOV 64
 
 /* ========== Socket Option Constants ========== */
 
@@ -156,11 +178,93 @@ LEAN_EXPORT lean_obj_res jack_const_msg_nosignal(lean_obj_arg world) {
 #endif
 }
 
-/* Socket handle - just wraps a file descriptor */
+/* Socket handle: a file descriptor in a slot of the handle slab. `slot` and
+ * `gen` form the socket's stable id; `gen` changes every time the slot is
+ * handed out again, so an id never names two sockets. */
 typedef struct {
     int fd;
+    uint32_t slot;
+    uint32_t gen;
+    uint32_t next_free;
+    uint32_t recv_hint;   /* adaptive receive size, 0 until learned */
+    uint32_t recv_small;  /* consecutive reads well under recv_hint */
+    atomic_flag binding_lock;
+    lean_object *binding; /* reactor serving async waits, or NULL; under binding_lock */
 } jack_socket_t;
 
+/* Handle slab: fixed-size pages that are never freed (handles stay put), with
+ * a free list of slots threaded through `next_free`. */
+#define JACK_SLAB_PAGE 256
+#define JACK_SLAB_NONE UINT32_MAX
+
+static pthread_mutex_t g_slab_lock = PTHREAD_MUTEX_INITIALIZER;
+static jack_socket_t **g_slab_pages = NULL;
+static uint32_t g_slab_npages = 0;
+static uint32_t g_slab_free = JACK_SLAB_NONE;
+
+static int jack_slab_grow(void) {
+    jack_socket_t **pages = realloc(g_slab_pages, (g_slab_npages + 1) * sizeof(jack_socket_t *));
+    if (!pages) return -1;
+    g_slab_pages = pages;
+    jack_socket_t *page = calloc(JACK_SLAB_PAGE, sizeof(jack_socket_t));
+    if (!page) return -1;
+    uint32_t base = g_slab_npages * JACK_SLAB_PAGE;
+    for (uint32_t i = 0; i < JACK_SLAB_PAGE; i++) {
+        page[i].fd = -1;
+        page[i].slot = base + i;
+        page[i].next_free = i + 1 < JACK_SLAB_PAGE ? base + i + 1 : g_slab_free;
+    }
+    g_slab_pages[g_slab_npages++] = page;
+    g_slab_free = base;
+    return 0;
+}
+
+/* Take a slab slot for `fd`. Returns NULL (fd untouched) if the slab cannot grow. */
+static jack_socket_t *jack_socket_alloc(int fd) {
+    pthread_mutex_lock(&g_slab_lock);
+    if (g_slab_free == JACK_SLAB_NONE && jack_slab_grow() < 0) {
+        pthread_mutex_unlock(&g_slab_lock);
+        return NULL;
+    }
+    uint32_t slot = g_slab_free;
+    jack_socket_t *sock = &g_slab_pages[slot / JACK_SLAB_PAGE][slot % JACK_SLAB_PAGE];
+    g_slab_free = sock->next_free;
+    sock->gen++;
+    sock->fd = fd;
+    sock->recv_hint = 0;
+    sock->recv_small = 0;
+    pthread_mutex_unlock(&g_slab_lock);
+    return sock;
+}
+
+static void jack_socket_release(jack_socket_t *sock) {
+    pthread_mutex_lock(&g_slab_lock);
+    sock->fd = -1;
+    sock->next_free = g_slab_free;
+    g_slab_free = sock->slot;
+    pthread_mutex_unlock(&g_slab_lock);
+}
+
+/* Replace the handle's reactor binding (NULL clears it); returns the old one for
+ * the caller to drop outside the lock. */
+static lean_object *jack_socket_swap_binding(jack_socket_t *sock, lean_object *binding) {
+    while (atomic_flag_test_and_set_explicit(&sock->binding_lock, memory_order_acquire)) {
+    }
+    lean_object *old = sock->binding;
+    sock->binding = binding;
+    atomic_flag_clear_explicit(&sock->binding_lock, memory_order_release);
+    return old;
+}
+
+static void jack_socket_drop_binding(jack_socket_t *sock) {
+    lean_object *old = jack_socket_swap_binding(sock, NULL);
+    if (old) lean_dec(old);
+}
+
+static inline uint64_t jack_socket_id_of(const jack_socket_t *sock) {
+    return ((uint64_t)sock->gen << 32) | sock->slot;
+}
+
 static lean_external_class *g_socket_class = NULL;
 
 static void jack_socket_finalizer(void *ptr) {
@@ -168,7 +272,8 @@ static void jack_socket_finalizer(void *ptr) {
     if (sock->fd >= 0) {
         close(sock->fd);
     }
-    free(sock);
+    jack_socket_drop_binding(sock);
+    jack_socket_release(sock);
 }
 
 static void jack_socket_foreach(void *ptr, b_lean_obj_arg f) {
@@ -273,12 +378,35 @@ static lean_obj_res jack_socket_result_error(int err) {
 
 /* ========== Address Conversion ========== */
 
-/* Parse IPv6 address string. Returns empty ByteArray on failure. */
+/* Copy an IPv6 literal into buf, dropping surrounding brackets and splitting off
+ * a "%scope" suffix (returned in *scope, or NULL). Returns 0 on success. */
+static int jack_ipv6_literal(b_lean_obj_arg addr_str, char *buf, size_t cap, const char **scope) {
+    const char *src = lean_string_cstr(addr_str);
+    size_t len = lean_string_size(addr_str) - 1;
+    if (len >= 2 && src[0] == '[' && src[len - 1] == ']') {
+        src++;
+        len -= 2;
+    }
+    if (len == 0 || len >= cap) return -1;
+    memcpy(buf, src, len);
+    buf[len] = '\0';
+    char *pct = memchr(buf, '%', len);
+    *scope = NULL;
+    if (pct) {
+        *pct = '\0';
+        *scope = pct + 1;
+    }
+    return 0;
+}
+
+/* Parse IPv6 address string (optionally bracketed). Returns empty ByteArray on failure. */
 LEAN_EXPORT lean_obj_res jack_ipv6_parse(b_lean_obj_arg addr_str) {
-    const char *addr_cstr = lean_string_cstr(addr_str);
+    char buf[INET6_ADDRSTRLEN + IF_NAMESIZE + 2];
+    const char *scope;
     struct in6_addr addr;
 
-    if (inet_pton(AF_INET6, addr_cstr, &addr) != 1) {
+    if (jack_ipv6_literal(addr_str, buf, sizeof(buf), &scope) != 0 || scope != NULL ||
+        inet_pton(AF_INET6, buf, &addr) != 1) {
         return lean_alloc_sarray(1, 0, 0);
     }
 
@@ -287,6 +415,79 @@ LEAN_EXPORT lean_obj_res jack_ipv6_parse(b_lean_obj_arg addr_str) {
     return bytes;
 }
 
+static uint64_t jack_load_be64(const uint8_t *p) {
+    uint64_t v = 0;
+    for (int i = 0; i < 8; i++) v = (v << 8) | p[i];
+    return v;
+}
+
+static void jack_store_be64(uint8_t *p, uint64_t v) {
+    for (int i = 7; i >= 0; i--) {
+        p[i] = (uint8_t)v;
+        v >>= 8;
+    }
+}
+
+/* Parse an IPv6 literal with an optional "%scope" (numeric or interface name) into
+ * Option PackedIPv6 { hi : UInt64, lo : UInt64, scopeId : UInt32 }. */
+LEAN_EXPORT lean_obj_res jack_ipv6_parse_packed(b_lean_obj_arg addr_str) {
+    char buf[INET6_ADDRSTRLEN + IF_NAMESIZE + 2];
+    const char *scope;
+    struct in6_addr addr;
+    uint32_t scope_id = 0;
+
+    if (jack_ipv6_literal(addr_str, buf, sizeof(buf), &scope) != 0 ||
+        inet_pton(AF_INET6, buf, &addr) != 1) {
+        return lean_box(0);
+    }
+    if (scope != NULL) {
+        char *end;
+        unsigned long n = strtoul(scope, &end, 10);
+        if (*scope != '\0' && *end == '\0' && n <= UINT32_MAX) {
+            scope_id = (uint32_t)n;
+        } else {
+            scope_id = if_nametoindex(scope);
+            if (scope_id == 0) return lean_box(0);
+        }
+    }
+
+    lean_obj_res packed = lean_alloc_ctor(0, 0, 8 + 8 + 4);
+    lean_ctor_set_uint64(packed, 0, jack_load_be64(addr.s6_addr));
+    lean_ctor_set_uint64(packed, 8, jack_load_be64(addr.s6_addr + 8));
+    lean_ctor_set_uint32(packed, 16, scope_id);
+    lean_obj_res some = lean_alloc_ctor(1, 1, 0);
+    lean_ctor_set(some, 0, packed);
+    return some;
+}
+
+/* Format 16 network-order bytes as RFC 5952 text ("::1", "2001:db8::1", "::ffff:1.2.3.4").
+ * scope_id, when non-zero, is appended as "%<id>". */
+static lean_obj_res jack_ipv6_format_raw(const uint8_t *bytes, uint32_t scope_id) {
+    char buf[INET6_ADDRSTRLEN + 12];
+    if (inet_ntop(AF_INET6, bytes, buf, INET6_ADDRSTRLEN) == NULL) {
+        return lean_mk_string("");
+    }
+    if (scope_id != 0) {
+        size_t len = strlen(buf);
+        snprintf(buf + len, sizeof(buf) - len, "%%%u", scope_id);
+    }
+    return lean_mk_string(buf);
+}
+
+LEAN_EXPORT lean_obj_res jack_ipv6_format(b_lean_obj_arg bytes) {
+    if (lean_sarray_size(bytes) != 16) {
+        return lean_mk_string("");
+    }
+    return jack_ipv6_format_raw(lean_sarray_cptr(bytes), 0);
+}
+
+LEAN_EXPORT lean_obj_res jack_ipv6_format_packed(uint64_t hi, uint64_t lo, uint32_t scope_id) {
+    uint8_t bytes[16];
+    jack_store_be64(bytes, hi);
+    jack_store_be64(bytes + 8, lo);
+    return jack_ipv6_format_raw(bytes, scope_id);
+}
+
 /* Convert Lean SockAddr to C sockaddr_storage
  * Returns 0 on success, -1 on error
  * SockAddr is:
@@ -466,6 +667,109 @@ static lean_obj_res sockaddr_to_lean(struct sockaddr *addr, socklen_t len) {
     return result;
 }
 
+/* ========== Prepared Addresses ========== */
+
+/* A sockaddr encoded once and reused by every send/connect that takes it, so hot
+ * paths skip walking the Lean SockAddr (or running inet_pton) on each call. */
+typedef struct {
+    struct sockaddr_storage sa;
+    socklen_t len;
+} jack_prepared_addr_t;
+
+static lean_external_class *g_prepared_addr_class = NULL;
+
+static void jack_prepared_addr_finalizer(void *ptr) {
+    free(ptr);
+}
+
+static void jack_prepared_addr_foreach(void *ptr, b_lean_obj_arg f) {
+    /* No nested Lean objects */
+}
+
+static inline jack_prepared_addr_t *jack_prepared_addr_unbox(b_lean_obj_arg obj) {
+    return (jack_prepared_addr_t *)lean_get_external_data(obj);
+}
+
+static lean_obj_res jack_prepared_addr_box(const struct sockaddr_storage *sa, socklen_t len) {
+    jack_prepared_addr_t *p = malloc(sizeof(jack_prepared_addr_t));
+    if (!p) {
+        return NULL;
+    }
+    memcpy(&p->sa, sa, sizeof(p->sa));
+    p->len = len;
+    if (g_prepared_addr_class == NULL) {
+        g_prepared_addr_class = lean_register_external_class(
+            jack_prepared_addr_finalizer, jack_prepared_addr_foreach);
+    }
+    return lean_alloc_external(g_prepared_addr_class, p);
+}
+
+/* Encode a SockAddr once */
+LEAN_EXPORT lean_obj_res jack_prepared_addr_of_sockaddr(
+    b_lean_obj_arg addr,
+    lean_obj_arg world
+) {
+    (void)world;
+    struct sockaddr_storage sa;
+    socklen_t sa_len;
+    if (lean_to_sockaddr(addr, &sa, &sa_len) < 0) {
+        return lean_io_result_mk_error(lean_mk_io_user_error(
+            lean_mk_string("Invalid address")));
+    }
+    lean_obj_res obj = jack_prepared_addr_box(&sa, sa_len);
+    if (!obj) {
+        return jack_io_error_from_errno(ENOMEM);
+    }
+    return lean_io_result_mk_ok(obj);
+}
+
+/* Parse a numeric IPv4 or IPv6 host once (inet_pton) */
+LEAN_EXPORT lean_obj_res jack_prepared_addr_parse(
+    b_lean_obj_arg host,
+    uint16_t port,
+    lean_obj_arg world
+) {
+    (void)world;
+    const char *host_str = lean_string_cstr(host);
+    struct sockaddr_storage sa;
+    socklen_t sa_len;
+    memset(&sa, 0, sizeof(sa));
+
+    struct sockaddr_in *sin = (struct sockaddr_in *)&sa;
+    struct sockaddr_in6 *sin6 = (struct sockaddr_in6 *)&sa;
+    if (inet_pton(AF_INET, host_str, &sin->sin_addr) == 1) {
+        sin->sin_family = AF_INET;
+        sin->sin_port = htons(port);
+        sa_len = sizeof(struct sockaddr_in);
+    } else if (inet_pton(AF_INET6, host_str, &sin6->sin6_addr) == 1) {
+        sin6->sin6_family = AF_INET6;
+        sin6->sin6_port = htons(port);
+        sa_len = sizeof(struct sockaddr_in6);
+    } else {
+        return lean_io_result_mk_error(lean_mk_io_user_error(
+            lean_mk_string("Invalid address")));
+    }
+
+    lean_obj_res obj = jack_prepared_addr_box(&sa, sa_len);
+    if (!obj) {
+        return jack_io_error_from_errno(ENOMEM);
+    }
+    return lean_io_result_mk_ok(obj);
+}
+
+/* Decode back to a SockAddr (for logging; not needed on the send path) */
+LEAN_EXPORT lean_obj_res jack_prepared_addr_to_sockaddr(b_lean_obj_arg obj) {
+    jack_prepared_addr_t *p = jack_prepared_addr_unbox(obj);
+    return sockaddr_to_lean((struct sockaddr *)&p->sa, p->len);
+}
+
+/* Byte-wise equality of the encoded addresses */
+LEAN_EXPORT uint8_t jack_prepared_addr_eq(b_lean_obj_arg a_obj, b_lean_obj_arg b_obj) {
+    jack_prepared_addr_t *a = jack_prepared_addr_unbox(a_obj);
+    jack_prepared_addr_t *b = jack_prepared_addr_unbox(b_obj);
+    return a->len == b->len && memcmp(&a->sa, &b->sa, a->len) == 0;
+}
+
 /* ========== DNS Resolution ========== */
 
 LEAN_EXPORT lean_obj_res jack_resolve_host_port(
@@ -799,19 +1103,18 @@ LEAN_EXPORT lean_obj_res jack_socket_set_multicast_loop6(
 
 /* Create a new TCP socket */
 LEAN_EXPORT lean_obj_res jack_socket_new(lean_obj_arg world) {
-    jack_socket_t *sock = malloc(sizeof(jack_socket_t));
+    int fd = socket(AF_INET, SOCK_STREAM, 0);
+    if (fd < 0) {
+        return jack_io_error_from_errno(errno);
+    }
+
+    jack_socket_t *sock = jack_socket_alloc(fd);
     if (!sock) {
+        close(fd);
         return lean_io_result_mk_error(lean_mk_io_user_error(
             lean_mk_string("Failed to allocate socket")));
     }
 
-    sock->fd = socket(AF_INET, SOCK_STREAM, 0);
-    if (sock->fd < 0) {
-        int err = errno;
-        free(sock);
-        return jack_io_error_from_errno(err);
-    }
-
     /* Set SO_REUSEADDR */
     int opt = 1;
     setsockopt(sock->fd, SOL_SOCKET, SO_REUSEADDR, &opt, sizeof(opt));
@@ -859,19 +1162,18 @@ LEAN_EXPORT lean_obj_res jack_socket_create(
         default: proto = 0; break;
     }
 
-    jack_socket_t *sock = malloc(sizeof(jack_socket_t));
+    int fd = socket(af, st, proto);
+    if (fd < 0) {
+        return jack_io_error_from_errno(errno);
+    }
+
+    jack_socket_t *sock = jack_socket_alloc(fd);
     if (!sock) {
+        close(fd);
         return lean_io_result_mk_error(lean_mk_io_user_error(
             lean_mk_string("Failed to allocate socket")));
     }
 
-    sock->fd = socket(af, st, proto);
-    if (sock->fd < 0) {
-        int err = errno;
-        free(sock);
-        return jack_io_error_from_errno(err);
-    }
-
     /* Set SO_REUSEADDR for stream sockets */
     if (st == SOCK_STREAM) {
         int opt = 1;
@@ -922,18 +1224,15 @@ LEAN_EXPORT lean_obj_res jack_socket_pair(
         return jack_io_error_from_errno(errno);
     }
 
-    jack_socket_t *sock_a = malloc(sizeof(jack_socket_t));
-    jack_socket_t *sock_b = malloc(sizeof(jack_socket_t));
+    jack_socket_t *sock_a = jack_socket_alloc(fds[0]);
+    jack_socket_t *sock_b = sock_a ? jack_socket_alloc(fds[1]) : NULL;
     if (!sock_a || !sock_b) {
-        if (sock_a) free(sock_a);
-        if (sock_b) free(sock_b);
+        if (sock_a) jack_socket_release(sock_a);
         close(fds[0]);
         close(fds[1]);
         return lean_io_result_mk_error(lean_mk_io_user_error(
             lean_mk_string("Failed to allocate socket pair")));
     }
-    sock_a->fd = fds[0];
-    sock_b->fd = fds[1];
 
     if (st == SOCK_STREAM) {
         struct timeval timeout;
@@ -1059,6 +1358,42 @@ LEAN_EXPORT lean_obj_res jack_socket_connect_addr_try(
     return lean_io_result_mk_ok(jack_socket_result_ok(lean_box(0)));
 }
 
+/* Connect using a prepared address */
+LEAN_EXPORT lean_obj_res jack_socket_connect_prepared(
+    b_lean_obj_arg sock_obj,
+    b_lean_obj_arg addr_obj,
+    lean_obj_arg world
+) {
+    jack_socket_t *sock = jack_socket_unbox(sock_obj);
+    jack_prepared_addr_t *addr = jack_prepared_addr_unbox(addr_obj);
+
+    if (connect(sock->fd, (struct sockaddr *)&addr->sa, addr->len) < 0) {
+        return jack_io_error_from_errno(errno);
+    }
+
+    return lean_io_result_mk_ok(lean_box(0));
+}
+
+/* Connect using a prepared address (non-blocking try) */
+LEAN_EXPORT lean_obj_res jack_socket_connect_prepared_try(
+    b_lean_obj_arg sock_obj,
+    b_lean_obj_arg addr_obj,
+    lean_obj_arg world
+) {
+    jack_socket_t *sock = jack_socket_unbox(sock_obj);
+    jack_prepared_addr_t *addr = jack_prepared_addr_unbox(addr_obj);
+
+    if (connect(sock->fd, (struct sockaddr *)&addr->sa, addr->len) < 0) {
+        int err = errno;
+        if (is_wouldblock_error(err)) {
+            return lean_io_result_mk_ok(jack_socket_result_wouldblock());
+        }
+        return lean_io_result_mk_ok(jack_socket_result_error(err));
+    }
+
+    return lean_io_result_mk_ok(jack_socket_result_ok(lean_box(0)));
+}
+
 /* ========== Binding ========== */
 
 /* Bind socket to address */
@@ -1143,13 +1478,12 @@ LEAN_EXPORT lean_obj_res jack_socket_accept(
         return jack_io_error_from_errno(errno);
     }
 
-    jack_socket_t *client = malloc(sizeof(jack_socket_t));
+    jack_socket_t *client = jack_socket_alloc(client_fd);
     if (!client) {
         close(client_fd);
         return lean_io_result_mk_error(lean_mk_io_user_error(
             lean_mk_string("Failed to allocate client socket")));
     }
-    client->fd = client_fd;
 
     /* Set recv/send timeouts to 5 seconds on client socket */
     struct timeval timeout;
@@ -1180,12 +1514,11 @@ LEAN_EXPORT lean_obj_res jack_socket_accept_try(
         return lean_io_result_mk_ok(jack_socket_result_error(err));
     }
 
-    jack_socket_t *client = malloc(sizeof(jack_socket_t));
+    jack_socket_t *client = jack_socket_alloc(client_fd);
     if (!client) {
         close(client_fd);
         return lean_io_result_mk_ok(jack_socket_result_error(ENOMEM));
     }
-    client->fd = client_fd;
 
     /* Set recv/send timeouts to 5 seconds on client socket */
     struct timeval timeout;
@@ -1220,6 +1553,25 @@ static lean_obj_res jack_socket_send_loop(jack_socket_t *sock, const uint8_t *pt
     return jack_socket_send_loop_flags(sock, ptr, len, 0);
 }
 
+/* ByteSlice: { data : ByteArray, offset : Nat, size : Nat }, all boxed.
+ * The view is clamped to the array, so a stale or oversized slice never reads past it. */
+static const uint8_t *jack_byte_slice_view(b_lean_obj_arg slice, size_t *len) {
+    b_lean_obj_arg data = lean_ctor_get(slice, 0);
+    b_lean_obj_arg off_obj = lean_ctor_get(slice, 1);
+    b_lean_obj_arg size_obj = lean_ctor_get(slice, 2);
+    size_t total = lean_sarray_size(data);
+    size_t off = lean_is_scalar(off_obj) ? lean_unbox(off_obj) : SIZE_MAX;
+    size_t n = lean_is_scalar(size_obj) ? lean_unbox(size_obj) : SIZE_MAX;
+    if (off > total) {
+        off = total;
+    }
+    if (n > total - off) {
+        n = total - off;
+    }
+    *len = n;
+    return lean_sarray_cptr(data) + off;
+}
+
 /* Receive data */
 LEAN_EXPORT lean_obj_res jack_socket_recv(
     b_lean_obj_arg sock_obj,
@@ -1307,6 +1659,122 @@ LEAN_EXPORT lean_obj_res jack_socket_recv_try(
     return lean_io_result_mk_ok(jack_socket_result_ok(arr));
 }
 
+/* Receive exactly what the kernel has queued (FIONREAD/SIOCINQ), at most `cap`
+ * bytes, into a ByteArray of that size. With nothing queued it waits the way
+ * recv does (a 1-byte MSG_PEEK). EOF gives an empty array. Returns NULL with
+ * *err set on failure. */
+static lean_obj_res jack_recv_available(jack_socket_t *sock, uint32_t cap, int flags, int *err) {
+    int queued = 0;
+    if (ioctl(sock->fd, FIONREAD, &queued) < 0) {
+        *err = errno;
+        return NULL;
+    }
+    if (queued <= 0) {
+        uint8_t probe;
+        ssize_t n = recv(sock->fd, &probe, 1, MSG_PEEK | flags);
+        if (n < 0) {
+            *err = errno;
+            return NULL;
+        }
+        if (n == 0) {
+            return lean_alloc_sarray(1, 0, 0);
+        }
+        if (ioctl(sock->fd, FIONREAD, &queued) < 0 || queued <= 0) {
+            queued = 1;
+        }
+    }
+    size_t want = (size_t)queued < cap ? (size_t)queued : cap;
+    lean_obj_res arr = lean_alloc_sarray(1, 0, want);
+    ssize_t n = recv(sock->fd, lean_sarray_cptr(arr), want, flags);
+    if (n < 0) {
+        *err = errno;
+        lean_dec(arr);
+        return NULL;
+    }
+    lean_to_sarray(arr)->m_size = (size_t)n;
+    return arr;
+}
+
+LEAN_EXPORT lean_obj_res jack_socket_recv_available(
+    b_lean_obj_arg sock_obj,
+    uint32_t cap,
+    lean_obj_arg world
+) {
+    int err = 0;
+    lean_obj_res arr = jack_recv_available(jack_socket_unbox(sock_obj), cap, 0, &err);
+    if (!arr) {
+        return jack_io_error_from_errno(err);
+    }
+    return lean_io_result_mk_ok(arr);
+}
+
+LEAN_EXPORT lean_obj_res jack_socket_recv_available_try(
+    b_lean_obj_arg sock_obj,
+    uint32_t cap,
+    lean_obj_arg world
+) {
+    int err = 0;
+    lean_obj_res arr = jack_recv_available(jack_socket_unbox(sock_obj), cap, MSG_DONTWAIT, &err);
+    if (!arr) {
+        if (is_wouldblock_error(err)) {
+            return lean_io_result_mk_ok(jack_socket_result_wouldblock());
+        }
+        return lean_io_result_mk_ok(jack_socket_result_error(err));
+    }
+    return lean_io_result_mk_ok(jack_socket_result_ok(arr));
+}
+
+/* Adaptive receive size kept on the socket handle: a read that fills the buffer
+ * doubles it (up to the caller's cap); two reads in a row that use less than
+ * half of it halve it. */
+#define JACK_RECV_HINT_DEFAULT 2048
+#define JACK_RECV_HINT_MIN 64
+
+static void jack_recv_hint_update(jack_socket_t *sock, uint32_t size, size_t got, uint32_t cap) {
+    if (got >= size) {
+        sock->recv_hint = size <= cap / 2 ? size * 2 : cap;
+        sock->recv_small = 0;
+    } else if (got * 2 < size) {
+        if (++sock->recv_small >= 2) {
+            sock->recv_hint = size / 2 > JACK_RECV_HINT_MIN ? size / 2 : JACK_RECV_HINT_MIN;
+            sock->recv_small = 0;
+        }
+    } else {
+        sock->recv_small = 0;
+    }
+}
+
+/* Non-blocking receive sized by the socket's hint, which it then updates */
+LEAN_EXPORT lean_obj_res jack_socket_recv_adaptive_try(
+    b_lean_obj_arg sock_obj,
+    uint32_t cap,
+    lean_obj_arg world
+) {
+    jack_socket_t *sock = jack_socket_unbox(sock_obj);
+    uint32_t size = sock->recv_hint ? sock->recv_hint : JACK_RECV_HINT_DEFAULT;
+    if (size > cap) size = cap;
+    lean_obj_res arr = lean_alloc_sarray(1, 0, size);
+    ssize_t n = recv(sock->fd, lean_sarray_cptr(arr), size, MSG_DONTWAIT);
+    if (n < 0) {
+        int err = errno;
+        lean_dec(arr);
+        if (is_wouldblock_error(err)) {
+            return lean_io_result_mk_ok(jack_socket_result_wouldblock());
+        }
+        return lean_io_result_mk_ok(jack_socket_result_error(err));
+    }
+    lean_to_sarray(arr)->m_size = (size_t)n;
+    if (n > 0) {
+        jack_recv_hint_update(sock, size, (size_t)n, cap);
+    }
+    return lean_io_result_mk_ok(jack_socket_result_ok(arr));
+}
+
+/* Current receive size hint (0 until the first adaptive receive) */
+LEAN_EXPORT lean_obj_res jack_socket_recv_hint(b_lean_obj_arg sock_obj, lean_obj_arg world) {
+    return lean_io_result_mk_ok(lean_box_uint32(jack_socket_unbox(sock_obj)->recv_hint));
+}
+
 /* Send data */
 LEAN_EXPORT lean_obj_res jack_socket_send(
     b_lean_obj_arg sock_obj,
@@ -1373,6 +1841,43 @@ LEAN_EXPORT lean_obj_res jack_socket_send_all(
     return jack_socket_send_loop(sock, ptr, len);
 }
 
+/* Send all bytes of a slice (retry loop), without copying it out of its array */
+LEAN_EXPORT lean_obj_res jack_socket_send_slice(
+    b_lean_obj_arg sock_obj,
+    b_lean_obj_arg slice,
+    lean_obj_arg world
+) {
+    jack_socket_t *sock = jack_socket_unbox(sock_obj);
+
+    size_t len;
+    const uint8_t *ptr = jack_byte_slice_view(slice, &len);
+
+    return jack_socket_send_loop(sock, ptr, len);
+}
+
+/* Send a slice (non-blocking try) */
+LEAN_EXPORT lean_obj_res jack_socket_send_slice_try(
+    b_lean_obj_arg sock_obj,
+    b_lean_obj_arg slice,
+    lean_obj_arg world
+) {
+    jack_socket_t *sock = jack_socket_unbox(sock_obj);
+
+    size_t len;
+    const uint8_t *ptr = jack_byte_slice_view(slice, &len);
+
+    ssize_t n = send(sock->fd, ptr, len, 0);
+    if (n < 0) {
+        int err = errno;
+        if (is_wouldblock_error(err)) {
+            return lean_io_result_mk_ok(jack_socket_result_wouldblock());
+        }
+        return lean_io_result_mk_ok(jack_socket_result_error(err));
+    }
+
+    return lean_io_result_mk_ok(jack_socket_result_ok(lean_box_uint32((uint32_t)n)));
+}
+
 /* Send file contents using sendfile(). count=0 sends to EOF. */
 LEAN_EXPORT lean_obj_res jack_socket_send_file(
     b_lean_obj_arg sock_obj,
@@ -1498,19 +2003,293 @@ LEAN_EXPORT lean_obj_res jack_socket_send_file(
     return lean_io_result_mk_ok(lean_box_uint64(sent_total));
 }
 
-/* Send data from multiple buffers using sendmsg() */
-LEAN_EXPORT lean_obj_res jack_socket_send_msg(
+/* Send every byte of an Array ByteArray with sendmsg.
+ * Returns 0 when done, 1 on EAGAIN, -1 on error (errno in *err); *sent counts bytes. */
+static int jack_send_chunks(int fd, b_lean_obj_arg chunks, int flags, uint64_t *sent, int *err) {
+    size_t count = lean_array_size(chunks);
+    size_t idx = 0;
+    size_t off = 0;
+    while (idx < count) {
+        struct iovec iov[JACK_DRAIN_IOV];
+        int iovcnt = 0;
+        for (size_t j = idx; j < count && iovcnt < JACK_DRAIN_IOV; j++) {
+            b_lean_obj_arg chunk = lean_array_get_core(chunks, j);
+            size_t skip = j == idx ? off : 0;
+            size_t clen = lean_sarray_size(chunk);
+            if (clen <= skip) continue;
+            iov[iovcnt].iov_base = (void *)(lean_sarray_cptr(chunk) + skip);
+            iov[iovcnt].iov_len = clen - skip;
+            iovcnt++;
+        }
+        if (iovcnt == 0) {
+            return 0;
+        }
+        struct msghdr msg;
+        memset(&msg, 0, sizeof(msg));
+        msg.msg_iov = iov;
+        msg.msg_iovlen = (size_t)iovcnt;
+        ssize_t n = sendmsg(fd, &msg, flags);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            if (is_wouldblock_error(errno)) return 1;
+            *err = errno;
+            return -1;
+        }
+        *sent += (uint64_t)n;
+        size_t left = (size_t)n;
+        while (left > 0 && idx < count) {
+            size_t avail = lean_sarray_size(lean_array_get_core(chunks, idx)) - off;
+            if (left >= avail) {
+                left -= avail;
+                idx++;
+                off = 0;
+            } else {
+                off += left;
+                left = 0;
+            }
+        }
+        while (idx < count && off == 0 && lean_sarray_size(lean_array_get_core(chunks, idx)) == 0) {
+            idx++;
+        }
+    }
+    return 0;
+}
+
+/* Send headers, a file range and trailers in one call.
+ * Headers go out with MSG_MORE inside a TCP_CORK window (ignored for non-TCP sockets)
+ * so they share segments with the body; the cork is released before returning.
+ * SendFileProgress: { headerBytes : UInt64, bodyBytes : UInt64, trailerBytes : UInt64,
+ *                     complete : Bool }
+ * EAGAIN stops early with complete = false; an error after partial progress is
+ * reported by the next call. A range past the end of the file is an error; if the
+ * file shrinks mid-send the trailers are withheld and complete = false. */
+LEAN_EXPORT lean_obj_res jack_socket_send_file_with(
     b_lean_obj_arg sock_obj,
-    b_lean_obj_arg chunks,
+    b_lean_obj_arg path,
+    uint64_t offset_in,
+    uint64_t count_in,
+    b_lean_obj_arg headers,
+    b_lean_obj_arg trailers,
     lean_obj_arg world
 ) {
+    (void)world;
     jack_socket_t *sock = jack_socket_unbox(sock_obj);
-    size_t count = lean_array_size(chunks);
+    const char *path_str = lean_string_cstr(path);
 
-    if (count == 0) {
-        return lean_io_result_mk_ok(lean_box_uint32(0));
+    int fd = open(path_str, O_RDONLY);
+    if (fd < 0) {
+        return jack_io_error_from_errno(errno);
     }
-
+    struct stat st;
+    if (fstat(fd, &st) < 0) {
+        int err = errno;
+        close(fd);
+        return jack_io_error_from_errno(err);
+    }
+    uint64_t file_size = (uint64_t)st.st_size;
+    uint64_t offset = offset_in;
+    uint64_t remaining = count_in;
+    if (remaining == 0) {
+        remaining = offset >= file_size ? 0 : file_size - offset;
+    } else if (offset > file_size || remaining > file_size - offset) {
+        /* Never frame a short body as complete */
+        close(fd);
+        return lean_io_result_mk_error(lean_mk_io_user_error(
+            lean_mk_string("sendFileWith: file ends before the requested range")));
+    }
+
+    uint64_t hdr_sent = 0;
+    uint64_t body_sent = 0;
+    uint64_t trl_sent = 0;
+    int blocked = 0;
+    int short_file = 0; /* file shrank while sending: stop before the trailers */
+    int err = 0;
+
+#if defined(JACK_HAVE_SENDFILE) && defined(__APPLE__)
+    /* sf_hdtr carries headers and trailers in the same sendfile call */
+    size_t hdr_count = lean_array_size(headers);
+    size_t trl_count = lean_array_size(trailers);
+    struct iovec *iovs = malloc((hdr_count + trl_count + 1) * sizeof(struct iovec));
+    if (!iovs) {
+        close(fd);
+        return lean_io_result_mk_error(lean_mk_io_user_error(
+            lean_mk_string("Failed to allocate iovec")));
+    }
+    uint64_t hdr_total = 0;
+    uint64_t trl_total = 0;
+    for (size_t i = 0; i < hdr_count; i++) {
+        b_lean_obj_arg chunk = lean_array_get_core(headers, i);
+        iovs[i].iov_base = (void *)lean_sarray_cptr(chunk);
+        iovs[i].iov_len = lean_sarray_size(chunk);
+        hdr_total += iovs[i].iov_len;
+    }
+    for (size_t i = 0; i < trl_count; i++) {
+        b_lean_obj_arg chunk = lean_array_get_core(trailers, i);
+        iovs[hdr_count + i].iov_base = (void *)lean_sarray_cptr(chunk);
+        iovs[hdr_count + i].iov_len = lean_sarray_size(chunk);
+        trl_total += iovs[hdr_count + i].iov_len;
+    }
+    struct sf_hdtr hdtr;
+    hdtr.headers = iovs;
+    hdtr.hdr_cnt = (int)hdr_count;
+    hdtr.trailers = iovs + hdr_count;
+    hdtr.trl_cnt = (int)trl_count;
+    off_t len = (off_t)remaining;
+    int rc;
+    do {
+        len = (off_t)remaining;
+        rc = sendfile(fd, sock->fd, (off_t)offset, &len, &hdtr, 0);
+    } while (rc < 0 && errno == EINTR && len == 0);
+    if (rc < 0 && len == 0 && !is_wouldblock_error(errno)) {
+        err = errno;
+    } else if (rc < 0) {
+        blocked = 1;
+    }
+    /* `len` counts header, body and trailer bytes in that order */
+    uint64_t total = (uint64_t)len;
+    hdr_sent = total < hdr_total ? total : hdr_total;
+    total -= hdr_sent;
+    body_sent = total < remaining ? total : remaining;
+    total -= body_sent;
+    trl_sent = total < trl_total ? total : trl_total;
+    free(iovs);
+    if (!err && !blocked && body_sent < remaining && trl_sent > 0) {
+        short_file = 1;
+    } else if (!err && !blocked && (hdr_sent < hdr_total || body_sent < remaining || trl_sent < trl_total)) {
+        blocked = 1;
+    }
+#else
+    int more = 0;
+#ifdef MSG_MORE
+    more = MSG_MORE;
+#endif
+    int nosig = 0;
+#ifdef MSG_NOSIGNAL
+    nosig = MSG_NOSIGNAL;
+#endif
+#ifdef TCP_CORK
+    int cork = 1;
+    int corked = setsockopt(sock->fd, IPPROTO_TCP, TCP_CORK, &cork, sizeof(cork)) == 0;
+#endif
+
+    int rc = jack_send_chunks(sock->fd, headers, nosig | more, &hdr_sent, &err);
+    if (rc == 1) blocked = 1;
+
+#if defined(JACK_HAVE_SENDFILE) && defined(__linux__)
+    off_t off = (off_t)offset;
+    while (rc == 0 && remaining > 0) {
+        size_t chunk = remaining > (uint64_t)SIZE_MAX ? SIZE_MAX : (size_t)remaining;
+        ssize_t n = sendfile(sock->fd, fd, &off, chunk);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            if (is_wouldblock_error(errno)) {
+                blocked = 1;
+                rc = 1;
+            } else {
+                err = errno;
+                rc = -1;
+            }
+            break;
+        }
+        if (n == 0) {
+            short_file = 1;
+            rc = -1;
+            break;
+        }
+        body_sent += (uint64_t)n;
+        remaining -= (uint64_t)n;
+    }
+#else
+    if (rc == 0 && remaining > 0) {
+        const size_t buf_size = 65536;
+        uint8_t *buf = malloc(buf_size);
+        if (!buf) {
+            err = ENOMEM;
+            rc = -1;
+        } else if (lseek(fd, (off_t)offset, SEEK_SET) < 0) {
+            err = errno;
+            rc = -1;
+        }
+        while (rc == 0 && remaining > 0) {
+            size_t chunk = remaining > buf_size ? buf_size : (size_t)remaining;
+            ssize_t r = read(fd, buf, chunk);
+            if (r < 0) {
+                if (errno == EINTR) continue;
+                err = errno;
+                rc = -1;
+                break;
+            }
+            if (r == 0) {
+                short_file = 1;
+                rc = -1;
+                break;
+            }
+            size_t sent = 0;
+            while (sent < (size_t)r) {
+                ssize_t w = send(sock->fd, buf + sent, (size_t)r - sent, nosig);
+                if (w < 0) {
+                    if (errno == EINTR) continue;
+                    if (is_wouldblock_error(errno)) {
+                        blocked = 1;
+                        rc = 1;
+                    } else {
+                        err = errno;
+                        rc = -1;
+                    }
+                    break;
+                }
+                sent += (size_t)w;
+            }
+            body_sent += (uint64_t)sent;
+            remaining -= (uint64_t)sent;
+        }
+        free(buf);
+    }
+#endif
+
+    if (rc == 0) {
+        rc = jack_send_chunks(sock->fd, trailers, nosig, &trl_sent, &err);
+        if (rc == 1) blocked = 1;
+    }
+
+#ifdef TCP_CORK
+    if (corked) {
+        cork = 0;
+        setsockopt(sock->fd, IPPROTO_TCP, TCP_CORK, &cork, sizeof(cork));
+    }
+#endif
+#endif
+
+    close(fd);
+    if (err != 0 && hdr_sent + body_sent + trl_sent == 0) {
+        return jack_io_error_from_errno(err);
+    }
+    if (short_file && hdr_sent + body_sent + trl_sent == 0) {
+        return lean_io_result_mk_error(lean_mk_io_user_error(
+            lean_mk_string("sendFileWith: file ends before the requested range")));
+    }
+
+    lean_obj_res result = lean_alloc_ctor(0, 0, 3 * 8 + 1);
+    lean_ctor_set_uint64(result, 0, hdr_sent);
+    lean_ctor_set_uint64(result, 8, body_sent);
+    lean_ctor_set_uint64(result, 16, trl_sent);
+    lean_ctor_set_uint8(result, 24, (uint8_t)(!blocked && !short_file && err == 0));
+    return lean_io_result_mk_ok(result);
+}
+
+/* Send data from multiple buffers using sendmsg() */
+LEAN_EXPORT lean_obj_res jack_socket_send_msg(
+    b_lean_obj_arg sock_obj,
+    b_lean_obj_arg chunks,
+    lean_obj_arg world
+) {
+    jack_socket_t *sock = jack_socket_unbox(sock_obj);
+    size_t count = lean_array_size(chunks);
+
+    if (count == 0) {
+        return lean_io_result_mk_ok(lean_box_uint32(0));
+    }
+
     struct iovec *iov = malloc(count * sizeof(struct iovec));
     if (!iov) {
         return lean_io_result_mk_error(lean_mk_io_user_error(
@@ -1538,6 +2317,47 @@ LEAN_EXPORT lean_obj_res jack_socket_send_msg(
     return lean_io_result_mk_ok(lean_box_uint32((uint32_t)n));
 }
 
+/* Send multiple slices using sendmsg(); each iovec points into its slice's array */
+LEAN_EXPORT lean_obj_res jack_socket_send_msg_slices(
+    b_lean_obj_arg sock_obj,
+    b_lean_obj_arg slices,
+    lean_obj_arg world
+) {
+    jack_socket_t *sock = jack_socket_unbox(sock_obj);
+    size_t count = lean_array_size(slices);
+
+    if (count == 0) {
+        return lean_io_result_mk_ok(lean_box_uint32(0));
+    }
+
+    struct iovec *iov = malloc(count * sizeof(struct iovec));
+    if (!iov) {
+        return lean_io_result_mk_error(lean_mk_io_user_error(
+            lean_mk_string("Failed to allocate iovec array")));
+    }
+
+    for (size_t i = 0; i < count; i++) {
+        size_t len;
+        const uint8_t *ptr = jack_byte_slice_view(lean_array_get_core(slices, i), &len);
+        iov[i].iov_base = (void *)ptr;
+        iov[i].iov_len = len;
+    }
+
+    struct msghdr msg;
+    memset(&msg, 0, sizeof(msg));
+    msg.msg_iov = iov;
+    msg.msg_iovlen = count;
+
+    ssize_t n = sendmsg(sock->fd, &msg, 0);
+    free(iov);
+
+    if (n < 0) {
+        return jack_io_error_from_errno(errno);
+    }
+
+    return lean_io_result_mk_ok(lean_box_uint32((uint32_t)n));
+}
+
 /* Send data from multiple buffers using sendmsg() with control messages */
 LEAN_EXPORT lean_obj_res jack_socket_send_msg_control(
     b_lean_obj_arg sock_obj,
@@ -1844,6 +2664,61 @@ LEAN_EXPORT lean_obj_res jack_socket_recv_msg(
 }
 
 /* Receive data into multiple buffers using recvmsg() with control messages */
+/* Kernel timestamps: KernelTimestamp {sec : UInt64, nsec : UInt32} */
+static lean_obj_res jack_mk_kernel_timestamp(const struct timespec *ts) {
+    lean_obj_res obj = lean_alloc_ctor(0, 0, sizeof(uint64_t) + sizeof(uint32_t));
+    lean_ctor_set_uint64(obj, 0, (uint64_t)ts->tv_sec);
+    lean_ctor_set_uint32(obj, sizeof(uint64_t), (uint32_t)ts->tv_nsec);
+    return obj;
+}
+
+/* Control space for one receive timestamp (SCM_TIMESTAMPING carries three timespecs) */
+#define JACK_RX_TS_SPACE CMSG_SPACE(3 * sizeof(struct timespec))
+
+/* Find a receive timestamp (SCM_TIMESTAMPNS or software SCM_TIMESTAMPING) in `msg` */
+static int jack_cmsg_rx_timestamp(struct msghdr *msg, struct timespec *out) {
+    if (msg->msg_control == NULL) {
+        return 0;
+    }
+    for (struct cmsghdr *cmsg = CMSG_FIRSTHDR(msg); cmsg != NULL; cmsg = CMSG_NXTHDR(msg, cmsg)) {
+        if (cmsg->cmsg_level != SOL_SOCKET) {
+            continue;
+        }
+#ifdef SCM_TIMESTAMPNS
+        if (cmsg->cmsg_type == SCM_TIMESTAMPNS && cmsg->cmsg_len >= CMSG_LEN(sizeof(struct timespec))) {
+            memcpy(out, CMSG_DATA(cmsg), sizeof(struct timespec));
+            return 1;
+        }
+#endif
+#ifdef SCM_TIMESTAMPING
+        if (cmsg->cmsg_type == SCM_TIMESTAMPING && cmsg->cmsg_len >= CMSG_LEN(3 * sizeof(struct timespec))) {
+            /* ts[0] is the software timestamp; ts[2] (raw hardware) is not requested */
+            struct timespec ts[3];
+            memcpy(ts, CMSG_DATA(cmsg), sizeof(ts));
+            if (ts[0].tv_sec != 0 || ts[0].tv_nsec != 0) {
+                *out = ts[0];
+                return 1;
+            }
+        }
+#endif
+    }
+    return 0;
+}
+
+/* Option RxTimestamp for a received message; `pickup` is when recvmsg returned */
+static lean_obj_res jack_rx_timestamp_opt(struct msghdr *msg, const struct timespec *pickup) {
+    struct timespec arrival;
+    if (!jack_cmsg_rx_timestamp(msg, &arrival)) {
+        return lean_box(0);
+    }
+    lean_obj_res rx = lean_alloc_ctor(0, 2, 0);
+    lean_ctor_set(rx, 0, jack_mk_kernel_timestamp(&arrival));
+    lean_ctor_set(rx, 1, jack_mk_kernel_timestamp(pickup));
+    lean_obj_res some = lean_alloc_ctor(1, 1, 0);
+    lean_ctor_set(some, 0, rx);
+    return some;
+}
+
 LEAN_EXPORT lean_obj_res jack_socket_recv_msg_control(
     b_lean_obj_arg sock_obj,
     b_lean_obj_arg sizes,
@@ -1858,9 +2733,10 @@ LEAN_EXPORT lean_obj_res jack_socket_recv_msg_control(
         lean_obj_res empty_parts = lean_alloc_array(0, 0);
         lean_obj_res empty_fds = lean_alloc_array(0, 0);
         lean_obj_res none_cred = lean_alloc_ctor(0, 0, 0);
-        lean_obj_res ctrl = lean_alloc_ctor(0, 2, 0);
+        lean_obj_res ctrl = lean_alloc_ctor(0, 3, 0);
         lean_ctor_set(ctrl, 0, empty_fds);
         lean_ctor_set(ctrl, 1, none_cred);
+        lean_ctor_set(ctrl, 2, lean_box(0));
         lean_obj_res pair = lean_alloc_ctor(0, 2, 0);
         lean_ctor_set(pair, 0, empty_parts);
         lean_ctor_set(pair, 1, ctrl);
@@ -1899,7 +2775,7 @@ LEAN_EXPORT lean_obj_res jack_socket_recv_msg_control(
         iov[i].iov_len = (size_t)sz;
     }
 
-    size_t control_len = 0;
+    size_t control_len = JACK_RX_TS_SPACE;
     if (max_fds > 0) {
         control_len += CMSG_SPACE(max_fds * sizeof(int));
     }
@@ -1946,6 +2822,8 @@ LEAN_EXPORT lean_obj_res jack_socket_recv_msg_control(
         if (control_buf) free(control_buf);
         return jack_io_error_from_errno(err);
     }
+    struct timespec pickup;
+    clock_gettime(CLOCK_REALTIME, &pickup);
 
     size_t remaining = (size_t)n;
     lean_obj_res parts = lean_alloc_array(count, count);
@@ -2018,6 +2896,7 @@ LEAN_EXPORT lean_obj_res jack_socket_recv_msg_control(
         lean_array_set_core(fds_arr, i, lean_box_uint32((uint32_t)out_fds[i]));
     }
     if (out_fds) free(out_fds);
+    lean_obj_res rx_ts = jack_rx_timestamp_opt(&msg, &pickup);
     if (control_buf) free(control_buf);
 
     lean_obj_res cred_opt;
@@ -2036,9 +2915,10 @@ LEAN_EXPORT lean_obj_res jack_socket_recv_msg_control(
         cred_opt = lean_alloc_ctor(0, 0, 0);
     }
 
-    lean_obj_res ctrl = lean_alloc_ctor(0, 2, 0);
+    lean_obj_res ctrl = lean_alloc_ctor(0, 3, 0);
     lean_ctor_set(ctrl, 0, fds_arr);
     lean_ctor_set(ctrl, 1, cred_opt);
+    lean_ctor_set(ctrl, 2, rx_ts);
 
     lean_obj_res pair = lean_alloc_ctor(0, 2, 0);
     lean_ctor_set(pair, 0, parts);
@@ -2249,6 +3129,145 @@ LEAN_EXPORT lean_obj_res jack_socket_send_to_try(
     return lean_io_result_mk_ok(jack_socket_result_ok(lean_box_uint32((uint32_t)n)));
 }
 
+/* Send a slice to a specific address (UDP) */
+LEAN_EXPORT lean_obj_res jack_socket_send_to_slice(
+    b_lean_obj_arg sock_obj,
+    b_lean_obj_arg slice,
+    b_lean_obj_arg addr,
+    lean_obj_arg world
+) {
+    jack_socket_t *sock = jack_socket_unbox(sock_obj);
+
+    struct sockaddr_storage sa;
+    socklen_t sa_len;
+
+    if (lean_to_sockaddr(addr, &sa, &sa_len) < 0) {
+        return lean_io_result_mk_error(lean_mk_io_user_error(
+            lean_mk_string("Invalid address")));
+    }
+
+    size_t len;
+    const uint8_t *ptr = jack_byte_slice_view(slice, &len);
+
+    ssize_t n = sendto(sock->fd, ptr, len, 0, (struct sockaddr *)&sa, sa_len);
+    if (n < 0) {
+        return jack_io_error_from_errno(errno);
+    }
+
+    return lean_io_result_mk_ok(lean_box(0));
+}
+
+/* Send a slice to a specific address (UDP, non-blocking try) */
+LEAN_EXPORT lean_obj_res jack_socket_send_to_slice_try(
+    b_lean_obj_arg sock_obj,
+    b_lean_obj_arg slice,
+    b_lean_obj_arg addr,
+    lean_obj_arg world
+) {
+    jack_socket_t *sock = jack_socket_unbox(sock_obj);
+
+    struct sockaddr_storage sa;
+    socklen_t sa_len;
+
+    if (lean_to_sockaddr(addr, &sa, &sa_len) < 0) {
+        return lean_io_result_mk_ok(jack_socket_result_error(EINVAL));
+    }
+
+    size_t len;
+    const uint8_t *ptr = jack_byte_slice_view(slice, &len);
+
+    ssize_t n = sendto(sock->fd, ptr, len, 0, (struct sockaddr *)&sa, sa_len);
+    if (n < 0) {
+        int err = errno;
+        if (is_wouldblock_error(err)) {
+            return lean_io_result_mk_ok(jack_socket_result_wouldblock());
+        }
+        return lean_io_result_mk_ok(jack_socket_result_error(err));
+    }
+
+    return lean_io_result_mk_ok(jack_socket_result_ok(lean_box_uint32((uint32_t)n)));
+}
+
+/* Send data to a prepared address (UDP) */
+LEAN_EXPORT lean_obj_res jack_socket_send_to_prepared(
+    b_lean_obj_arg sock_obj,
+    b_lean_obj_arg data,
+    b_lean_obj_arg addr_obj,
+    lean_obj_arg world
+) {
+    jack_socket_t *sock = jack_socket_unbox(sock_obj);
+    jack_prepared_addr_t *addr = jack_prepared_addr_unbox(addr_obj);
+
+    size_t len = lean_sarray_size(data);
+    const uint8_t *ptr = lean_sarray_cptr(data);
+
+    ssize_t n = sendto(sock->fd, ptr, len, 0, (struct sockaddr *)&addr->sa, addr->len);
+    if (n < 0) {
+        return jack_io_error_from_errno(errno);
+    }
+
+    return lean_io_result_mk_ok(lean_box(0));
+}
+
+/* Send data to a prepared address (UDP, non-blocking try) */
+LEAN_EXPORT lean_obj_res jack_socket_send_to_prepared_try(
+    b_lean_obj_arg sock_obj,
+    b_lean_obj_arg data,
+    b_lean_obj_arg addr_obj,
+    lean_obj_arg world
+) {
+    jack_socket_t *sock = jack_socket_unbox(sock_obj);
+    jack_prepared_addr_t *addr = jack_prepared_addr_unbox(addr_obj);
+
+    size_t len = lean_sarray_size(data);
+    const uint8_t *ptr = lean_sarray_cptr(data);
+
+    ssize_t n = sendto(sock->fd, ptr, len, 0, (struct sockaddr *)&addr->sa, addr->len);
+    if (n < 0) {
+        int err = errno;
+        if (is_wouldblock_error(err)) {
+            return lean_io_result_mk_ok(jack_socket_result_wouldblock());
+        }
+        return lean_io_result_mk_ok(jack_socket_result_error(err));
+    }
+
+    return lean_io_result_mk_ok(jack_socket_result_ok(lean_box_uint32((uint32_t)n)));
+}
+
+/* Receive a datagram and its sender as a prepared address, ready to reply to */
+LEAN_EXPORT lean_obj_res jack_socket_recv_from_prepared(
+    b_lean_obj_arg sock_obj,
+    uint32_t max_bytes,
+    lean_obj_arg world
+) {
+    jack_socket_t *sock = jack_socket_unbox(sock_obj);
+
+    lean_obj_res arr = lean_alloc_sarray(1, 0, max_bytes);
+    struct sockaddr_storage from_addr;
+    socklen_t from_len = sizeof(from_addr);
+    memset(&from_addr, 0, sizeof(from_addr));
+
+    ssize_t n = recvfrom(sock->fd, lean_sarray_cptr(arr), max_bytes, 0,
+                         (struct sockaddr *)&from_addr, &from_len);
+    if (n < 0) {
+        int err = errno;
+        lean_dec(arr);
+        return jack_io_error_from_errno(err);
+    }
+    lean_to_sarray(arr)->m_size = (size_t)n;
+
+    lean_obj_res peer = jack_prepared_addr_box(&from_addr, from_len);
+    if (!peer) {
+        lean_dec(arr);
+        return jack_io_error_from_errno(ENOMEM);
+    }
+
+    lean_obj_res pair = lean_alloc_ctor(0, 2, 0);
+    lean_ctor_set(pair, 0, arr);
+    lean_ctor_set(pair, 1, peer);
+    return lean_io_result_mk_ok(pair);
+}
+
 /* Receive data with sender address (UDP) */
 LEAN_EXPORT lean_obj_res jack_socket_recv_from(
     b_lean_obj_arg sock_obj,
@@ -2375,7 +3394,557 @@ LEAN_EXPORT lean_obj_res jack_socket_recv_from_try(
     return lean_io_result_mk_ok(jack_socket_result_ok(pair));
 }
 
-/* ========== Address Operations ========== */
+/* Receive one datagram into a buffer sized to it, at most `cap` bytes.
+ * Linux peeks the real length first (MSG_PEEK | MSG_TRUNC); elsewhere the
+ * buffer is `cap` bytes and truncation comes from msg_flags.
+ * RecvFromExact: { data : ByteArray, sender : SockAddr, size : UInt32, truncated : Bool }
+ * (2 objects, then UInt32 and UInt8 scalars). Returns NULL with *err set on failure. */
+static lean_obj_res jack_recv_from_exact(jack_socket_t *sock, uint32_t cap, int flags, int *err) {
+    size_t want = cap;
+#ifdef __linux__
+    ssize_t full = recv(sock->fd, NULL, 0, MSG_PEEK | MSG_TRUNC | flags);
+    if (full < 0) {
+        *err = errno;
+        return NULL;
+    }
+    if ((size_t)full < want) want = (size_t)full;
+#endif
+    lean_obj_res arr = lean_alloc_sarray(1, 0, want);
+    struct sockaddr_storage from_addr;
+    struct iovec iov = { lean_sarray_cptr(arr), want };
+    struct msghdr msg;
+    memset(&msg, 0, sizeof(msg));
+    msg.msg_name = &from_addr;
+    msg.msg_namelen = sizeof(from_addr);
+    msg.msg_iov = &iov;
+    msg.msg_iovlen = 1;
+#ifdef __linux__
+    ssize_t n = recvmsg(sock->fd, &msg, MSG_TRUNC | flags);
+#else
+    ssize_t n = recvmsg(sock->fd, &msg, flags);
+#endif
+    if (n < 0) {
+        *err = errno;
+        lean_dec(arr);
+        return NULL;
+    }
+    /* With MSG_TRUNC, n is the datagram's real length even when it did not fit */
+    size_t got = (size_t)n < want ? (size_t)n : want;
+    int truncated = (size_t)n > want || (msg.msg_flags & MSG_TRUNC) != 0;
+    lean_to_sarray(arr)->m_size = got;
+
+    lean_obj_res result = lean_alloc_ctor(0, 2, 4 + 1);
+    lean_ctor_set(result, 0, arr);
+    lean_ctor_set(result, 1, sockaddr_to_lean((struct sockaddr *)&from_addr, msg.msg_namelen));
+    lean_ctor_set_uint32(result, 2 * sizeof(void*), (uint32_t)n);
+    lean_ctor_set_uint8(result, 2 * sizeof(void*) + 4, truncated ? 1 : 0);
+    return result;
+}
+
+LEAN_EXPORT lean_obj_res jack_socket_recv_from_exact(
+    b_lean_obj_arg sock_obj,
+    uint32_t cap,
+    lean_obj_arg world
+) {
+    int err = 0;
+    lean_obj_res result = jack_recv_from_exact(jack_socket_unbox(sock_obj), cap, 0, &err);
+    if (!result) {
+        return jack_io_error_from_errno(err);
+    }
+    return lean_io_result_mk_ok(result);
+}
+
+LEAN_EXPORT lean_obj_res jack_socket_recv_from_exact_try(
+    b_lean_obj_arg sock_obj,
+    uint32_t cap,
+    lean_obj_arg world
+) {
+    int err = 0;
+    lean_obj_res result = jack_recv_from_exact(jack_socket_unbox(sock_obj), cap, MSG_DONTWAIT, &err);
+    if (!result) {
+        if (is_wouldblock_error(err)) {
+            return lean_io_result_mk_ok(jack_socket_result_wouldblock());
+        }
+        return lean_io_result_mk_ok(jack_socket_result_error(err));
+    }
+    return lean_io_result_mk_ok(jack_socket_result_ok(result));
+}
+
+/* ========== Peer Demux ========== */
+
+/* SipHash-2-4 with a per-process random key, over a fixed-size encoding of the
+ * peer address. Keyed so that remote senders cannot aim source addresses at one
+ * bucket; the same encoding backs SockAddr/PackedSockAddr hashing and PeerTable. */
+typedef struct {
+    uint8_t family;     /* 4 or 6 */
+    uint8_t pad;
+    uint16_t port;
+    uint32_t scope;
+    uint8_t addr[16];   /* IPv4 uses the first 4 bytes */
+} jack_peer_key_t;
+
+static uint64_t g_siphash_k0, g_siphash_k1;
+/* 0: unseeded, 1: being seeded, 2: ready. Plain C11 atomics, so no pthreads needed */
+static atomic_int g_siphash_state = 0;
+
+static void jack_siphash_seed(void) {
+    uint64_t k[2] = {0, 0};
+    int fd = open("/dev/urandom", O_RDONLY | O_CLOEXEC);
+    if (fd < 0 || read(fd, k, sizeof(k)) != (ssize_t)sizeof(k)) {
+        struct timespec ts;
+        clock_gettime(CLOCK_MONOTONIC, &ts);
+        k[0] = (uint64_t)ts.tv_nsec ^ ((uint64_t)ts.tv_sec << 32) ^ (uint64_t)getpid();
+        k[1] = (uint64_t)(uintptr_t)&ts ^ 0x736f6d6570736575ULL;
+    }
+    if (fd >= 0) close(fd);
+    g_siphash_k0 = k[0];
+    g_siphash_k1 = k[1];
+}
+
+/* Seed the key on first use; concurrent first callers wait for the winner */
+static void jack_siphash_init(void) {
+    if (atomic_load_explicit(&g_siphash_state, memory_order_acquire) == 2) return;
+    int expected = 0;
+    if (atomic_compare_exchange_strong_explicit(&g_siphash_state, &expected, 1,
+                                                memory_order_acq_rel, memory_order_acquire)) {
+        jack_siphash_seed();
+        atomic_store_explicit(&g_siphash_state, 2, memory_order_release);
+        return;
+    }
+    while (atomic_load_explicit(&g_siphash_state, memory_order_acquire) != 2) {
+    }
+}
+
+#define JACK_ROTL64(x, b) (((x) << (b)) | ((x) >> (64 - (b))))
+#define JACK_SIPROUND                                                     \
+    do {                                                                  \
+        v0 += v1; v1 = JACK_ROTL64(v1, 13); v1 ^= v0; v0 = JACK_ROTL64(v0, 32); \
+        v2 += v3; v3 = JACK_ROTL64(v3, 16); v3 ^= v2;                     \
+        v0 += v3; v3 = JACK_ROTL64(v3, 21); v3 ^= v0;                     \
+        v2 += v1; v1 = JACK_ROTL64(v1, 17); v1 ^= v2; v2 = JACK_ROTL64(v2, 32); \
+    } while (0)
+
+static uint64_t jack_siphash(const uint8_t *in, size_t len) {
+    jack_siphash_init();
+    uint64_t k0 = g_siphash_k0, k1 = g_siphash_k1;
+    uint64_t v0 = 0x736f6d6570736575ULL ^ k0;
+    uint64_t v1 = 0x646f72616e646f6dULL ^ k1;
+    uint64_t v2 = 0x6c7967656e657261ULL ^ k0;
+    uint64_t v3 = 0x7465646279746573ULL ^ k1;
+    const uint8_t *end = in + (len & ~(size_t)7);
+    for (; in != end; in += 8) {
+        uint64_t m;
+        memcpy(&m, in, 8);
+#if __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+        m = __builtin_bswap64(m);
+#endif
+        v3 ^= m;
+        JACK_SIPROUND;
+        JACK_SIPROUND;
+        v0 ^= m;
+    }
+    uint64_t b = (uint64_t)len << 56;
+    for (size_t i = 0; i < (len & 7); i++) {
+        b |= (uint64_t)in[i] << (8 * i);
+    }
+    v3 ^= b;
+    JACK_SIPROUND;
+    JACK_SIPROUND;
+    v0 ^= b;
+    v2 ^= 0xff;
+    JACK_SIPROUND;
+    JACK_SIPROUND;
+    JACK_SIPROUND;
+    JACK_SIPROUND;
+    return v0 ^ v1 ^ v2 ^ v3;
+}
+
+static void jack_peer_key_v4(jack_peer_key_t *key, uint32_t addr, uint16_t port) {
+    memset(key, 0, sizeof(*key));
+    key->family = 4;
+    key->port = port;
+    key->addr[0] = (uint8_t)(addr >> 24);
+    key->addr[1] = (uint8_t)(addr >> 16);
+    key->addr[2] = (uint8_t)(addr >> 8);
+    key->addr[3] = (uint8_t)addr;
+}
+
+/* Key for an IP sockaddr. Returns -1 for other families. */
+static int jack_peer_key_of_sockaddr(const struct sockaddr *sa, jack_peer_key_t *key) {
+    if (sa->sa_family == AF_INET) {
+        const struct sockaddr_in *sin = (const struct sockaddr_in *)sa;
+        jack_peer_key_v4(key, ntohl(sin->sin_addr.s_addr), ntohs(sin->sin_port));
+        return 0;
+    }
+    if (sa->sa_family == AF_INET6) {
+        const struct sockaddr_in6 *sin6 = (const struct sockaddr_in6 *)sa;
+        memset(key, 0, sizeof(*key));
+        key->family = 6;
+        key->port = ntohs(sin6->sin6_port);
+        key->scope = sin6->sin6_scope_id;
+        memcpy(key->addr, &sin6->sin6_addr, 16);
+        return 0;
+    }
+    return -1;
+}
+
+static int jack_peer_key_of_lean(b_lean_obj_arg addr, jack_peer_key_t *key) {
+    struct sockaddr_storage sa;
+    socklen_t sa_len;
+    if (lean_to_sockaddr(addr, &sa, &sa_len) < 0) {
+        return -1;
+    }
+    return jack_peer_key_of_sockaddr((struct sockaddr *)&sa, key);
+}
+
+static inline uint64_t jack_peer_key_hash(const jack_peer_key_t *key) {
+    return jack_siphash((const uint8_t *)key, sizeof(*key));
+}
+
+/* Hash of a SockAddr. Unix addresses hash their path, tagged by constructor. */
+LEAN_EXPORT uint64_t jack_sockaddr_hash(b_lean_obj_arg addr) {
+    unsigned tag = lean_ptr_tag(addr);
+    if (tag == 2 || tag == 3) {
+        b_lean_obj_arg path = lean_ctor_get(addr, 0);
+        return jack_siphash((const uint8_t *)lean_string_cstr(path), lean_string_size(path) - 1) ^ tag;
+    }
+    jack_peer_key_t key;
+    if (jack_peer_key_of_lean(addr, &key) < 0) {
+        return 0;
+    }
+    return jack_peer_key_hash(&key);
+}
+
+LEAN_EXPORT uint64_t jack_packed_addr_hash_v4(uint32_t addr, uint16_t port) {
+    jack_peer_key_t key;
+    jack_peer_key_v4(&key, addr, port);
+    return jack_peer_key_hash(&key);
+}
+
+LEAN_EXPORT uint64_t jack_packed_addr_hash_v6(uint64_t hi, uint64_t lo, uint32_t scope, uint16_t port) {
+    jack_peer_key_t key;
+    memset(&key, 0, sizeof(key));
+    key.family = 6;
+    key.port = port;
+    key.scope = scope;
+    jack_store_be64(key.addr, hi);
+    jack_store_be64(key.addr + 8, lo);
+    return jack_peer_key_hash(&key);
+}
+
+/* Open-addressing table from peer key to session index, linear probing with
+ * tombstones. Not thread-safe. */
+typedef struct {
+    jack_peer_key_t key;
+    uint32_t session;
+    uint32_t state;     /* 0 empty, 1 live, 2 deleted */
+} jack_peer_slot_t;
+
+typedef struct {
+    jack_peer_slot_t *slots;
+    size_t cap;         /* power of two */
+    size_t live;
+    size_t occupied;    /* live + deleted */
+} jack_peer_table_t;
+
+static lean_external_class *g_peer_table_class = NULL;
+
+static void jack_peer_table_finalizer(void *ptr) {
+    jack_peer_table_t *table = (jack_peer_table_t *)ptr;
+    free(table->slots);
+    free(table);
+}
+
+static void jack_peer_table_foreach(void *ptr, b_lean_obj_arg f) {
+    /* No nested Lean objects */
+}
+
+static inline jack_peer_table_t *jack_peer_table_unbox(b_lean_obj_arg obj) {
+    return (jack_peer_table_t *)lean_get_external_data(obj);
+}
+
+/* Slot holding `key`, or NULL. */
+static jack_peer_slot_t *jack_peer_table_lookup(jack_peer_table_t *table, const jack_peer_key_t *key) {
+    size_t mask = table->cap - 1;
+    for (size_t i = (size_t)jack_peer_key_hash(key) & mask;; i = (i + 1) & mask) {
+        jack_peer_slot_t *slot = &table->slots[i];
+        if (slot->state == 0) return NULL;
+        if (slot->state == 1 && memcmp(&slot->key, key, sizeof(*key)) == 0) return slot;
+    }
+}
+
+/* Rebuild into `cap` slots, dropping tombstones. Returns -1 if allocation fails. */
+static int jack_peer_table_rehash(jack_peer_table_t *table, size_t cap) {
+    jack_peer_slot_t *slots = calloc(cap, sizeof(jack_peer_slot_t));
+    if (!slots) return -1;
+    for (size_t j = 0; j < table->cap; j++) {
+        jack_peer_slot_t *old = &table->slots[j];
+        if (old->state != 1) continue;
+        size_t i = (size_t)jack_peer_key_hash(&old->key) & (cap - 1);
+        while (slots[i].state != 0) i = (i + 1) & (cap - 1);
+        slots[i] = *old;
+    }
+    free(table->slots);
+    table->slots = slots;
+    table->cap = cap;
+    table->occupied = table->live;
+    return 0;
+}
+
+static lean_obj_res jack_peer_table_key_error(void) {
+    return lean_io_result_mk_error(lean_mk_io_user_error(
+        lean_mk_string("Peer table keys must be IP addresses")));
+}
+
+LEAN_EXPORT lean_obj_res jack_peer_table_new(uint32_t capacity, lean_obj_arg world) {
+    (void)world;
+    size_t cap = 16;
+    while (cap < (size_t)capacity * 2) cap <<= 1;
+    jack_peer_table_t *table = calloc(1, sizeof(jack_peer_table_t));
+    if (table) table->slots = calloc(cap, sizeof(jack_peer_slot_t));
+    if (!table || !table->slots) {
+        free(table);
+        return lean_io_result_mk_error(lean_mk_io_user_error(
+            lean_mk_string("Failed to allocate peer table")));
+    }
+    table->cap = cap;
+    if (g_peer_table_class == NULL) {
+        g_peer_table_class = lean_register_external_class(jack_peer_table_finalizer, jack_peer_table_foreach);
+    }
+    return lean_io_result_mk_ok(lean_alloc_external(g_peer_table_class, table));
+}
+
+/* Map `addr` to `session`, replacing any previous mapping. */
+LEAN_EXPORT lean_obj_res jack_peer_table_insert(
+    b_lean_obj_arg table_obj,
+    b_lean_obj_arg addr,
+    uint32_t session,
+    lean_obj_arg world
+) {
+    (void)world;
+    jack_peer_table_t *table = jack_peer_table_unbox(table_obj);
+    jack_peer_key_t key;
+    if (jack_peer_key_of_lean(addr, &key) < 0) {
+        return jack_peer_table_key_error();
+    }
+    jack_peer_slot_t *slot = jack_peer_table_lookup(table, &key);
+    if (slot) {
+        slot->session = session;
+        return lean_io_result_mk_ok(lean_box(0));
+    }
+    /* Keep load (tombstones included) under 3/4 */
+    if ((table->occupied + 1) * 4 > table->cap * 3) {
+        size_t cap = (table->live + 1) * 2 > table->cap ? table->cap * 2 : table->cap;
+        if (jack_peer_table_rehash(table, cap) < 0) {
+            return lean_io_result_mk_error(lean_mk_io_user_error(
+                lean_mk_string("Failed to grow peer table")));
+        }
+    }
+    size_t mask = table->cap - 1;
+    size_t i = (size_t)jack_peer_key_hash(&key) & mask;
+    while (table->slots[i].state == 1) i = (i + 1) & mask;
+    if (table->slots[i].state == 0) table->occupied++;
+    table->slots[i].key = key;
+    table->slots[i].session = session;
+    table->slots[i].state = 1;
+    table->live++;
+    return lean_io_result_mk_ok(lean_box(0));
+}
+
+LEAN_EXPORT lean_obj_res jack_peer_table_find(
+    b_lean_obj_arg table_obj,
+    b_lean_obj_arg addr,
+    lean_obj_arg world
+) {
+    (void)world;
+    jack_peer_key_t key;
+    if (jack_peer_key_of_lean(addr, &key) < 0) {
+        return lean_io_result_mk_ok(lean_box(0)); /* Option.none */
+    }
+    jack_peer_slot_t *slot = jack_peer_table_lookup(jack_peer_table_unbox(table_obj), &key);
+    if (!slot) {
+        return lean_io_result_mk_ok(lean_box(0));
+    }
+    lean_obj_res some = lean_alloc_ctor(1, 1, 0);
+    lean_ctor_set(some, 0, lean_box_uint32(slot->session));
+    return lean_io_result_mk_ok(some);
+}
+
+LEAN_EXPORT lean_obj_res jack_peer_table_erase(
+    b_lean_obj_arg table_obj,
+    b_lean_obj_arg addr,
+    lean_obj_arg world
+) {
+    (void)world;
+    jack_peer_table_t *table = jack_peer_table_unbox(table_obj);
+    jack_peer_key_t key;
+    if (jack_peer_key_of_lean(addr, &key) < 0) {
+        return lean_io_result_mk_ok(lean_box(0)); /* false */
+    }
+    jack_peer_slot_t *slot = jack_peer_table_lookup(table, &key);
+    if (!slot) {
+        return lean_io_result_mk_ok(lean_box(0));
+    }
+    slot->state = 2;
+    table->live--;
+    return lean_io_result_mk_ok(lean_box(1));
+}
+
+LEAN_EXPORT lean_obj_res jack_peer_table_size(b_lean_obj_arg table_obj, lean_obj_arg world) {
+    (void)world;
+    return lean_io_result_mk_ok(lean_usize_to_nat(jack_peer_table_unbox(table_obj)->live));
+}
+
+#define JACK_RECV_MANY_MAX 1024
+/* Datagrams per recvmmsg call; the headers live on the stack */
+#define JACK_RECV_MANY_BATCH 64
+
+/* PeerDatagram:
+ *   | known (session : UInt32) (data : ByteArray) (truncated : Bool)
+ *       -- tag 0, 1 object, then UInt32 and UInt8 scalars
+ *   | unknown (peer : SockAddr) (data : ByteArray) (truncated : Bool)
+ *       -- tag 1, 2 objects, then a UInt8 scalar
+ * Takes ownership of `data`. */
+static lean_obj_res jack_peer_datagram(jack_peer_table_t *table, lean_obj_arg data,
+                                       int truncated, struct sockaddr *from, socklen_t from_len) {
+    jack_peer_key_t key;
+    jack_peer_slot_t *slot = NULL;
+    if (jack_peer_key_of_sockaddr(from, &key) == 0) {
+        slot = jack_peer_table_lookup(table, &key);
+    }
+    if (slot) {
+        lean_obj_res obj = lean_alloc_ctor(0, 1, 4 + 1);
+        lean_ctor_set(obj, 0, data);
+        lean_ctor_set_uint32(obj, sizeof(void*), slot->session);
+        lean_ctor_set_uint8(obj, sizeof(void*) + 4, truncated ? 1 : 0);
+        return obj;
+    }
+    lean_obj_res obj = lean_alloc_ctor(1, 2, 1);
+    lean_ctor_set(obj, 0, sockaddr_to_lean(from, from_len));
+    lean_ctor_set(obj, 1, data);
+    lean_ctor_set_uint8(obj, 2 * sizeof(void*), truncated ? 1 : 0);
+    return obj;
+}
+
+/* Receive up to max_msgs datagrams: blocks (unless non-blocking or `flags` has
+ * MSG_DONTWAIT) for the first, then takes whatever else is queued. Each datagram is
+ * read straight into its own ByteArray; datagrams longer than max_bytes are cut and
+ * flagged truncated. Returns NULL with *err set on failure before any datagram was
+ * read. */
+static lean_obj_res jack_recv_from_many(jack_socket_t *sock, jack_peer_table_t *table,
+                                        uint32_t max_msgs, uint32_t max_bytes, int flags, int *err) {
+    if (max_msgs == 0) return lean_mk_empty_array();
+    if (max_msgs > JACK_RECV_MANY_MAX) max_msgs = JACK_RECV_MANY_MAX;
+    lean_obj_res out = lean_alloc_array(0, max_msgs < JACK_RECV_MANY_BATCH ? max_msgs : JACK_RECV_MANY_BATCH);
+    uint32_t got = 0;
+#ifdef __linux__
+    struct mmsghdr msgs[JACK_RECV_MANY_BATCH];
+    struct iovec iov[JACK_RECV_MANY_BATCH];
+    struct sockaddr_storage addrs[JACK_RECV_MANY_BATCH];
+    lean_object *data[JACK_RECV_MANY_BATCH];
+    while (got < max_msgs) {
+        uint32_t want = max_msgs - got < JACK_RECV_MANY_BATCH ? max_msgs - got : JACK_RECV_MANY_BATCH;
+        memset(msgs, 0, sizeof(struct mmsghdr) * want);
+        for (uint32_t i = 0; i < want; i++) {
+            data[i] = lean_alloc_sarray(1, max_bytes, max_bytes);
+            iov[i].iov_base = lean_sarray_cptr(data[i]);
+            iov[i].iov_len = max_bytes;
+            msgs[i].msg_hdr.msg_iov = &iov[i];
+            msgs[i].msg_hdr.msg_iovlen = 1;
+            msgs[i].msg_hdr.msg_name = &addrs[i];
+            msgs[i].msg_hdr.msg_namelen = sizeof(struct sockaddr_storage);
+        }
+        int n = recvmmsg(sock->fd, msgs, want,
+            got == 0 ? MSG_WAITFORONE | flags : MSG_DONTWAIT, NULL);
+        int saved = errno;
+        for (uint32_t i = 0; i < want; i++) {
+            if ((int)i >= n) {
+                lean_dec(data[i]);
+                continue;
+            }
+            size_t len = msgs[i].msg_len < max_bytes ? msgs[i].msg_len : max_bytes;
+            lean_to_sarray(data[i])->m_size = len;
+            int truncated = (msgs[i].msg_hdr.msg_flags & MSG_TRUNC) != 0;
+            out = lean_array_push(out, jack_peer_datagram(table, data[i], truncated,
+                (struct sockaddr *)&addrs[i], msgs[i].msg_hdr.msg_namelen));
+        }
+        if (n < 0) {
+            if (got == 0) {
+                *err = saved;
+                lean_dec(out);
+                return NULL;
+            }
+            break;
+        }
+        got += (uint32_t)n;
+        if ((uint32_t)n < want) break;
+    }
+#else
+    for (; got < max_msgs; got++) {
+        struct sockaddr_storage addr;
+        lean_object *data = lean_alloc_sarray(1, max_bytes, max_bytes);
+        struct iovec iov = { lean_sarray_cptr(data), max_bytes };
+        struct msghdr msg;
+        memset(&msg, 0, sizeof(msg));
+        msg.msg_name = &addr;
+        msg.msg_namelen = sizeof(struct sockaddr_storage);
+        msg.msg_iov = &iov;
+        msg.msg_iovlen = 1;
+        ssize_t n = recvmsg(sock->fd, &msg, got == 0 ? flags : MSG_DONTWAIT);
+        if (n < 0) {
+            int saved = errno;
+            lean_dec(data);
+            if (got == 0) {
+                *err = saved;
+                lean_dec(out);
+                return NULL;
+            }
+            break;
+        }
+        lean_to_sarray(data)->m_size = (size_t)n;
+        out = lean_array_push(out, jack_peer_datagram(table, data,
+            (msg.msg_flags & MSG_TRUNC) != 0, (struct sockaddr *)&addr, msg.msg_namelen));
+    }
+#endif
+    return out;
+}
+
+LEAN_EXPORT lean_obj_res jack_socket_recv_from_many(
+    b_lean_obj_arg sock_obj,
+    b_lean_obj_arg table_obj,
+    uint32_t max_msgs,
+    uint32_t max_bytes,
+    lean_obj_arg world
+) {
+    int err = 0;
+    lean_obj_res out = jack_recv_from_many(jack_socket_unbox(sock_obj),
+        jack_peer_table_unbox(table_obj), max_msgs, max_bytes, 0, &err);
+    if (!out) {
+        return jack_io_error_from_errno(err);
+    }
+    return lean_io_result_mk_ok(out);
+}
+
+LEAN_EXPORT lean_obj_res jack_socket_recv_from_many_try(
+    b_lean_obj_arg sock_obj,
+    b_lean_obj_arg table_obj,
+    uint32_t max_msgs,
+    uint32_t max_bytes,
+    lean_obj_arg world
+) {
+    int err = 0;
+    lean_obj_res out = jack_recv_from_many(jack_socket_unbox(sock_obj),
+        jack_peer_table_unbox(table_obj), max_msgs, max_bytes, MSG_DONTWAIT, &err);
+    if (!out) {
+        if (is_wouldblock_error(err)) {
+            return lean_io_result_mk_ok(jack_socket_result_wouldblock());
+        }
+        return lean_io_result_mk_ok(jack_socket_result_error(err));
+    }
+    return lean_io_result_mk_ok(jack_socket_result_ok(out));
+}
+
+/* ========== Address Operations ========== */
 
 /* Get local address */
 LEAN_EXPORT lean_obj_res jack_socket_get_local_addr(
@@ -2446,6 +4015,7 @@ LEAN_EXPORT lean_obj_res jack_socket_close(
         close(sock->fd);
         sock->fd = -1;
     }
+    jack_socket_drop_binding(sock);
 
     lean_dec_ref(sock_obj);
     return lean_io_result_mk_ok(lean_box(0));
@@ -2457,6 +4027,48 @@ LEAN_EXPORT uint32_t jack_socket_fd(b_lean_obj_arg sock_obj) {
     return (uint32_t)sock->fd;
 }
 
+/* Stable socket id: slab generation << 32 | slab slot */
+LEAN_EXPORT uint64_t jack_socket_id(b_lean_obj_arg sock_obj) {
+    return jack_socket_id_of(jack_socket_unbox(sock_obj));
+}
+
+/* Reactor bound to the socket: Option Reactor */
+LEAN_EXPORT lean_obj_res jack_socket_binding(b_lean_obj_arg sock_obj, lean_obj_arg world) {
+    (void)world;
+    jack_socket_t *sock = jack_socket_unbox(sock_obj);
+    while (atomic_flag_test_and_set_explicit(&sock->binding_lock, memory_order_acquire)) {
+    }
+    lean_object *binding = sock->binding;
+    if (binding) lean_inc(binding);
+    atomic_flag_clear_explicit(&sock->binding_lock, memory_order_release);
+    if (!binding) {
+        return lean_io_result_mk_ok(lean_box(0)); /* Option.none */
+    }
+    lean_obj_res some = lean_alloc_ctor(1, 1, 0);
+    lean_ctor_set(some, 0, binding);
+    return lean_io_result_mk_ok(some);
+}
+
+/* Bind (some) or unbind (none) a reactor; dropped again on close or finalization */
+LEAN_EXPORT lean_obj_res jack_socket_set_binding(
+    b_lean_obj_arg sock_obj,
+    lean_obj_arg binding_opt,
+    lean_obj_arg world
+) {
+    (void)world;
+    lean_object *binding = NULL;
+    if (!lean_is_scalar(binding_opt)) {
+        binding = lean_ctor_get(binding_opt, 0);
+        lean_inc(binding);
+        lean_dec(binding_opt);
+        /* Read from whichever thread awaits on the socket */
+        lean_mark_mt(binding);
+    }
+    lean_object *old = jack_socket_swap_binding(jack_socket_unbox(sock_obj), binding);
+    if (old) lean_dec(old);
+    return lean_io_result_mk_ok(lean_box(0));
+}
+
 /* Set socket recv/send timeouts in seconds */
 LEAN_EXPORT lean_obj_res jack_socket_set_timeout(
     b_lean_obj_arg sock_obj,
@@ -2602,83 +4214,232 @@ LEAN_EXPORT lean_obj_res jack_socket_set_tcp_keepcnt(
 #endif
 }
 
-/* Set raw socket option */
-LEAN_EXPORT lean_obj_res jack_socket_set_option(
+/* ========== TCP Fast Open ========== */
+
+/* Enable TCP_FASTOPEN on a listener with the given pending-queue length */
+LEAN_EXPORT lean_obj_res jack_socket_set_tcp_fastopen(
     b_lean_obj_arg sock_obj,
-    uint32_t level,
-    uint32_t opt_name,
-    b_lean_obj_arg value,
+    uint32_t qlen,
     lean_obj_arg world
 ) {
+    (void)world;
     jack_socket_t *sock = jack_socket_unbox(sock_obj);
-
-    size_t len = lean_sarray_size(value);
-    const uint8_t *ptr = lean_sarray_cptr(value);
-
-    if (setsockopt(sock->fd, (int)level, (int)opt_name, ptr, (socklen_t)len) < 0) {
+#ifdef TCP_FASTOPEN
+    int value = (int)qlen;
+    if (setsockopt(sock->fd, IPPROTO_TCP, TCP_FASTOPEN, &value, sizeof(value)) < 0) {
         return jack_io_error_from_errno(errno);
     }
-
     return lean_io_result_mk_ok(lean_box(0));
+#else
+    (void)sock;
+    (void)qlen;
+    return lean_io_result_mk_error(lean_mk_io_user_error(
+        lean_mk_string("Operation not supported")));
+#endif
 }
 
-/* Get raw socket option */
-LEAN_EXPORT lean_obj_res jack_socket_get_option(
+/* Enable TCP_FASTOPEN_CONNECT: connect() defers the SYN so the first send carries data */
+LEAN_EXPORT lean_obj_res jack_socket_set_tcp_fastopen_connect(
     b_lean_obj_arg sock_obj,
-    uint32_t level,
-    uint32_t opt_name,
-    uint32_t max_bytes,
+    uint8_t enabled,
     lean_obj_arg world
 ) {
+    (void)world;
     jack_socket_t *sock = jack_socket_unbox(sock_obj);
-
-    size_t len = (size_t)max_bytes;
-    uint8_t *buffer = malloc(len);
-    if (!buffer && len > 0) {
-        return lean_io_result_mk_error(lean_mk_io_user_error(
-            lean_mk_string("Failed to allocate buffer")));
+#ifdef TCP_FASTOPEN_CONNECT
+    int value = enabled ? 1 : 0;
+    if (setsockopt(sock->fd, IPPROTO_TCP, TCP_FASTOPEN_CONNECT, &value, sizeof(value)) < 0) {
+        return jack_io_error_from_errno(errno);
     }
+    return lean_io_result_mk_ok(lean_box(0));
+#else
+    (void)sock;
+    (void)enabled;
+    return lean_io_result_mk_error(lean_mk_io_user_error(
+        lean_mk_string("Operation not supported")));
+#endif
+}
 
-    socklen_t opt_len = (socklen_t)len;
-    if (getsockopt(sock->fd, (int)level, (int)opt_name, buffer, &opt_len) < 0) {
-        int err = errno;
-        free(buffer);
-        return jack_io_error_from_errno(err);
+/* Connect and send initial data in the SYN (MSG_FASTOPEN).
+ * Returns the number of bytes accepted by the kernel, or -1 with errno set.
+ * Where TFO is unavailable (no MSG_FASTOPEN, or client TFO disabled by the
+ * net.ipv4.tcp_fastopen sysctl) this degrades to connect() followed by send().
+ * A non-blocking connect still in progress reports EAGAIN, like a SYN sent
+ * without a cookie. */
+static ssize_t jack_fastopen_send(int fd, const struct sockaddr *sa, socklen_t sa_len,
+                                  const uint8_t *ptr, size_t len) {
+#ifdef MSG_FASTOPEN
+    ssize_t n = sendto(fd, ptr, len, MSG_FASTOPEN | MSG_NOSIGNAL, sa, sa_len);
+    if (n >= 0 || errno != EOPNOTSUPP) {
+        return n;
     }
-
-    lean_obj_res arr = lean_alloc_sarray(1, opt_len, opt_len);
-    if (opt_len > 0) {
-        memcpy(lean_sarray_cptr(arr), buffer, opt_len);
+#endif
+    if (connect(fd, sa, sa_len) < 0) {
+        if (errno == EINPROGRESS) {
+            errno = EAGAIN;
+        }
+        return -1;
     }
-    free(buffer);
-
-    return lean_io_result_mk_ok(arr);
+    return send(fd, ptr, len, MSG_NOSIGNAL);
 }
 
-/* Set socket option as UInt32 */
-LEAN_EXPORT lean_obj_res jack_socket_set_option_uint32(
+LEAN_EXPORT lean_obj_res jack_socket_connect_with_data(
     b_lean_obj_arg sock_obj,
-    uint32_t level,
-    uint32_t opt_name,
-    uint32_t value,
+    b_lean_obj_arg addr,
+    b_lean_obj_arg data,
     lean_obj_arg world
 ) {
+    (void)world;
     jack_socket_t *sock = jack_socket_unbox(sock_obj);
-    uint32_t opt_value = value;
 
-    if (setsockopt(sock->fd, (int)level, (int)opt_name, &opt_value, sizeof(opt_value)) < 0) {
-        return jack_io_error_from_errno(errno);
+    struct sockaddr_storage sa;
+    socklen_t sa_len;
+    if (lean_to_sockaddr(addr, &sa, &sa_len) < 0) {
+        return jack_io_error_from_errno(EINVAL);
     }
 
-    return lean_io_result_mk_ok(lean_box(0));
+    const uint8_t *ptr = lean_sarray_cptr(data);
+    size_t len = lean_sarray_size(data);
+    ssize_t n;
+    do {
+        n = jack_fastopen_send(sock->fd, (struct sockaddr *)&sa, sa_len, ptr, len);
+    } while (n < 0 && errno == EINTR);
+    if (n < 0) {
+        return jack_io_error_from_errno(errno);
+    }
+    return lean_io_result_mk_ok(lean_box_uint32((uint32_t)n));
 }
 
-/* Get socket option as UInt32 */
-LEAN_EXPORT lean_obj_res jack_socket_get_option_uint32(
+/* Non-blocking variant. ok n: SYN (with n bytes of data) sent, connection in progress
+ * or complete. wouldBlock: no cookie yet, only a SYN was sent; wait for writability,
+ * then send the data normally. */
+LEAN_EXPORT lean_obj_res jack_socket_connect_with_data_try(
     b_lean_obj_arg sock_obj,
-    uint32_t level,
-    uint32_t opt_name,
-    lean_obj_arg world
+    b_lean_obj_arg addr,
+    b_lean_obj_arg data,
+    lean_obj_arg world
+) {
+    (void)world;
+    jack_socket_t *sock = jack_socket_unbox(sock_obj);
+
+    struct sockaddr_storage sa;
+    socklen_t sa_len;
+    if (lean_to_sockaddr(addr, &sa, &sa_len) < 0) {
+        return lean_io_result_mk_ok(jack_socket_result_error(EINVAL));
+    }
+
+    const uint8_t *ptr = lean_sarray_cptr(data);
+    size_t len = lean_sarray_size(data);
+    ssize_t n = jack_fastopen_send(sock->fd, (struct sockaddr *)&sa, sa_len, ptr, len);
+    if (n < 0) {
+        int err = errno;
+        if (is_wouldblock_error(err)) {
+            return lean_io_result_mk_ok(jack_socket_result_wouldblock());
+        }
+        return lean_io_result_mk_ok(jack_socket_result_error(err));
+    }
+    return lean_io_result_mk_ok(jack_socket_result_ok(lean_box_uint32((uint32_t)n)));
+}
+
+/* True if data carried in the SYN was acknowledged (TCPI_OPT_SYN_DATA) */
+LEAN_EXPORT lean_obj_res jack_socket_fastopen_accepted(
+    b_lean_obj_arg sock_obj,
+    lean_obj_arg world
+) {
+    (void)world;
+    jack_socket_t *sock = jack_socket_unbox(sock_obj);
+#if defined(__linux__) && defined(TCP_INFO) && defined(TCPI_OPT_SYN_DATA)
+    struct tcp_info info;
+    socklen_t len = (socklen_t)sizeof(info);
+    memset(&info, 0, sizeof(info));
+    if (getsockopt(sock->fd, IPPROTO_TCP, TCP_INFO, &info, &len) < 0) {
+        return jack_io_error_from_errno(errno);
+    }
+    return lean_io_result_mk_ok(lean_box((info.tcpi_options & TCPI_OPT_SYN_DATA) ? 1 : 0));
+#else
+    (void)sock;
+    return lean_io_result_mk_error(lean_mk_io_user_error(
+        lean_mk_string("Operation not supported")));
+#endif
+}
+
+/* Set raw socket option */
+LEAN_EXPORT lean_obj_res jack_socket_set_option(
+    b_lean_obj_arg sock_obj,
+    uint32_t level,
+    uint32_t opt_name,
+    b_lean_obj_arg value,
+    lean_obj_arg world
+) {
+    jack_socket_t *sock = jack_socket_unbox(sock_obj);
+
+    size_t len = lean_sarray_size(value);
+    const uint8_t *ptr = lean_sarray_cptr(value);
+
+    if (setsockopt(sock->fd, (int)level, (int)opt_name, ptr, (socklen_t)len) < 0) {
+        return jack_io_error_from_errno(errno);
+    }
+
+    return lean_io_result_mk_ok(lean_box(0));
+}
+
+/* Get raw socket option */
+LEAN_EXPORT lean_obj_res jack_socket_get_option(
+    b_lean_obj_arg sock_obj,
+    uint32_t level,
+    uint32_t opt_name,
+    uint32_t max_bytes,
+    lean_obj_arg world
+) {
+    jack_socket_t *sock = jack_socket_unbox(sock_obj);
+
+    size_t len = (size_t)max_bytes;
+    uint8_t *buffer = malloc(len);
+    if (!buffer && len > 0) {
+        return lean_io_result_mk_error(lean_mk_io_user_error(
+            lean_mk_string("Failed to allocate buffer")));
+    }
+
+    socklen_t opt_len = (socklen_t)len;
+    if (getsockopt(sock->fd, (int)level, (int)opt_name, buffer, &opt_len) < 0) {
+        int err = errno;
+        free(buffer);
+        return jack_io_error_from_errno(err);
+    }
+
+    lean_obj_res arr = lean_alloc_sarray(1, opt_len, opt_len);
+    if (opt_len > 0) {
+        memcpy(lean_sarray_cptr(arr), buffer, opt_len);
+    }
+    free(buffer);
+
+    return lean_io_result_mk_ok(arr);
+}
+
+/* Set socket option as UInt32 */
+LEAN_EXPORT lean_obj_res jack_socket_set_option_uint32(
+    b_lean_obj_arg sock_obj,
+    uint32_t level,
+    uint32_t opt_name,
+    uint32_t value,
+    lean_obj_arg world
+) {
+    jack_socket_t *sock = jack_socket_unbox(sock_obj);
+    uint32_t opt_value = value;
+
+    if (setsockopt(sock->fd, (int)level, (int)opt_name, &opt_value, sizeof(opt_value)) < 0) {
+        return jack_io_error_from_errno(errno);
+    }
+
+    return lean_io_result_mk_ok(lean_box(0));
+}
+
+/* Get socket option as UInt32 */
+LEAN_EXPORT lean_obj_res jack_socket_get_option_uint32(
+    b_lean_obj_arg sock_obj,
+    uint32_t level,
+    uint32_t opt_name,
+    lean_obj_arg world
 ) {
     jack_socket_t *sock = jack_socket_unbox(sock_obj);
     uint32_t opt_value = 0;
@@ -2729,171 +4490,2912 @@ LEAN_EXPORT lean_obj_res jack_socket_get_linger(
     return lean_io_result_mk_ok(pair);
 }
 
-/* ========== Non-blocking I/O ========== */
+/* ========== CPU Affinity ========== */
 
-/* Set socket to non-blocking mode */
-LEAN_EXPORT lean_obj_res jack_socket_set_nonblocking(
-    b_lean_obj_arg sock_obj,
-    uint8_t nonblocking,
-    lean_obj_arg world
-) {
-    jack_socket_t *sock = jack_socket_unbox(sock_obj);
+/* Number of online CPUs (at least 1) */
+LEAN_EXPORT lean_obj_res jack_cpu_count(lean_obj_arg world) {
+    (void)world;
+    long n = sysconf(_SC_NPROCESSORS_ONLN);
+    if (n < 1) {
+        n = 1;
+    }
+    return lean_io_result_mk_ok(lean_box_uint32((uint32_t)n));
+}
 
-    int flags = fcntl(sock->fd, F_GETFL, 0);
-    if (flags < 0) {
+/* CPU the calling thread is currently running on */
+LEAN_EXPORT lean_obj_res jack_current_cpu(lean_obj_arg world) {
+    (void)world;
+#ifdef __linux__
+    int cpu = sched_getcpu();
+    if (cpu < 0) {
         return jack_io_error_from_errno(errno);
     }
+    return lean_io_result_mk_ok(lean_box_uint32((uint32_t)cpu));
+#else
+    return lean_io_result_mk_error(lean_mk_io_user_error(
+        lean_mk_string("Operation not supported")));
+#endif
+}
 
-    if (nonblocking) {
-        flags |= O_NONBLOCK;
-    } else {
-        flags &= ~O_NONBLOCK;
+/* Pin the calling thread to a single CPU */
+LEAN_EXPORT lean_obj_res jack_pin_thread_cpu(uint32_t cpu, lean_obj_arg world) {
+    (void)world;
+#ifdef __linux__
+    if (cpu >= CPU_SETSIZE) {
+        return jack_io_error_from_errno(EINVAL);
     }
-
-    if (fcntl(sock->fd, F_SETFL, flags) < 0) {
-        return jack_io_error_from_errno(errno);
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET((int)cpu, &set);
+    int rc = pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+    if (rc != 0) {
+        return jack_io_error_from_errno(rc);
     }
-
     return lean_io_result_mk_ok(lean_box(0));
+#else
+    (void)cpu;
+    return lean_io_result_mk_error(lean_mk_io_user_error(
+        lean_mk_string("Operation not supported")));
+#endif
 }
 
-/* Convert Lean PollEvent array to poll events bitmask
- * PollEvent: readable=0, writable=1, error=2, hangup=3
- */
-static short lean_events_to_poll(b_lean_obj_arg events) {
-    short result = 0;
-    size_t len = lean_array_size(events);
-
-    for (size_t i = 0; i < len; i++) {
-        lean_obj_arg ev = lean_array_get_core(events, i);
-        unsigned tag = lean_unbox(ev);
-        switch (tag) {
-            case 0: result |= POLLIN; break;   /* readable */
-            case 1: result |= POLLOUT; break;  /* writable */
-            case 2: result |= POLLERR; break;  /* error */
-            case 3: result |= POLLHUP; break;  /* hangup */
-        }
+/* Set SO_INCOMING_CPU (steer the socket's RX processing to a CPU) */
+LEAN_EXPORT lean_obj_res jack_socket_set_incoming_cpu(
+    b_lean_obj_arg sock_obj,
+    uint32_t cpu,
+    lean_obj_arg world
+) {
+    (void)world;
+    jack_socket_t *sock = jack_socket_unbox(sock_obj);
+#ifdef SO_INCOMING_CPU
+    int value = (int)cpu;
+    if (setsockopt(sock->fd, SOL_SOCKET, SO_INCOMING_CPU, &value, sizeof(value)) < 0) {
+        return jack_io_error_from_errno(errno);
     }
-
-    return result;
+    return lean_io_result_mk_ok(lean_box(0));
+#else
+    (void)sock;
+    (void)cpu;
+    return lean_io_result_mk_error(lean_mk_io_user_error(
+        lean_mk_string("Operation not supported")));
+#endif
 }
 
-/* Convert poll revents to Lean PollEvent array */
-static lean_obj_res poll_to_lean_events(short revents) {
-    size_t count = 0;
-    if (revents & POLLIN) count++;
-    if (revents & POLLOUT) count++;
-    if (revents & POLLERR) count++;
-    if (revents & POLLHUP) count++;
-
-    lean_obj_res arr = lean_alloc_array(count, count);
-    size_t idx = 0;
-
-    if (revents & POLLIN) {
-        lean_array_set_core(arr, idx++, lean_box(0));  /* readable */
-    }
-    if (revents & POLLOUT) {
-        lean_array_set_core(arr, idx++, lean_box(1));  /* writable */
-    }
-    if (revents & POLLERR) {
-        lean_array_set_core(arr, idx++, lean_box(2));  /* error */
+/* Get SO_INCOMING_CPU (CPU that last processed the socket's RX softirq).
+ * Returns none when the kernel has not recorded a CPU yet. */
+LEAN_EXPORT lean_obj_res jack_socket_get_incoming_cpu(
+    b_lean_obj_arg sock_obj,
+    lean_obj_arg world
+) {
+    (void)world;
+    jack_socket_t *sock = jack_socket_unbox(sock_obj);
+#ifdef SO_INCOMING_CPU
+    int value = -1;
+    socklen_t len = (socklen_t)sizeof(value);
+    if (getsockopt(sock->fd, SOL_SOCKET, SO_INCOMING_CPU, &value, &len) < 0) {
+        return jack_io_error_from_errno(errno);
     }
-    if (revents & POLLHUP) {
-        lean_array_set_core(arr, idx++, lean_box(3));  /* hangup */
+    if (value < 0) {
+        return lean_io_result_mk_ok(lean_box(0));
     }
+    lean_obj_res some = lean_alloc_ctor(1, 1, 0);
+    lean_ctor_set(some, 0, lean_box_uint32((uint32_t)value));
+    return lean_io_result_mk_ok(some);
+#else
+    (void)sock;
+    return lean_io_result_mk_error(lean_mk_io_user_error(
+        lean_mk_string("Operation not supported")));
+#endif
+}
 
-    return arr;
+/* ========== TCP_INFO ========== */
+
+#if defined(__linux__) && defined(TCP_INFO)
+/* Kernel struct tcp_info layout (linux/tcp.h) up to tcpi_delivery_rate.
+ * glibc's netinet/tcp.h copy lags behind the kernel, so the layout is spelled out here;
+ * older kernels return a shorter struct and the tail stays zeroed. */
+struct jack_tcp_info {
+    uint8_t  state;
+    uint8_t  ca_state;
+    uint8_t  retransmits;
+    uint8_t  probes;
+    uint8_t  backoff;
+    uint8_t  options;
+    uint8_t  wscale;
+    uint8_t  app_limited;
+
+    uint32_t rto;
+    uint32_t ato;
+    uint32_t snd_mss;
+    uint32_t rcv_mss;
+
+    uint32_t unacked;
+    uint32_t sacked;
+    uint32_t lost;
+    uint32_t retrans;
+    uint32_t fackets;
+
+    uint32_t last_data_sent;
+    uint32_t last_ack_sent;
+    uint32_t last_data_recv;
+    uint32_t last_ack_recv;
+
+    uint32_t pmtu;
+    uint32_t rcv_ssthresh;
+    uint32_t rtt;
+    uint32_t rttvar;
+    uint32_t snd_ssthresh;
+    uint32_t snd_cwnd;
+    uint32_t advmss;
+    uint32_t reordering;
+
+    uint32_t rcv_rtt;
+    uint32_t rcv_space;
+
+    uint32_t total_retrans;
+
+    uint64_t pacing_rate;
+    uint64_t max_pacing_rate;
+    uint64_t bytes_acked;
+    uint64_t bytes_received;
+    uint32_t segs_out;
+    uint32_t segs_in;
+
+    uint32_t notsent_bytes;
+    uint32_t min_rtt;
+    uint32_t data_segs_in;
+    uint32_t data_segs_out;
+
+    uint64_t delivery_rate;
+};
+
+/* TcpInfo: scalar-only structure, fields laid out by size:
+ * UInt64 pacingRate, deliveryRate, bytesAcked, bytesReceived (offsets 0..24)
+ * UInt32 rttUs, rttVarUs, minRttUs, sndCwnd, sndSsthresh, retransmits,
+ *        retransOutstanding, lost, unacked (offsets 32..64)
+ * UInt8  state (offset 68) */
+#define JACK_TCP_INFO_SCALARS (4 * 8 + 9 * 4 + 1)
+
+static int jack_read_tcp_info(int fd, struct jack_tcp_info *info) {
+    socklen_t len = (socklen_t)sizeof(*info);
+    memset(info, 0, sizeof(*info));
+    return getsockopt(fd, IPPROTO_TCP, TCP_INFO, info, &len);
 }
 
-/* Poll single socket for events */
-LEAN_EXPORT lean_obj_res jack_socket_poll(
+static lean_obj_res jack_tcp_info_to_lean(const struct jack_tcp_info *info) {
+    lean_obj_res obj = lean_alloc_ctor(0, 0, JACK_TCP_INFO_SCALARS);
+    lean_ctor_set_uint64(obj, 0, info->pacing_rate);
+    lean_ctor_set_uint64(obj, 8, info->delivery_rate);
+    lean_ctor_set_uint64(obj, 16, info->bytes_acked);
+    lean_ctor_set_uint64(obj, 24, info->bytes_received);
+    lean_ctor_set_uint32(obj, 32, info->rtt);
+    lean_ctor_set_uint32(obj, 36, info->rttvar);
+    lean_ctor_set_uint32(obj, 40, info->min_rtt);
+    lean_ctor_set_uint32(obj, 44, info->snd_cwnd);
+    lean_ctor_set_uint32(obj, 48, info->snd_ssthresh);
+    lean_ctor_set_uint32(obj, 52, info->total_retrans);
+    lean_ctor_set_uint32(obj, 56, info->retrans);
+    lean_ctor_set_uint32(obj, 60, info->lost);
+    lean_ctor_set_uint32(obj, 64, info->unacked);
+    lean_ctor_set_uint8(obj, 68, info->state);
+    return obj;
+}
+#endif
+
+/* Get a decoded TCP_INFO snapshot */
+LEAN_EXPORT lean_obj_res jack_socket_tcp_info(
     b_lean_obj_arg sock_obj,
-    b_lean_obj_arg events,
-    int32_t timeout_ms,
     lean_obj_arg world
 ) {
+    (void)world;
     jack_socket_t *sock = jack_socket_unbox(sock_obj);
-
-    struct pollfd pfd;
-    pfd.fd = sock->fd;
-    pfd.events = lean_events_to_poll(events);
-    pfd.revents = 0;
-
-    int ret = poll(&pfd, 1, timeout_ms);
-    if (ret < 0) {
+#if defined(__linux__) && defined(TCP_INFO)
+    struct jack_tcp_info info;
+    if (jack_read_tcp_info(sock->fd, &info) < 0) {
         return jack_io_error_from_errno(errno);
     }
-
-    return lean_io_result_mk_ok(poll_to_lean_events(pfd.revents));
+    return lean_io_result_mk_ok(jack_tcp_info_to_lean(&info));
+#else
+    (void)sock;
+    return lean_io_result_mk_error(lean_mk_io_user_error(
+        lean_mk_string("Operation not supported")));
+#endif
 }
 
-/* Poll multiple sockets for events
- * PollEntry: { socket : Socket, events : Array PollEvent }
- * PollResult: { socket : Socket, events : Array PollEvent }
- */
-LEAN_EXPORT lean_obj_res jack_poll_wait(
-    b_lean_obj_arg entries,
-    int32_t timeout_ms,
+/* Sample TCP_INFO for many sockets in one call; none for sockets that fail */
+LEAN_EXPORT lean_obj_res jack_socket_tcp_info_many(
+    b_lean_obj_arg socks,
     lean_obj_arg world
 ) {
-    size_t count = lean_array_size(entries);
-
-    if (count == 0) {
-        return lean_io_result_mk_ok(lean_alloc_array(0, 0));
+    (void)world;
+    size_t count = lean_array_size(socks);
+    lean_obj_res results = lean_alloc_array(count, count);
+    for (size_t i = 0; i < count; i++) {
+        lean_obj_res entry = lean_box(0); /* Option.none */
+#if defined(__linux__) && defined(TCP_INFO)
+        jack_socket_t *sock = jack_socket_unbox(lean_array_get_core(socks, i));
+        struct jack_tcp_info info;
+        if (jack_read_tcp_info(sock->fd, &info) == 0) {
+            entry = lean_alloc_ctor(1, 1, 0);
+            lean_ctor_set(entry, 0, jack_tcp_info_to_lean(&info));
+        }
+#endif
+        lean_array_set_core(results, i, entry);
     }
+    return lean_io_result_mk_ok(results);
+}
 
-    struct pollfd *pfds = malloc(count * sizeof(struct pollfd));
-    if (!pfds) {
-        return lean_io_result_mk_error(lean_mk_io_user_error(
-            lean_mk_string("Failed to allocate poll array")));
+/* Bytes in the kernel send queue not yet acknowledged by the peer (SIOCOUTQ) */
+LEAN_EXPORT lean_obj_res jack_socket_send_queue_bytes(
+    b_lean_obj_arg sock_obj,
+    lean_obj_arg world
+) {
+    (void)world;
+    jack_socket_t *sock = jack_socket_unbox(sock_obj);
+#if defined(__linux__) && defined(TIOCOUTQ)
+    int queued = 0;
+    if (ioctl(sock->fd, TIOCOUTQ, &queued) < 0) {
+        return jack_io_error_from_errno(errno);
     }
+    return lean_io_result_mk_ok(lean_box_uint32((uint32_t)(queued < 0 ? 0 : queued)));
+#else
+    (void)sock;
+    return lean_io_result_mk_error(lean_mk_io_user_error(
+        lean_mk_string("Operation not supported")));
+#endif
+}
 
-    /* Build pollfd array */
-    for (size_t i = 0; i < count; i++) {
-        lean_obj_arg entry = lean_array_get_core(entries, i);
-        lean_obj_arg sock_obj_i = lean_ctor_get(entry, 0);
-        lean_obj_arg events_i = lean_ctor_get(entry, 1);
+/* ========== Busy Polling ========== */
 
-        jack_socket_t *sock = jack_socket_unbox(sock_obj_i);
-        pfds[i].fd = sock->fd;
-        pfds[i].events = lean_events_to_poll(events_i);
-        pfds[i].revents = 0;
+static lean_obj_res jack_set_int_sockopt(int fd, int level, int name, int value) {
+    if (setsockopt(fd, level, name, &value, sizeof(value)) < 0) {
+        return jack_io_error_from_errno(errno);
     }
+    return lean_io_result_mk_ok(lean_box(0));
+}
 
-    int ret = poll(pfds, count, timeout_ms);
-    if (ret < 0) {
+/* Set SO_BUSY_POLL (microseconds to busy poll the device queue on blocking reads) */
+LEAN_EXPORT lean_obj_res jack_socket_set_busy_poll(
+    b_lean_obj_arg sock_obj,
+    uint32_t usec,
+    lean_obj_arg world
+) {
+    (void)world;
+    jack_socket_t *sock = jack_socket_unbox(sock_obj);
+#ifdef SO_BUSY_POLL
+    return jack_set_int_sockopt(sock->fd, SOL_SOCKET, SO_BUSY_POLL, (int)usec);
+#else
+    (void)sock;
+    (void)usec;
+    return lean_io_result_mk_error(lean_mk_io_user_error(
+        lean_mk_string("Operation not supported")));
+#endif
+}
+
+/* Get SO_BUSY_POLL (microseconds) */
+LEAN_EXPORT lean_obj_res jack_socket_get_busy_poll(
+    b_lean_obj_arg sock_obj,
+    lean_obj_arg world
+) {
+    (void)world;
+    jack_socket_t *sock = jack_socket_unbox(sock_obj);
+#ifdef SO_BUSY_POLL
+    int value = 0;
+    socklen_t len = (socklen_t)sizeof(value);
+    if (getsockopt(sock->fd, SOL_SOCKET, SO_BUSY_POLL, &value, &len) < 0) {
+        return jack_io_error_from_errno(errno);
+    }
+    return lean_io_result_mk_ok(lean_box_uint32((uint32_t)value));
+#else
+    (void)sock;
+    return lean_io_result_mk_error(lean_mk_io_user_error(
+        lean_mk_string("Operation not supported")));
+#endif
+}
+
+/* Set SO_PREFER_BUSY_POLL (prefer busy polling over softirq processing) */
+LEAN_EXPORT lean_obj_res jack_socket_set_prefer_busy_poll(
+    b_lean_obj_arg sock_obj,
+    uint8_t enabled,
+    lean_obj_arg world
+) {
+    (void)world;
+    jack_socket_t *sock = jack_socket_unbox(sock_obj);
+#ifdef SO_PREFER_BUSY_POLL
+    return jack_set_int_sockopt(sock->fd, SOL_SOCKET, SO_PREFER_BUSY_POLL, enabled ? 1 : 0);
+#else
+    (void)sock;
+    (void)enabled;
+    return lean_io_result_mk_error(lean_mk_io_user_error(
+        lean_mk_string("Operation not supported")));
+#endif
+}
+
+/* Set SO_BUSY_POLL_BUDGET (packets processed per busy-poll iteration) */
+LEAN_EXPORT lean_obj_res jack_socket_set_busy_poll_budget(
+    b_lean_obj_arg sock_obj,
+    uint32_t budget,
+    lean_obj_arg world
+) {
+    (void)world;
+    jack_socket_t *sock = jack_socket_unbox(sock_obj);
+#ifdef SO_BUSY_POLL_BUDGET
+    return jack_set_int_sockopt(sock->fd, SOL_SOCKET, SO_BUSY_POLL_BUDGET, (int)budget);
+#else
+    (void)sock;
+    (void)budget;
+    return lean_io_result_mk_error(lean_mk_io_user_error(
+        lean_mk_string("Operation not supported")));
+#endif
+}
+
+/* ========== Kernel Timestamps ========== */
+
+LEAN_EXPORT lean_obj_res jack_realtime_now(lean_obj_arg world) {
+    (void)world;
+    struct timespec ts;
+    clock_gettime(CLOCK_REALTIME, &ts);
+    return lean_io_result_mk_ok(jack_mk_kernel_timestamp(&ts));
+}
+
+/* Set SO_TIMESTAMPNS (nanosecond arrival time as SCM_TIMESTAMPNS) */
+LEAN_EXPORT lean_obj_res jack_socket_set_timestamp_ns(
+    b_lean_obj_arg sock_obj,
+    uint8_t enable,
+    lean_obj_arg world
+) {
+    (void)world;
+    jack_socket_t *sock = jack_socket_unbox(sock_obj);
+#ifdef SO_TIMESTAMPNS
+    return jack_set_int_sockopt(sock->fd, SOL_SOCKET, SO_TIMESTAMPNS, enable ? 1 : 0);
+#else
+    (void)sock;
+    (void)enable;
+    return lean_io_result_mk_error(lean_mk_io_user_error(
+        lean_mk_string("Operation not supported")));
+#endif
+}
+
+/* Set SO_TIMESTAMPING software flags. TX timestamps carry an id (OPT_ID) and no
+ * payload copy (OPT_TSONLY), so reading them back is cheap. */
+LEAN_EXPORT lean_obj_res jack_socket_set_timestamping(
+    b_lean_obj_arg sock_obj,
+    uint8_t rx,
+    uint8_t tx,
+    lean_obj_arg world
+) {
+    (void)world;
+    jack_socket_t *sock = jack_socket_unbox(sock_obj);
+#if defined(__linux__) && defined(SO_TIMESTAMPING)
+    int flags = 0;
+    if (rx) {
+        flags |= SOF_TIMESTAMPING_RX_SOFTWARE | SOF_TIMESTAMPING_SOFTWARE;
+    }
+    if (tx) {
+        flags |= SOF_TIMESTAMPING_TX_SOFTWARE | SOF_TIMESTAMPING_TX_SCHED |
+            SOF_TIMESTAMPING_SOFTWARE | SOF_TIMESTAMPING_OPT_ID | SOF_TIMESTAMPING_OPT_TSONLY;
+        int type = 0;
+        socklen_t len = sizeof(type);
+        if (getsockopt(sock->fd, SOL_SOCKET, SO_TYPE, &type, &len) == 0 && type == SOCK_STREAM) {
+            flags |= SOF_TIMESTAMPING_TX_ACK;
+        }
+    }
+    return jack_set_int_sockopt(sock->fd, SOL_SOCKET, SO_TIMESTAMPING, flags);
+#else
+    (void)sock;
+    (void)rx;
+    (void)tx;
+    return lean_io_result_mk_error(lean_mk_io_user_error(
+        lean_mk_string("Operation not supported")));
+#endif
+}
+
+/* Read TX timestamps from the error queue (MSG_ERRQUEUE) until it is empty.
+ * TxTimestamp layout: timestamp object, then id (u32) and kind (u8). */
+LEAN_EXPORT lean_obj_res jack_socket_read_tx_timestamps(
+    b_lean_obj_arg sock_obj,
+    uint32_t max_count,
+    lean_obj_arg world
+) {
+    (void)world;
+    jack_socket_t *sock = jack_socket_unbox(sock_obj);
+#if defined(__linux__) && defined(SCM_TIMESTAMPING)
+    lean_obj_res arr = lean_alloc_array(0, max_count);
+    char control[CMSG_SPACE(3 * sizeof(struct timespec)) + CMSG_SPACE(sizeof(struct sock_extended_err) + sizeof(struct sockaddr_in6))];
+    while (lean_array_size(arr) < max_count) {
+        struct msghdr msg;
+        memset(&msg, 0, sizeof(msg));
+        msg.msg_control = control;
+        msg.msg_controllen = sizeof(control);
+        ssize_t n = recvmsg(sock->fd, &msg, MSG_ERRQUEUE | MSG_DONTWAIT);
+        if (n < 0) {
+            int err = errno;
+            if (err == EINTR) {
+                continue;
+            }
+            if (is_wouldblock_error(err) || lean_array_size(arr) > 0) {
+                break;
+            }
+            lean_dec(arr);
+            return jack_io_error_from_errno(err);
+        }
+
+        int have_ts = 0;
+        int have_id = 0;
+        struct timespec ts = {0};
+        uint32_t id = 0;
+        uint32_t kind = 0;
+        for (struct cmsghdr *cmsg = CMSG_FIRSTHDR(&msg); cmsg != NULL; cmsg = CMSG_NXTHDR(&msg, cmsg)) {
+            if (cmsg->cmsg_level == SOL_SOCKET && cmsg->cmsg_type == SCM_TIMESTAMPING &&
+                cmsg->cmsg_len >= CMSG_LEN(3 * sizeof(struct timespec))) {
+                struct timespec stamps[3];
+                memcpy(stamps, CMSG_DATA(cmsg), sizeof(stamps));
+                ts = stamps[0];
+                have_ts = 1;
+            } else if ((cmsg->cmsg_level == SOL_IP && cmsg->cmsg_type == IP_RECVERR) ||
+                       (cmsg->cmsg_level == SOL_IPV6 && cmsg->cmsg_type == IPV6_RECVERR)) {
+                struct sock_extended_err serr;
+                memcpy(&serr, CMSG_DATA(cmsg), sizeof(serr));
+                if (serr.ee_errno == ENOMSG && serr.ee_origin == SO_EE_ORIGIN_TIMESTAMPING) {
+                    id = serr.ee_data;
+                    kind = serr.ee_info;
+                    have_id = 1;
+                }
+            }
+        }
+        if (!have_ts || !have_id) {
+            continue;
+        }
+
+        lean_obj_res entry = lean_alloc_ctor(0, 1, sizeof(uint32_t) + sizeof(uint8_t));
+        lean_ctor_set(entry, 0, jack_mk_kernel_timestamp(&ts));
+        lean_ctor_set_uint32(entry, sizeof(void *), id);
+        /* SCM_TSTAMP_SND = 0, SCM_TSTAMP_SCHED = 1, SCM_TSTAMP_ACK = 2, as in TxTimestampKind */
+        lean_ctor_set_uint8(entry, sizeof(void *) + sizeof(uint32_t), (uint8_t)(kind <= 2 ? kind : 0));
+        arr = lean_array_push(arr, entry);
+    }
+    return lean_io_result_mk_ok(arr);
+#else
+    (void)sock;
+    (void)max_count;
+    return lean_io_result_mk_error(lean_mk_io_user_error(
+        lean_mk_string("Operation not supported")));
+#endif
+}
+
+/* Receive data and sender address with the kernel arrival timestamp */
+LEAN_EXPORT lean_obj_res jack_socket_recv_from_timestamped(
+    b_lean_obj_arg sock_obj,
+    uint32_t max_bytes,
+    lean_obj_arg world
+) {
+    (void)world;
+    jack_socket_t *sock = jack_socket_unbox(sock_obj);
+
+    lean_obj_res arr = lean_alloc_sarray(1, 0, max_bytes);
+    struct sockaddr_storage from_addr;
+    char control[JACK_RX_TS_SPACE];
+    struct iovec iov = { lean_sarray_cptr(arr), max_bytes };
+    struct msghdr msg;
+    memset(&msg, 0, sizeof(msg));
+    msg.msg_name = &from_addr;
+    msg.msg_namelen = sizeof(from_addr);
+    msg.msg_iov = &iov;
+    msg.msg_iovlen = 1;
+    msg.msg_control = control;
+    msg.msg_controllen = sizeof(control);
+
+    ssize_t n = recvmsg(sock->fd, &msg, 0);
+    if (n < 0) {
         int err = errno;
-        free(pfds);
+        lean_dec(arr);
         return jack_io_error_from_errno(err);
     }
+    struct timespec pickup;
+    clock_gettime(CLOCK_REALTIME, &pickup);
+    lean_to_sarray(arr)->m_size = (size_t)n;
+
+    lean_obj_res lean_addr = sockaddr_to_lean((struct sockaddr *)&from_addr, msg.msg_namelen);
+    lean_obj_res rest = lean_alloc_ctor(0, 2, 0);
+    lean_ctor_set(rest, 0, lean_addr);
+    lean_ctor_set(rest, 1, jack_rx_timestamp_opt(&msg, &pickup));
+    lean_obj_res triple = lean_alloc_ctor(0, 2, 0);
+    lean_ctor_set(triple, 0, arr);
+    lean_ctor_set(triple, 1, rest);
+    return lean_io_result_mk_ok(triple);
+}
 
-    /* Count results with events */
-    size_t result_count = 0;
-    for (size_t i = 0; i < count; i++) {
-        if (pfds[i].revents != 0) {
-            result_count++;
+/* ========== Listener Groups ========== */
+
+/* Attach a classic BPF program to an SO_REUSEPORT group that steers each
+ * packet/connection to listener (cpu % group_size), i.e. the listener owned by
+ * the CPU that received it. The program applies to the whole group, so it only
+ * needs to be attached to one member. */
+LEAN_EXPORT lean_obj_res jack_socket_attach_reuseport_cpu_bpf(
+    b_lean_obj_arg sock_obj,
+    uint32_t group_size,
+    lean_obj_arg world
+) {
+    (void)world;
+    jack_socket_t *sock = jack_socket_unbox(sock_obj);
+#if defined(__linux__) && defined(SO_ATTACH_REUSEPORT_CBPF)
+    if (group_size == 0) {
+        return jack_io_error_from_errno(EINVAL);
+    }
+    struct sock_filter code[] = {
+        /* A = raw_smp_processor_id() */
+        { BPF_LD | BPF_W | BPF_ABS, 0, 0, (uint32_t)(SKF_AD_OFF + SKF_AD_CPU) },
+        /* A = A % group_size */
+        { BPF_ALU | BPF_MOD | BPF_K, 0, 0, group_size },
+        /* return A (index into the reuseport group) */
+        { BPF_RET | BPF_A, 0, 0, 0 },
+    };
+    struct sock_fprog prog;
+    prog.len = (unsigned short)(sizeof(code) / sizeof(code[0]));
+    prog.filter = code;
+    if (setsockopt(sock->fd, SOL_SOCKET, SO_ATTACH_REUSEPORT_CBPF, &prog, sizeof(prog)) < 0) {
+        return jack_io_error_from_errno(errno);
+    }
+    return lean_io_result_mk_ok(lean_box(0));
+#else
+    (void)sock;
+    (void)group_size;
+    return lean_io_result_mk_error(lean_mk_io_user_error(
+        lean_mk_string("Operation not supported")));
+#endif
+}
+
+/* ========== Drain (edge-triggered) ========== */
+
+/* Receive until EAGAIN, EOF or max_bytes into one buffer.
+ * RecvDrain: { data : ByteArray, stillReady : Bool, eof : Bool }
+ * Errors after some data was read are deferred to the next call. */
+LEAN_EXPORT lean_obj_res jack_socket_recv_drain(
+    b_lean_obj_arg sock_obj,
+    uint32_t max_bytes,
+    lean_obj_arg world
+) {
+    (void)world;
+    jack_socket_t *sock = jack_socket_unbox(sock_obj);
+
+    /* Start from what is already queued so a single read usually suffices */
+    int queued = 0;
+    size_t cap = JACK_DRAIN_CHUNK;
+    if (ioctl(sock->fd, FIONREAD, &queued) == 0 && (size_t)queued > cap) {
+        cap = (size_t)queued;
+    }
+    if (cap > max_bytes) cap = max_bytes;
+    lean_obj_res data = lean_alloc_sarray(1, 0, cap);
+    size_t len = 0;
+    int still_ready = 1;
+    int eof = 0;
+
+    while (len < max_bytes) {
+        size_t want = (size_t)max_bytes - len;
+        if (want > JACK_DRAIN_CHUNK) want = JACK_DRAIN_CHUNK;
+        if (cap - len < want) {
+            size_t new_cap = cap ? cap * 2 : want;
+            while (new_cap - len < want) new_cap *= 2;
+            if (new_cap > max_bytes) new_cap = max_bytes;
+            lean_obj_res grown = lean_alloc_sarray(1, len, new_cap);
+            memcpy(lean_sarray_cptr(grown), lean_sarray_cptr(data), len);
+            lean_dec(data);
+            data = grown;
+            cap = new_cap;
+        }
+        ssize_t n = recv(sock->fd, lean_sarray_cptr(data) + len, want, 0);
+        if (n < 0) {
+            int err = errno;
+            if (err == EINTR) {
+                continue;
+            }
+            if (is_wouldblock_error(err)) {
+                still_ready = 0;
+                break;
+            }
+            if (len == 0) {
+                lean_dec(data);
+                return jack_io_error_from_errno(err);
+            }
+            break;
+        }
+        if (n == 0) {
+            eof = 1;
+            still_ready = 0;
+            break;
         }
+        len += (size_t)n;
     }
+    lean_to_sarray(data)->m_size = len;
 
-    /* Build result array */
-    lean_obj_res results = lean_alloc_array(result_count, result_count);
-    size_t result_idx = 0;
+    lean_obj_res result = lean_alloc_ctor(0, 1, 2);
+    lean_ctor_set(result, 0, data);
+    lean_ctor_set_uint8(result, sizeof(void*), (uint8_t)still_ready);
+    lean_ctor_set_uint8(result, sizeof(void*) + 1, (uint8_t)eof);
+    return lean_io_result_mk_ok(result);
+}
 
-    for (size_t i = 0; i < count; i++) {
-        if (pfds[i].revents != 0) {
-            lean_obj_arg entry = lean_array_get_core(entries, i);
-            lean_obj_arg sock_obj_i = lean_ctor_get(entry, 0);
-            lean_inc_ref(sock_obj_i);
+/* Accept until EAGAIN or max_count. Accepted sockets are non-blocking.
+ * AcceptDrain: { sockets : Array Socket, stillReady : Bool } */
+LEAN_EXPORT lean_obj_res jack_socket_accept_drain(
+    b_lean_obj_arg sock_obj,
+    uint32_t max_count,
+    lean_obj_arg world
+) {
+    (void)world;
+    jack_socket_t *sock = jack_socket_unbox(sock_obj);
 
-            /* Create PollResult structure */
-            lean_obj_res result = lean_alloc_ctor(0, 2, 0);
-            lean_ctor_set(result, 0, sock_obj_i);
-            lean_ctor_set(result, 1, poll_to_lean_events(pfds[i].revents));
+    lean_obj_res sockets = lean_mk_empty_array();
+    int still_ready = 1;
+    uint32_t accepted = 0;
 
-            lean_array_set_core(results, result_idx++, result);
+    while (accepted < max_count) {
+        int client_fd = accept(sock->fd, NULL, NULL);
+        if (client_fd < 0) {
+            int err = errno;
+            if (err == EINTR || err == ECONNABORTED) {
+                continue;
+            }
+            if (is_wouldblock_error(err)) {
+                still_ready = 0;
+                break;
+            }
+            if (accepted == 0) {
+                lean_dec_ref(sockets);
+                return jack_io_error_from_errno(err);
+            }
+            break;
+        }
+
+        jack_socket_t *client = jack_socket_alloc(client_fd);
+        if (!client) {
+            close(client_fd);
+            break;
+        }
+
+        int flags = fcntl(client_fd, F_GETFL, 0);
+        if (flags >= 0) {
+            fcntl(client_fd, F_SETFL, flags | O_NONBLOCK);
         }
+
+        /* Set recv/send timeouts to 5 seconds on client socket */
+        struct timeval timeout;
+        timeout.tv_sec = 5;
+        timeout.tv_usec = 0;
+        setsockopt(client_fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+        setsockopt(client_fd, SOL_SOCKET, SO_SNDTIMEO, &timeout, sizeof(timeout));
+
+        sockets = lean_array_push(sockets, jack_socket_box(client));
+        accepted++;
     }
 
-    free(pfds);
-    return lean_io_result_mk_ok(results);
+    lean_obj_res result = lean_alloc_ctor(0, 1, 1);
+    lean_ctor_set(result, 0, sockets);
+    lean_ctor_set_uint8(result, sizeof(void*), (uint8_t)still_ready);
+    return lean_io_result_mk_ok(result);
+}
+
+/* Send queued chunks with writev until EAGAIN, the queue is empty or max_bytes.
+ * `offset` is how much of queue[0] was already sent.
+ * SendDrain: { bytes : UInt64, chunksSent : UInt32, offset : UInt32, stillReady : Bool }
+ * chunksSent counts fully written chunks; offset is progress into the next one. */
+LEAN_EXPORT lean_obj_res jack_socket_send_drain(
+    b_lean_obj_arg sock_obj,
+    b_lean_obj_arg queue,
+    uint32_t offset,
+    uint64_t max_bytes,
+    lean_obj_arg world
+) {
+    (void)world;
+    jack_socket_t *sock = jack_socket_unbox(sock_obj);
+
+    size_t count = lean_array_size(queue);
+    size_t idx = 0;
+    size_t off = offset;
+    uint64_t total = 0;
+    int still_ready = 1;
+
+    while (idx < count && total < max_bytes) {
+        struct iovec iov[JACK_DRAIN_IOV];
+        int iovcnt = 0;
+        uint64_t batch = 0;
+        size_t j = idx;
+        size_t j_off = off;
+        while (j < count && iovcnt < JACK_DRAIN_IOV && total + batch < max_bytes) {
+            b_lean_obj_arg chunk = lean_array_get_core(queue, j);
+            size_t clen = lean_sarray_size(chunk);
+            if (j_off >= clen) {
+                j++;
+                j_off = 0;
+                continue;
+            }
+            size_t take = clen - j_off;
+            if (total + batch + take > max_bytes) {
+                take = (size_t)(max_bytes - total - batch);
+            }
+            iov[iovcnt].iov_base = (void *)(lean_sarray_cptr(chunk) + j_off);
+            iov[iovcnt].iov_len = take;
+            iovcnt++;
+            batch += take;
+            j++;
+            j_off = 0;
+        }
+        if (iovcnt == 0) {
+            /* Only empty chunks left */
+            idx = j;
+            off = 0;
+            break;
+        }
+
+        struct msghdr msg;
+        memset(&msg, 0, sizeof(msg));
+        msg.msg_iov = iov;
+        msg.msg_iovlen = (size_t)iovcnt;
+#ifdef MSG_NOSIGNAL
+        ssize_t n = sendmsg(sock->fd, &msg, MSG_NOSIGNAL);
+#else
+        ssize_t n = sendmsg(sock->fd, &msg, 0);
+#endif
+        if (n < 0) {
+            int err = errno;
+            if (err == EINTR) {
+                continue;
+            }
+            if (is_wouldblock_error(err)) {
+                still_ready = 0;
+                break;
+            }
+            if (total == 0) {
+                return jack_io_error_from_errno(err);
+            }
+            break;
+        }
+        total += (uint64_t)n;
+
+        /* Advance (idx, off) by n bytes */
+        size_t left = (size_t)n;
+        while (left > 0 && idx < count) {
+            size_t clen = lean_sarray_size(lean_array_get_core(queue, idx));
+            size_t avail = clen - off;
+            if (left >= avail) {
+                left -= avail;
+                idx++;
+                off = 0;
+            } else {
+                off += left;
+                left = 0;
+            }
+        }
+    }
+    /* Skip trailing empty chunks */
+    while (idx < count && off == 0 && lean_sarray_size(lean_array_get_core(queue, idx)) == 0) {
+        idx++;
+    }
+
+    lean_obj_res result = lean_alloc_ctor(0, 0, 17);
+    lean_ctor_set_uint64(result, 0, total);
+    lean_ctor_set_uint32(result, 8, (uint32_t)idx);
+    lean_ctor_set_uint32(result, 12, (uint32_t)off);
+    lean_ctor_set_uint8(result, 16, (uint8_t)still_ready);
+    return lean_io_result_mk_ok(result);
+}
+
+/* ========== Composite I/O Operations ========== */
+
+/* A multi-step operation the reactor advances natively whenever the socket is
+ * ready: read exactly N bytes, read through a delimiter, or write all bytes.
+ * Each step loops until the operation completes or the socket would block, so
+ * a large message costs one reactor wakeup per readiness edge, not per chunk. */
+#define JACK_OP_RECV_EXACT 0
+#define JACK_OP_RECV_UNTIL 1
+#define JACK_OP_SEND_ALL 2
+
+#define JACK_OP_PENDING 0
+#define JACK_OP_DONE 1
+#define JACK_OP_FAILED 2
+
+typedef struct {
+    int kind;
+    int status;
+    int err;            /* errno on failure; 0 means EOF, EMSGSIZE an exhausted limit */
+    uint8_t *buf;       /* receive buffer (recv ops) */
+    size_t cap;         /* exact length or maximum length (recv ops) */
+    size_t len;         /* bytes transferred so far */
+    uint8_t *delim;
+    size_t delim_len;
+    lean_object *data;  /* payload (send op), owned reference */
+} jack_io_op_t;
+
+static lean_external_class *g_io_op_class = NULL;
+
+static void jack_io_op_finalizer(void *ptr) {
+    jack_io_op_t *op = (jack_io_op_t *)ptr;
+    if (op->buf) free(op->buf);
+    if (op->delim) free(op->delim);
+    if (op->data) lean_dec(op->data);
+    free(op);
+}
+
+static void jack_io_op_foreach(void *ptr, b_lean_obj_arg f) {
+    jack_io_op_t *op = (jack_io_op_t *)ptr;
+    if (op->data) {
+        lean_inc(f);
+        lean_inc(op->data);
+        lean_apply_1(f, op->data);
+    }
+}
+
+static inline jack_io_op_t *jack_io_op_unbox(b_lean_obj_arg obj) {
+    return (jack_io_op_t *)lean_get_external_data(obj);
+}
+
+static lean_obj_res jack_io_op_new(int kind, size_t cap) {
+    jack_io_op_t *op = calloc(1, sizeof(jack_io_op_t));
+    if (!op || (cap > 0 && kind != JACK_OP_SEND_ALL && !(op->buf = malloc(cap)))) {
+        if (op) free(op);
+        return lean_io_result_mk_error(lean_mk_io_user_error(
+            lean_mk_string("Failed to allocate I/O operation")));
+    }
+    op->kind = kind;
+    op->cap = cap;
+    if (g_io_op_class == NULL) {
+        g_io_op_class = lean_register_external_class(jack_io_op_finalizer, jack_io_op_foreach);
+    }
+    return lean_io_result_mk_ok(lean_alloc_external(g_io_op_class, op));
+}
+
+LEAN_EXPORT lean_obj_res jack_io_op_recv_exact(uint32_t n, lean_obj_arg world) {
+    (void)world;
+    return jack_io_op_new(JACK_OP_RECV_EXACT, (size_t)n);
+}
+
+LEAN_EXPORT lean_obj_res jack_io_op_recv_until(b_lean_obj_arg delim, uint32_t max_bytes, lean_obj_arg world) {
+    (void)world;
+    size_t dlen = lean_sarray_size(delim);
+    if (dlen == 0 || max_bytes == 0) {
+        return lean_io_result_mk_error(lean_mk_io_user_error(
+            lean_mk_string("Invalid recvUntil arguments")));
+    }
+    lean_obj_res res = jack_io_op_new(JACK_OP_RECV_UNTIL, (size_t)max_bytes);
+    if (lean_io_result_is_error(res)) {
+        return res;
+    }
+    jack_io_op_t *op = jack_io_op_unbox(lean_io_result_get_value(res));
+    op->delim = malloc(dlen);
+    if (!op->delim) {
+        lean_dec(res);
+        return lean_io_result_mk_error(lean_mk_io_user_error(
+            lean_mk_string("Failed to allocate I/O operation")));
+    }
+    memcpy(op->delim, lean_sarray_cptr(delim), dlen);
+    op->delim_len = dlen;
+    return res;
+}
+
+LEAN_EXPORT lean_obj_res jack_io_op_send_all(b_lean_obj_arg data, lean_obj_arg world) {
+    (void)world;
+    lean_obj_res res = jack_io_op_new(JACK_OP_SEND_ALL, 0);
+    if (lean_io_result_is_error(res)) {
+        return res;
+    }
+    jack_io_op_t *op = jack_io_op_unbox(lean_io_result_get_value(res));
+    lean_inc(data);
+    op->data = data;
+    op->cap = lean_sarray_size(data);
+    return res;
+}
+
+static void jack_io_op_fail(jack_io_op_t *op, int err) {
+    op->status = JACK_OP_FAILED;
+    op->err = err;
+}
+
+/* Search the collected bytes for the delimiter, starting where a new match could begin */
+static ssize_t jack_io_op_find_delim(const jack_io_op_t *op, size_t from, size_t end) {
+    size_t start = from >= op->delim_len ? from - op->delim_len + 1 : 0;
+    for (size_t i = start; i + op->delim_len <= end; i++) {
+        if (op->buf[i] == op->delim[0] && memcmp(op->buf + i, op->delim, op->delim_len) == 0) {
+            return (ssize_t)(i + op->delim_len);
+        }
+    }
+    return -1;
+}
+
+static void jack_io_op_advance(jack_io_op_t *op, int fd) {
+    while (op->status == JACK_OP_PENDING) {
+        ssize_t n;
+        if (op->kind == JACK_OP_SEND_ALL) {
+            if (op->len == op->cap) {
+                op->status = JACK_OP_DONE;
+                break;
+            }
+            int flags = 0;
+#ifdef MSG_NOSIGNAL
+            flags |= MSG_NOSIGNAL;
+#endif
+            n = send(fd, lean_sarray_cptr(op->data) + op->len, op->cap - op->len, flags);
+        } else if (op->kind == JACK_OP_RECV_EXACT) {
+            if (op->len == op->cap) {
+                op->status = JACK_OP_DONE;
+                break;
+            }
+            n = recv(fd, op->buf + op->len, op->cap - op->len, 0);
+        } else {
+            if (op->len == op->cap) {
+                jack_io_op_fail(op, EMSGSIZE);
+                break;
+            }
+            /* Peek first so nothing past the delimiter is consumed */
+            n = recv(fd, op->buf + op->len, op->cap - op->len, MSG_PEEK);
+            if (n > 0) {
+                ssize_t end = jack_io_op_find_delim(op, op->len, op->len + (size_t)n);
+                size_t take = end >= 0 ? (size_t)end - op->len : (size_t)n;
+                n = recv(fd, op->buf + op->len, take, 0);
+                if (n > 0) {
+                    op->len += (size_t)n;
+                    if (end >= 0 && op->len == (size_t)end) {
+                        op->status = JACK_OP_DONE;
+                    }
+                    continue;
+                }
+            }
+        }
+        if (n > 0) {
+            op->len += (size_t)n;
+        } else if (n == 0 && op->kind != JACK_OP_SEND_ALL) {
+            jack_io_op_fail(op, 0);
+        } else if (n < 0 && errno == EINTR) {
+            continue;
+        } else if (n < 0 && is_wouldblock_error(errno)) {
+            break;
+        } else if (n < 0) {
+            jack_io_op_fail(op, errno);
+        }
+    }
+}
+
+/* Advance the operation; returns 0 while pending, 1 when done, 2 on failure */
+LEAN_EXPORT lean_obj_res jack_io_op_step(b_lean_obj_arg op_obj, b_lean_obj_arg sock_obj, lean_obj_arg world) {
+    (void)world;
+    jack_io_op_t *op = jack_io_op_unbox(op_obj);
+    jack_io_op_advance(op, jack_socket_unbox(sock_obj)->fd);
+    return lean_io_result_mk_ok(lean_box((size_t)op->status));
+}
+
+/* Bytes received by a finished recv op (empty for sends), or the failure as an IO error */
+LEAN_EXPORT lean_obj_res jack_io_op_take(b_lean_obj_arg op_obj, lean_obj_arg world) {
+    (void)world;
+    jack_io_op_t *op = jack_io_op_unbox(op_obj);
+    if (op->status == JACK_OP_FAILED) {
+        if (op->err == 0) {
+            return lean_io_result_mk_error(lean_mk_io_user_error(
+                lean_mk_string("Connection closed before operation completed")));
+        }
+        if (op->err == EMSGSIZE && op->kind == JACK_OP_RECV_UNTIL) {
+            return lean_io_result_mk_error(lean_mk_io_user_error(
+                lean_mk_string("Delimiter not found within limit")));
+        }
+        return jack_io_error_from_errno(op->err);
+    }
+    if (op->status != JACK_OP_DONE) {
+        return lean_io_result_mk_error(lean_mk_io_user_error(
+            lean_mk_string("Operation still pending")));
+    }
+    size_t len = op->kind == JACK_OP_SEND_ALL ? 0 : op->len;
+    lean_obj_res arr = lean_alloc_sarray(1, len, len);
+    if (len > 0) {
+        memcpy(lean_sarray_cptr(arr), op->buf, len);
+    }
+    return lean_io_result_mk_ok(arr);
+}
+
+/* ========== Non-blocking I/O ========== */
+
+/* Set socket to non-blocking mode */
+LEAN_EXPORT lean_obj_res jack_socket_set_nonblocking(
+    b_lean_obj_arg sock_obj,
+    uint8_t nonblocking,
+    lean_obj_arg world
+) {
+    jack_socket_t *sock = jack_socket_unbox(sock_obj);
+
+    int flags = fcntl(sock->fd, F_GETFL, 0);
+    if (flags < 0) {
+        return jack_io_error_from_errno(errno);
+    }
+
+    if (nonblocking) {
+        flags |= O_NONBLOCK;
+    } else {
+        flags &= ~O_NONBLOCK;
+    }
+
+    if (fcntl(sock->fd, F_SETFL, flags) < 0) {
+        return jack_io_error_from_errno(errno);
+    }
+
+    return lean_io_result_mk_ok(lean_box(0));
+}
+
+/* Convert Lean PollEvent array to poll events bitmask
+ * PollEvent: readable=0, writable=1, error=2, hangup=3
+ */
+static short lean_events_to_poll(b_lean_obj_arg events) {
+    short result = 0;
+    size_t len = lean_array_size(events);
+
+    for (size_t i = 0; i < len; i++) {
+        lean_obj_arg ev = lean_array_get_core(events, i);
+        unsigned tag = lean_unbox(ev);
+        switch (tag) {
+            case 0: result |= POLLIN; break;   /* readable */
+            case 1: result |= POLLOUT; break;  /* writable */
+            case 2: result |= POLLERR; break;  /* error */
+            case 3: result |= POLLHUP; break;  /* hangup */
+        }
+    }
+
+    return result;
+}
+
+/* Convert poll revents to Lean PollEvent array */
+static lean_obj_res poll_to_lean_events(short revents) {
+    size_t count = 0;
+    if (revents & POLLIN) count++;
+    if (revents & POLLOUT) count++;
+    if (revents & POLLERR) count++;
+    if (revents & POLLHUP) count++;
+
+    lean_obj_res arr = lean_alloc_array(count, count);
+    size_t idx = 0;
+
+    if (revents & POLLIN) {
+        lean_array_set_core(arr, idx++, lean_box(0));  /* readable */
+    }
+    if (revents & POLLOUT) {
+        lean_array_set_core(arr, idx++, lean_box(1));  /* writable */
+    }
+    if (revents & POLLERR) {
+        lean_array_set_core(arr, idx++, lean_box(2));  /* error */
+    }
+    if (revents & POLLHUP) {
+        lean_array_set_core(arr, idx++, lean_box(3));  /* hangup */
+    }
+
+    return arr;
+}
+
+/* Poll single socket for events */
+LEAN_EXPORT lean_obj_res jack_socket_poll(
+    b_lean_obj_arg sock_obj,
+    b_lean_obj_arg events,
+    int32_t timeout_ms,
+    lean_obj_arg world
+) {
+    jack_socket_t *sock = jack_socket_unbox(sock_obj);
+
+    struct pollfd pfd;
+    pfd.fd = sock->fd;
+    pfd.events = lean_events_to_poll(events);
+    pfd.revents = 0;
+
+    int ret = poll(&pfd, 1, timeout_ms);
+    if (ret < 0) {
+        return jack_io_error_from_errno(errno);
+    }
+
+    return lean_io_result_mk_ok(poll_to_lean_events(pfd.revents));
+}
+
+/* Poll multiple sockets for events
+ * PollEntry: { socket : Socket, events : Array PollEvent }
+ * PollResult: { socket : Socket, events : Array PollEvent }
+ */
+LEAN_EXPORT lean_obj_res jack_poll_wait(
+    b_lean_obj_arg entries,
+    int32_t timeout_ms,
+    lean_obj_arg world
+) {
+    size_t count = lean_array_size(entries);
+
+    if (count == 0) {
+        return lean_io_result_mk_ok(lean_alloc_array(0, 0));
+    }
+
+    struct pollfd *pfds = malloc(count * sizeof(struct pollfd));
+    if (!pfds) {
+        return lean_io_result_mk_error(lean_mk_io_user_error(
+            lean_mk_string("Failed to allocate poll array")));
+    }
+
+    /* Build pollfd array */
+    for (size_t i = 0; i < count; i++) {
+        lean_obj_arg entry = lean_array_get_core(entries, i);
+        lean_obj_arg sock_obj_i = lean_ctor_get(entry, 0);
+        lean_obj_arg events_i = lean_ctor_get(entry, 1);
+
+        jack_socket_t *sock = jack_socket_unbox(sock_obj_i);
+        pfds[i].fd = sock->fd;
+        pfds[i].events = lean_events_to_poll(events_i);
+        pfds[i].revents = 0;
+    }
+
+    int ret = poll(pfds, count, timeout_ms);
+    if (ret < 0) {
+        int err = errno;
+        free(pfds);
+        return jack_io_error_from_errno(err);
+    }
+
+    /* Count results with events */
+    size_t result_count = 0;
+    for (size_t i = 0; i < count; i++) {
+        if (pfds[i].revents != 0) {
+            result_count++;
+        }
+    }
+
+    /* Build result array */
+    lean_obj_res results = lean_alloc_array(result_count, result_count);
+    size_t result_idx = 0;
+
+    for (size_t i = 0; i < count; i++) {
+        if (pfds[i].revents != 0) {
+            lean_obj_arg entry = lean_array_get_core(entries, i);
+            lean_obj_arg sock_obj_i = lean_ctor_get(entry, 0);
+            lean_inc_ref(sock_obj_i);
+
+            /* Create PollResult structure */
+            lean_obj_res result = lean_alloc_ctor(0, 2, 0);
+            lean_ctor_set(result, 0, sock_obj_i);
+            lean_ctor_set(result, 1, poll_to_lean_events(pfds[i].revents));
+
+            lean_array_set_core(results, result_idx++, result);
+        }
+    }
+
+    free(pfds);
+    return lean_io_result_mk_ok(results);
+}
+
+/* Connect to every address at once: start a non-blocking connect per address,
+ * wait for all of them on one pollfd array, then read SO_ERROR for each.
+ * Returns Array (Except SocketError Socket) in address order; connections not
+ * finished within timeout_ms (negative: no limit) fail with ETIMEDOUT. */
+LEAN_EXPORT lean_obj_res jack_socket_connect_many(
+    b_lean_obj_arg addrs,
+    int32_t timeout_ms,
+    lean_obj_arg world
+) {
+    size_t count = lean_array_size(addrs);
+    int *fds = malloc((count + 1) * sizeof(int));
+    int *errs = malloc((count + 1) * sizeof(int));
+    struct pollfd *pfds = malloc((count + 1) * sizeof(struct pollfd));
+    size_t *owner = malloc((count + 1) * sizeof(size_t));
+    if (!fds || !errs || !pfds || !owner) {
+        free(fds);
+        free(errs);
+        free(pfds);
+        free(owner);
+        return lean_io_result_mk_error(lean_mk_io_user_error(
+            lean_mk_string("Failed to allocate connect array")));
+    }
+
+    /* Start every connect; errs[i] < 0 marks one still in progress */
+    size_t pending = 0;
+    for (size_t i = 0; i < count; i++) {
+        struct sockaddr_storage sa;
+        socklen_t sa_len;
+        fds[i] = -1;
+        if (lean_to_sockaddr(lean_array_get_core(addrs, i), &sa, &sa_len) < 0) {
+            errs[i] = EINVAL;
+            continue;
+        }
+        int fd = socket(sa.ss_family, SOCK_STREAM, 0);
+        if (fd < 0) {
+            errs[i] = errno;
+            continue;
+        }
+        int flags = fcntl(fd, F_GETFL, 0);
+        fcntl(fd, F_SETFL, (flags < 0 ? 0 : flags) | O_NONBLOCK);
+        fds[i] = fd;
+        if (connect(fd, (struct sockaddr *)&sa, sa_len) == 0) {
+            errs[i] = 0;
+        } else if (errno == EINPROGRESS || errno == EAGAIN) {
+            errs[i] = -1;
+            pfds[pending].fd = fd;
+            pfds[pending].events = POLLOUT;
+            pfds[pending].revents = 0;
+            owner[pending] = i;
+            pending++;
+        } else {
+            errs[i] = errno;
+        }
+    }
+
+    /* One wait loop for all of them; finished entries are swapped out of the array */
+    struct timespec start;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    while (pending > 0) {
+        int wait_ms = -1;
+        if (timeout_ms >= 0) {
+            struct timespec now;
+            clock_gettime(CLOCK_MONOTONIC, &now);
+            int64_t elapsed = (int64_t)(now.tv_sec - start.tv_sec) * 1000 +
+                              (now.tv_nsec - start.tv_nsec) / 1000000;
+            if (elapsed >= timeout_ms) break;
+            wait_ms = (int)(timeout_ms - elapsed);
+        }
+        int ready = poll(pfds, (nfds_t)pending, wait_ms);
+        if (ready < 0) {
+            if (errno == EINTR) continue;
+            int err = errno;
+            for (size_t k = 0; k < pending; k++) errs[owner[k]] = err;
+            pending = 0;
+            break;
+        }
+        if (ready == 0) break;
+        for (size_t k = 0; k < pending;) {
+            if (pfds[k].revents == 0) {
+                k++;
+                continue;
+            }
+            int so_error = 0;
+            socklen_t len = sizeof(so_error);
+            if (getsockopt(pfds[k].fd, SOL_SOCKET, SO_ERROR, &so_error, &len) < 0) {
+                so_error = errno;
+            }
+            errs[owner[k]] = so_error;
+            pending--;
+            pfds[k] = pfds[pending];
+            owner[k] = owner[pending];
+        }
+    }
+    for (size_t k = 0; k < pending; k++) {
+        errs[owner[k]] = ETIMEDOUT;
+    }
+
+    lean_obj_res results = lean_alloc_array(count, count);
+    for (size_t i = 0; i < count; i++) {
+        jack_socket_t *sock = NULL;
+        if (errs[i] == 0) {
+            sock = jack_socket_alloc(fds[i]);
+            if (!sock) errs[i] = ENOMEM;
+        }
+        lean_obj_res entry;
+        if (sock) {
+            struct timeval timeout;
+            timeout.tv_sec = 5;
+            timeout.tv_usec = 0;
+            setsockopt(sock->fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+            setsockopt(sock->fd, SOL_SOCKET, SO_SNDTIMEO, &timeout, sizeof(timeout));
+            entry = lean_alloc_ctor(1, 1, 0); /* Except.ok */
+            lean_ctor_set(entry, 0, jack_socket_box(sock));
+        } else {
+            if (fds[i] >= 0) close(fds[i]);
+            entry = lean_alloc_ctor(0, 1, 0); /* Except.error */
+            lean_ctor_set(entry, 0, jack_make_socket_error(errs[i]));
+        }
+        lean_array_set_core(results, i, entry);
+    }
+    free(fds);
+    free(errs);
+    free(pfds);
+    free(owner);
+    return lean_io_result_mk_ok(results);
+}
+
+/* ========== PollSet ========== */
+
+/* Persistent pollfd array indexed by slot. Removed slots keep fd = -1 (ignored by
+ * poll) and go on a free list, so add/remove/modify are O(1) and waits reuse the
+ * same array. Masks use the Lean PollEvent bits (POLLIN/POLLOUT/POLLERR/POLLHUP). */
+typedef struct {
+    struct pollfd *fds;
+    uint32_t *free_slots;
+    uint32_t cap;
+    uint32_t used;       /* slots handed out (high-water mark) */
+    uint32_t free_count;
+    uint32_t live;
+} jack_pollset_t;
+
+static lean_external_class *g_pollset_class = NULL;
+
+static void jack_pollset_finalizer(void *ptr) {
+    jack_pollset_t *ps = (jack_pollset_t *)ptr;
+    free(ps->fds);
+    free(ps->free_slots);
+    free(ps);
+}
+
+static void jack_pollset_foreach(void *ptr, b_lean_obj_arg f) {
+    /* No nested Lean objects */
+}
+
+static inline jack_pollset_t *jack_pollset_unbox(b_lean_obj_arg obj) {
+    return (jack_pollset_t *)lean_get_external_data(obj);
+}
+
+static short jack_mask_to_poll(uint16_t mask) {
+    short events = 0;
+    if (mask & 0x0001) events |= POLLIN;
+    if (mask & 0x0004) events |= POLLOUT;
+    if (mask & 0x0008) events |= POLLERR;
+    if (mask & 0x0010) events |= POLLHUP;
+    return events;
+}
+
+static uint16_t jack_poll_to_mask(short revents) {
+    uint16_t mask = 0;
+    if (revents & POLLIN) mask |= 0x0001;
+    if (revents & POLLOUT) mask |= 0x0004;
+    if (revents & POLLERR) mask |= 0x0008;
+    if (revents & POLLHUP) mask |= 0x0010;
+    return mask;
+}
+
+static lean_obj_res jack_pollset_bad_slot(void) {
+    return lean_io_result_mk_error(lean_mk_io_user_error(
+        lean_mk_string("Invalid poll set slot")));
+}
+
+LEAN_EXPORT lean_obj_res jack_pollset_new(uint32_t capacity, lean_obj_arg world) {
+    (void)world;
+    if (capacity == 0) capacity = 16;
+    jack_pollset_t *ps = calloc(1, sizeof(jack_pollset_t));
+    if (ps) {
+        ps->fds = malloc((size_t)capacity * sizeof(struct pollfd));
+        ps->free_slots = malloc((size_t)capacity * sizeof(uint32_t));
+    }
+    if (!ps || !ps->fds || !ps->free_slots) {
+        if (ps) {
+            free(ps->fds);
+            free(ps->free_slots);
+            free(ps);
+        }
+        return lean_io_result_mk_error(lean_mk_io_user_error(
+            lean_mk_string("Failed to allocate poll set")));
+    }
+    ps->cap = capacity;
+    if (g_pollset_class == NULL) {
+        g_pollset_class = lean_register_external_class(
+            jack_pollset_finalizer,
+            jack_pollset_foreach
+        );
+    }
+    return lean_io_result_mk_ok(lean_alloc_external(g_pollset_class, ps));
+}
+
+/* Register a socket with an event mask; returns its slot */
+LEAN_EXPORT lean_obj_res jack_pollset_add(
+    b_lean_obj_arg ps_obj,
+    b_lean_obj_arg sock_obj,
+    uint16_t mask,
+    lean_obj_arg world
+) {
+    (void)world;
+    jack_pollset_t *ps = jack_pollset_unbox(ps_obj);
+    jack_socket_t *sock = jack_socket_unbox(sock_obj);
+
+    uint32_t slot;
+    if (ps->free_count > 0) {
+        slot = ps->free_slots[--ps->free_count];
+    } else {
+        if (ps->used == ps->cap) {
+            uint32_t new_cap = ps->cap * 2;
+            struct pollfd *fds = realloc(ps->fds, (size_t)new_cap * sizeof(struct pollfd));
+            if (!fds) {
+                return lean_io_result_mk_error(lean_mk_io_user_error(
+                    lean_mk_string("Failed to grow poll set")));
+            }
+            ps->fds = fds;
+            uint32_t *free_slots = realloc(ps->free_slots, (size_t)new_cap * sizeof(uint32_t));
+            if (!free_slots) {
+                return lean_io_result_mk_error(lean_mk_io_user_error(
+                    lean_mk_string("Failed to grow poll set")));
+            }
+            ps->free_slots = free_slots;
+            ps->cap = new_cap;
+        }
+        slot = ps->used++;
+    }
+
+    ps->fds[slot].fd = sock->fd;
+    ps->fds[slot].events = jack_mask_to_poll(mask);
+    ps->fds[slot].revents = 0;
+    ps->live++;
+    return lean_io_result_mk_ok(lean_box_uint32(slot));
+}
+
+/* Change the event mask of a slot */
+LEAN_EXPORT lean_obj_res jack_pollset_modify(
+    b_lean_obj_arg ps_obj,
+    uint32_t slot,
+    uint16_t mask,
+    lean_obj_arg world
+) {
+    (void)world;
+    jack_pollset_t *ps = jack_pollset_unbox(ps_obj);
+    if (slot >= ps->used || ps->fds[slot].fd < 0) {
+        return jack_pollset_bad_slot();
+    }
+    ps->fds[slot].events = jack_mask_to_poll(mask);
+    return lean_io_result_mk_ok(lean_box(0));
+}
+
+/* Remove a slot; it may be reused by a later add */
+LEAN_EXPORT lean_obj_res jack_pollset_remove(
+    b_lean_obj_arg ps_obj,
+    uint32_t slot,
+    lean_obj_arg world
+) {
+    (void)world;
+    jack_pollset_t *ps = jack_pollset_unbox(ps_obj);
+    if (slot >= ps->used || ps->fds[slot].fd < 0) {
+        return jack_pollset_bad_slot();
+    }
+    ps->fds[slot].fd = -1;
+    ps->fds[slot].events = 0;
+    ps->fds[slot].revents = 0;
+    ps->free_slots[ps->free_count++] = slot;
+    ps->live--;
+    return lean_io_result_mk_ok(lean_box(0));
+}
+
+/* Number of registered sockets */
+LEAN_EXPORT lean_obj_res jack_pollset_size(b_lean_obj_arg ps_obj, lean_obj_arg world) {
+    (void)world;
+    jack_pollset_t *ps = jack_pollset_unbox(ps_obj);
+    return lean_io_result_mk_ok(lean_box_uint32(ps->live));
+}
+
+/* Wait for events; returns ready slot indices (revents kept for `revents`) */
+LEAN_EXPORT lean_obj_res jack_pollset_wait(
+    b_lean_obj_arg ps_obj,
+    int32_t timeout_ms,
+    lean_obj_arg world
+) {
+    (void)world;
+    jack_pollset_t *ps = jack_pollset_unbox(ps_obj);
+
+    int ret;
+    do {
+        ret = poll(ps->fds, (nfds_t)ps->used, timeout_ms);
+    } while (ret < 0 && errno == EINTR);
+    if (ret < 0) {
+        return jack_io_error_from_errno(errno);
+    }
+
+    /* poll() returns the number of ready descriptors, which is the result size */
+    lean_obj_res ready = lean_alloc_array((size_t)ret, (size_t)ret);
+    size_t idx = 0;
+    for (uint32_t i = 0; i < ps->used && idx < (size_t)ret; i++) {
+        if (ps->fds[i].fd >= 0 && ps->fds[i].revents != 0) {
+            lean_array_set_core(ready, idx++, lean_box_uint32(i));
+        }
+    }
+    return lean_io_result_mk_ok(ready);
+}
+
+/* Events reported for a slot by the last wait */
+LEAN_EXPORT lean_obj_res jack_pollset_revents(
+    b_lean_obj_arg ps_obj,
+    uint32_t slot,
+    lean_obj_arg world
+) {
+    (void)world;
+    jack_pollset_t *ps = jack_pollset_unbox(ps_obj);
+    if (slot >= ps->used) {
+        return jack_pollset_bad_slot();
+    }
+    return lean_io_result_mk_ok(lean_box((size_t)jack_poll_to_mask(ps->fds[slot].revents)));
+}
+
+/* ========== Command Queue ========== */
+
+/* Multi-producer, single-consumer queue of Lean objects between API callers and
+ * a reactor thread, plus the reactor's id counter. A push is one atomic exchange
+ * on `head` (wait-free) and reports whether the queue was empty, so producers
+ * wake the reactor once per batch instead of once per command. The consumer
+ * takes the whole list with another exchange and restores FIFO order. */
+typedef struct jack_cmd_node {
+    _Atomic(struct jack_cmd_node *) next;
+    lean_object *item;
+} jack_cmd_node_t;
+
+/* `next` of a node whose producer has swapped it in but not yet linked it */
+#define JACK_CMD_UNLINKED ((jack_cmd_node_t *)(uintptr_t)1)
+
+typedef struct {
+    _Alignas(64) _Atomic(jack_cmd_node_t *) head;
+    _Alignas(64) _Atomic uint64_t next_id;
+    _Alignas(64) atomic_int closed;
+} jack_cmdq_t;
+
+static lean_external_class *g_cmdq_class = NULL;
+
+static jack_cmd_node_t *jack_cmdq_next(jack_cmd_node_t *node) {
+    jack_cmd_node_t *next;
+    /* A producer is between its exchange and its link store: a few instructions */
+    while ((next = atomic_load_explicit(&node->next, memory_order_acquire)) == JACK_CMD_UNLINKED) {
+    }
+    return next;
+}
+
+static void jack_cmdq_finalizer(void *ptr) {
+    jack_cmdq_t *q = (jack_cmdq_t *)ptr;
+    jack_cmd_node_t *node = atomic_exchange_explicit(&q->head, NULL, memory_order_acquire);
+    while (node) {
+        jack_cmd_node_t *next = jack_cmdq_next(node);
+        lean_dec(node->item);
+        free(node);
+        node = next;
+    }
+    free(q);
+}
+
+static void jack_cmdq_foreach(void *ptr, b_lean_obj_arg f) {
+    /* Queued items are owned by the list and handed off on drain */
+}
+
+static inline jack_cmdq_t *jack_cmdq_unbox(b_lean_obj_arg obj) {
+    return (jack_cmdq_t *)lean_get_external_data(obj);
+}
+
+LEAN_EXPORT lean_obj_res jack_cmdq_new(lean_obj_arg world) {
+    (void)world;
+    jack_cmdq_t *q = aligned_alloc(64, sizeof(jack_cmdq_t));
+    if (!q) {
+        return lean_io_result_mk_error(lean_mk_io_user_error(
+            lean_mk_string("Failed to allocate command queue")));
+    }
+    atomic_init(&q->head, NULL);
+    atomic_init(&q->next_id, 1);
+    atomic_init(&q->closed, 0);
+    if (g_cmdq_class == NULL) {
+        g_cmdq_class = lean_register_external_class(jack_cmdq_finalizer, jack_cmdq_foreach);
+    }
+    return lean_io_result_mk_ok(lean_alloc_external(g_cmdq_class, q));
+}
+
+/* PushResult: queued (0), first (1: the consumer needs a wakeup), closed (2) */
+#define JACK_CMDQ_QUEUED 0
+#define JACK_CMDQ_FIRST 1
+#define JACK_CMDQ_CLOSED 2
+
+/* Push `item`, reporting whether the queue was empty. After `close` the item is
+ * dropped and `closed` returned. A push that races with `close` may still land
+ * after the consumer's final drain; it also reports `closed`, so the caller can
+ * settle the item itself (the consumer drains only after closing). */
+LEAN_EXPORT lean_obj_res jack_cmdq_push(b_lean_obj_arg q_obj, lean_obj_arg item, lean_obj_arg world) {
+    (void)world;
+    jack_cmdq_t *q = jack_cmdq_unbox(q_obj);
+    if (atomic_load_explicit(&q->closed, memory_order_seq_cst)) {
+        lean_dec(item);
+        return lean_io_result_mk_ok(lean_box(JACK_CMDQ_CLOSED));
+    }
+    jack_cmd_node_t *node = malloc(sizeof(jack_cmd_node_t));
+    if (!node) {
+        lean_dec(item);
+        return lean_io_result_mk_error(lean_mk_io_user_error(
+            lean_mk_string("Failed to allocate command")));
+    }
+    /* Another thread takes it from here */
+    lean_mark_mt(item);
+    node->item = item;
+    atomic_store_explicit(&node->next, JACK_CMD_UNLINKED, memory_order_relaxed);
+    jack_cmd_node_t *prev = atomic_exchange_explicit(&q->head, node, memory_order_seq_cst);
+    atomic_store_explicit(&node->next, prev, memory_order_release);
+    if (atomic_load_explicit(&q->closed, memory_order_seq_cst)) {
+        return lean_io_result_mk_ok(lean_box(JACK_CMDQ_CLOSED));
+    }
+    return lean_io_result_mk_ok(lean_box(prev == NULL ? JACK_CMDQ_FIRST : JACK_CMDQ_QUEUED));
+}
+
+/* Take every queued item, oldest first */
+LEAN_EXPORT lean_obj_res jack_cmdq_drain(b_lean_obj_arg q_obj, lean_obj_arg world) {
+    (void)world;
+    jack_cmdq_t *q = jack_cmdq_unbox(q_obj);
+    jack_cmd_node_t *node = atomic_exchange_explicit(&q->head, NULL, memory_order_seq_cst);
+    size_t count = 0;
+    for (jack_cmd_node_t *n = node; n; n = jack_cmdq_next(n)) {
+        count++;
+    }
+    lean_object *out = lean_alloc_array(count, count);
+    /* The list runs newest to oldest: fill the array from the back */
+    size_t i = count;
+    while (node) {
+        jack_cmd_node_t *next = jack_cmdq_next(node);
+        lean_array_set_core(out, --i, node->item);
+        free(node);
+        node = next;
+    }
+    return lean_io_result_mk_ok(out);
+}
+
+LEAN_EXPORT lean_obj_res jack_cmdq_next_id(b_lean_obj_arg q_obj, lean_obj_arg world) {
+    (void)world;
+    jack_cmdq_t *q = jack_cmdq_unbox(q_obj);
+    uint64_t id = atomic_fetch_add_explicit(&q->next_id, 1, memory_order_relaxed);
+    return lean_io_result_mk_ok(lean_box_uint64(id));
+}
+
+/* Refuse further pushes; already queued items can still be drained */
+LEAN_EXPORT lean_obj_res jack_cmdq_close(b_lean_obj_arg q_obj, lean_obj_arg world) {
+    (void)world;
+    atomic_store_explicit(&jack_cmdq_unbox(q_obj)->closed, 1, memory_order_seq_cst);
+    return lean_io_result_mk_ok(lean_box(0));
+}
+
+/* ========== Reactor Core ========== */
+
+/* Native event loop core behind Jack.Async reactors. Waiters register
+ * (id, fd, mask), optionally with a composite IoOp; `wait` blocks in epoll_wait
+ * (poll elsewhere), steps ready operations natively and returns every finished
+ * waiter in one array of packed (id << 16 | mask) values, plus JACK_RC_WOKEN if
+ * `wake` interrupted it. Waiters are one-shot.
+ * A waiter whose socket no longer owns the descriptor (closed, fd reused) is
+ * finished with an error instead of being matched against the new socket.
+ * Kernel registrations are tracked per socket id, not per fd: closing a socket
+ * silently drops its epoll entry, so a new socket on the same fd is always
+ * re-added rather than assumed registered.
+ * Only the reactor thread calls add/remove/wait; `wake` is safe from any thread. */
+typedef struct {
+    uint64_t id;
+    int fd;
+    uint16_t mask;
+    int next;            /* next waiter on the same fd, or next free slot */
+    int used;
+    lean_object *sock;   /* keeps the socket alive while registered */
+    lean_object *op;     /* optional IoOp */
+} jack_rc_waiter_t;
+
+typedef struct {
+    int head;            /* first waiter on this fd, -1 if none */
+    uint16_t registered; /* interest currently registered for this fd */
+    uint64_t owner;      /* id of the socket the registration was made for */
+} jack_rc_fd_t;
+
+typedef struct {
+    int epfd;            /* -1 when falling back to poll() */
+    int wake_rd;
+    int wake_wr;
+    jack_rc_waiter_t *waiters;
+    int wcap;
+    int free_head;
+    jack_rc_fd_t *fds;
+    int fdcap;
+    struct pollfd *pfds; /* poll() fallback scratch */
+    int pcap;
+    int *stale;          /* fds holding waiters of closed sockets, reported by `wait` */
+    int nstale;
+    int stale_cap;
+} jack_rc_t;
+
+#define JACK_RC_MAX_EVENTS 256
+/* Reported by `wait` when `wake` interrupted it; never a valid packed waiter */
+#define JACK_RC_WOKEN UINT64_MAX
+
+static lean_external_class *g_rc_class = NULL;
+
+static void jack_rc_finalizer(void *ptr) {
+    jack_rc_t *rc = (jack_rc_t *)ptr;
+    for (int i = 0; i < rc->wcap; i++) {
+        if (rc->waiters[i].used) {
+            lean_dec(rc->waiters[i].sock);
+            if (rc->waiters[i].op) lean_dec(rc->waiters[i].op);
+        }
+    }
+    if (rc->epfd >= 0) close(rc->epfd);
+    if (rc->wake_rd >= 0) close(rc->wake_rd);
+    if (rc->wake_wr >= 0 && rc->wake_wr != rc->wake_rd) close(rc->wake_wr);
+    free(rc->waiters);
+    free(rc->fds);
+    free(rc->pfds);
+    free(rc->stale);
+    free(rc);
+}
+
+static void jack_rc_foreach(void *ptr, b_lean_obj_arg f) {
+    jack_rc_t *rc = (jack_rc_t *)ptr;
+    for (int i = 0; i < rc->wcap; i++) {
+        if (rc->waiters[i].used) {
+            lean_inc(f);
+            lean_inc(rc->waiters[i].sock);
+            lean_apply_1(f, rc->waiters[i].sock);
+            if (rc->waiters[i].op) {
+                lean_inc(f);
+                lean_inc(rc->waiters[i].op);
+                lean_apply_1(f, rc->waiters[i].op);
+            }
+        }
+    }
+}
+
+static inline jack_rc_t *jack_rc_unbox(b_lean_obj_arg obj) {
+    return (jack_rc_t *)lean_get_external_data(obj);
+}
+
+#ifdef __linux__
+static uint32_t jack_mask_to_epoll(uint16_t mask) {
+    uint32_t events = 0;
+    if (mask & 0x0001) events |= EPOLLIN;
+    if (mask & 0x0004) events |= EPOLLOUT;
+    return events;
+}
+
+static uint16_t jack_epoll_to_mask(uint32_t events) {
+    uint16_t mask = 0;
+    if (events & EPOLLIN) mask |= 0x0001;
+    if (events & EPOLLOUT) mask |= 0x0004;
+    if (events & EPOLLERR) mask |= 0x0008;
+    if (events & EPOLLHUP) mask |= 0x0010;
+    return mask;
+}
+#endif
+
+static int jack_rc_reserve_fd(jack_rc_t *rc, int fd) {
+    if (fd < rc->fdcap) return 0;
+    int cap = rc->fdcap > 0 ? rc->fdcap : 64;
+    while (cap <= fd) cap *= 2;
+    jack_rc_fd_t *fds = realloc(rc->fds, (size_t)cap * sizeof(jack_rc_fd_t));
+    if (!fds) return ENOMEM;
+    for (int i = rc->fdcap; i < cap; i++) {
+        fds[i].head = -1;
+        fds[i].registered = 0;
+        fds[i].owner = 0;
+    }
+    rc->fds = fds;
+    rc->fdcap = cap;
+    return 0;
+}
+
+static int jack_rc_alloc_waiter(jack_rc_t *rc) {
+    if (rc->free_head < 0) {
+        int cap = rc->wcap > 0 ? rc->wcap * 2 : 64;
+        jack_rc_waiter_t *ws = realloc(rc->waiters, (size_t)cap * sizeof(jack_rc_waiter_t));
+        if (!ws) return -1;
+        for (int i = rc->wcap; i < cap; i++) {
+            ws[i].used = 0;
+            ws[i].next = i + 1 < cap ? i + 1 : -1;
+        }
+        rc->waiters = ws;
+        rc->free_head = rc->wcap;
+        rc->wcap = cap;
+    }
+    int idx = rc->free_head;
+    rc->free_head = rc->waiters[idx].next;
+    return idx;
+}
+
+/* Queue `fd` for `wait` to finish its stale waiters */
+static void jack_rc_mark_stale(jack_rc_t *rc, int fd) {
+    for (int i = 0; i < rc->nstale; i++) {
+        if (rc->stale[i] == fd) return;
+    }
+    if (rc->nstale == rc->stale_cap) {
+        int cap = rc->stale_cap > 0 ? rc->stale_cap * 2 : 16;
+        int *grown = realloc(rc->stale, (size_t)cap * sizeof(int));
+        if (!grown) return; /* reported on the fd's next readiness instead */
+        rc->stale = grown;
+        rc->stale_cap = cap;
+    }
+    rc->stale[rc->nstale++] = fd;
+}
+
+/* Bring the kernel registration for `fd` in line with the combined mask of the
+ * waiters whose socket still owns it. Waiters of closed sockets are left for
+ * `wait` to report. */
+static int jack_rc_sync_fd(jack_rc_t *rc, int fd) {
+    uint16_t mask = 0;
+    uint64_t owner = 0;
+    int live = 0;
+    for (int i = rc->fds[fd].head; i >= 0; i = rc->waiters[i].next) {
+        jack_socket_t *sock = jack_socket_unbox(rc->waiters[i].sock);
+        if (sock->fd != fd) {
+            jack_rc_mark_stale(rc, fd);
+            continue;
+        }
+        mask |= rc->waiters[i].mask;
+        owner = jack_socket_id_of(sock);
+        live = 1;
+    }
+    mask &= 0x0005; /* errors and hangups are always reported */
+    if (mask == 0 && live) {
+        mask = 0x0008; /* waiters for errors only still need a registration */
+    }
+    jack_rc_fd_t *entry = &rc->fds[fd];
+    /* A registration made for another socket died with that socket's close */
+    int reused = live && entry->registered && entry->owner != owner;
+    if (mask == entry->registered && !reused) return 0;
+#ifdef __linux__
+    if (rc->epfd >= 0) {
+        if (mask == 0) {
+            epoll_ctl(rc->epfd, EPOLL_CTL_DEL, fd, NULL);
+        } else {
+            struct epoll_event ev;
+            memset(&ev, 0, sizeof(ev));
+            ev.events = jack_mask_to_epoll(mask);
+            ev.data.fd = fd;
+            int op = entry->registered && !reused ? EPOLL_CTL_MOD : EPOLL_CTL_ADD;
+            if (epoll_ctl(rc->epfd, op, fd, &ev) < 0) {
+                /* The descriptor may have been closed and reused behind our back */
+                int alt = errno == ENOENT ? EPOLL_CTL_ADD : errno == EEXIST ? EPOLL_CTL_MOD : -1;
+                if (alt < 0 || epoll_ctl(rc->epfd, alt, fd, &ev) < 0) {
+                    return errno;
+                }
+            }
+        }
+    }
+#endif
+    entry->registered = mask;
+    entry->owner = live ? owner : 0;
+    return 0;
+}
+
+static void jack_rc_unlink(jack_rc_t *rc, int idx) {
+    jack_rc_waiter_t *w = &rc->waiters[idx];
+    int *link = &rc->fds[w->fd].head;
+    while (*link >= 0 && *link != idx) {
+        link = &rc->waiters[*link].next;
+    }
+    if (*link == idx) {
+        *link = w->next;
+    }
+    lean_dec(w->sock);
+    if (w->op) lean_dec(w->op);
+    w->sock = NULL;
+    w->op = NULL;
+    w->used = 0;
+    w->next = rc->free_head;
+    rc->free_head = idx;
+}
+
+LEAN_EXPORT lean_obj_res jack_reactor_core_new(lean_obj_arg world) {
+    (void)world;
+    jack_rc_t *rc = calloc(1, sizeof(jack_rc_t));
+    if (!rc) {
+        return lean_io_result_mk_error(lean_mk_io_user_error(
+            lean_mk_string("Failed to allocate reactor")));
+    }
+    rc->epfd = -1;
+    rc->wake_rd = -1;
+    rc->wake_wr = -1;
+    rc->free_head = -1;
+#ifdef __linux__
+    rc->epfd = epoll_create1(EPOLL_CLOEXEC);
+    int efd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (efd >= 0) {
+        rc->wake_rd = efd;
+        rc->wake_wr = efd;
+    }
+#endif
+    if (rc->wake_rd < 0) {
+        int p[2];
+        if (pipe(p) == 0) {
+            fcntl(p[0], F_SETFL, fcntl(p[0], F_GETFL, 0) | O_NONBLOCK);
+            fcntl(p[1], F_SETFL, fcntl(p[1], F_GETFL, 0) | O_NONBLOCK);
+            rc->wake_rd = p[0];
+            rc->wake_wr = p[1];
+        }
+    }
+    if (rc->wake_rd < 0) {
+        int err = errno;
+        if (rc->epfd >= 0) close(rc->epfd);
+        free(rc);
+        return jack_io_error_from_errno(err);
+    }
+#ifdef __linux__
+    if (rc->epfd >= 0) {
+        struct epoll_event ev;
+        memset(&ev, 0, sizeof(ev));
+        ev.events = EPOLLIN;
+        ev.data.fd = rc->wake_rd;
+        epoll_ctl(rc->epfd, EPOLL_CTL_ADD, rc->wake_rd, &ev);
+    }
+#endif
+    if (g_rc_class == NULL) {
+        g_rc_class = lean_register_external_class(jack_rc_finalizer, jack_rc_foreach);
+    }
+    return lean_io_result_mk_ok(lean_alloc_external(g_rc_class, rc));
+}
+
+/* Register a one-shot waiter; returns its slot for `remove` */
+/* Registration failed: a composite operation records the errno so its `take` reports it
+ * instead of a generic pending error. */
+static lean_obj_res jack_rc_add_error(jack_io_op_t *op, int err) {
+    if (op && op->status == JACK_OP_PENDING) {
+        jack_io_op_fail(op, err);
+    }
+    return jack_io_error_from_errno(err);
+}
+
+LEAN_EXPORT lean_obj_res jack_reactor_core_add(
+    b_lean_obj_arg rc_obj,
+    uint64_t id,
+    b_lean_obj_arg sock_obj,
+    uint16_t mask,
+    b_lean_obj_arg op_opt,
+    lean_obj_arg world
+) {
+    (void)world;
+    jack_rc_t *rc = jack_rc_unbox(rc_obj);
+    jack_io_op_t *op = lean_is_scalar(op_opt) ? NULL : jack_io_op_unbox(lean_ctor_get(op_opt, 0));
+    int fd = jack_socket_unbox(sock_obj)->fd;
+    if (fd < 0) {
+        return jack_rc_add_error(op, EBADF);
+    }
+    int err = jack_rc_reserve_fd(rc, fd);
+    int idx = err == 0 ? jack_rc_alloc_waiter(rc) : -1;
+    if (idx < 0) {
+        return jack_rc_add_error(op, err != 0 ? err : ENOMEM);
+    }
+    jack_rc_waiter_t *w = &rc->waiters[idx];
+    w->id = id;
+    w->fd = fd;
+    w->mask = mask;
+    w->used = 1;
+    lean_inc(sock_obj);
+    w->sock = sock_obj;
+    w->op = NULL;
+    if (!lean_is_scalar(op_opt)) {
+        w->op = lean_ctor_get(op_opt, 0);
+        lean_inc(w->op);
+    }
+    w->next = rc->fds[fd].head;
+    rc->fds[fd].head = idx;
+    err = jack_rc_sync_fd(rc, fd);
+    if (err != 0) {
+        jack_rc_unlink(rc, idx);
+        jack_rc_sync_fd(rc, fd);
+        return jack_rc_add_error(op, err);
+    }
+    return lean_io_result_mk_ok(lean_box_uint32((uint32_t)idx));
+}
+
+/* Drop a waiter (canceled or timed out); stale slots are ignored */
+LEAN_EXPORT lean_obj_res jack_reactor_core_remove(
+    b_lean_obj_arg rc_obj,
+    uint32_t slot,
+    uint64_t id,
+    lean_obj_arg world
+) {
+    (void)world;
+    jack_rc_t *rc = jack_rc_unbox(rc_obj);
+    if ((int)slot < rc->wcap && rc->waiters[slot].used && rc->waiters[slot].id == id) {
+        int fd = rc->waiters[slot].fd;
+        jack_rc_unlink(rc, (int)slot);
+        jack_rc_sync_fd(rc, fd);
+    }
+    return lean_io_result_mk_ok(lean_box(0));
+}
+
+/* Match readiness on `fd` against its waiters, stepping composite operations */
+static void jack_rc_dispatch(jack_rc_t *rc, int fd, uint16_t ready, lean_object **out) {
+    if (fd < 0 || fd >= rc->fdcap) return;
+    int idx = rc->fds[fd].head;
+    int changed = 0;
+    while (idx >= 0) {
+        jack_rc_waiter_t *w = &rc->waiters[idx];
+        int next = w->next;
+        uint16_t matched = ready & w->mask;
+        if (jack_socket_unbox(w->sock)->fd != fd) {
+            /* Stale: its socket was closed and the descriptor now belongs to another
+             * one. Never step its operation on the new socket; report an error so
+             * the caller's retry sees the closed handle. */
+            *out = lean_array_push(*out, lean_box_uint64((w->id << 16) | 0x0008));
+            jack_rc_unlink(rc, idx);
+            changed = 1;
+        } else if (matched != 0) {
+            int finished = 1;
+            if (w->op) {
+                jack_io_op_t *op = jack_io_op_unbox(w->op);
+                jack_io_op_advance(op, fd);
+                finished = op->status != JACK_OP_PENDING;
+            }
+            if (finished) {
+                *out = lean_array_push(*out, lean_box_uint64((w->id << 16) | matched));
+                jack_rc_unlink(rc, idx);
+                changed = 1;
+            }
+        }
+        idx = next;
+    }
+    if (changed) {
+        jack_rc_sync_fd(rc, fd);
+    }
+}
+
+static void jack_rc_drain_wake(jack_rc_t *rc) {
+    uint8_t buf[64];
+    while (read(rc->wake_rd, buf, sizeof(buf)) > 0) {
+    }
+}
+
+/* Wait up to `timeout_ms` and return finished waiters as packed (id << 16 | mask),
+ * with JACK_RC_WOKEN appended if the wakeup descriptor fired */
+LEAN_EXPORT lean_obj_res jack_reactor_core_wait(
+    b_lean_obj_arg rc_obj,
+    int32_t timeout_ms,
+    lean_obj_arg world
+) {
+    (void)world;
+    jack_rc_t *rc = jack_rc_unbox(rc_obj);
+    lean_object *out = lean_alloc_array(0, 16);
+    /* Waiters of closed sockets never see readiness; finish them now */
+    while (rc->nstale > 0) {
+        int fd = rc->stale[--rc->nstale];
+        jack_rc_dispatch(rc, fd, 0, &out);
+    }
+    if (lean_array_size(out) > 0) {
+        timeout_ms = 0;
+    }
+#ifdef __linux__
+    if (rc->epfd >= 0) {
+        struct epoll_event evs[JACK_RC_MAX_EVENTS];
+        int n = epoll_wait(rc->epfd, evs, JACK_RC_MAX_EVENTS, timeout_ms);
+        if (n < 0) {
+            int err = errno;
+            if (err == EINTR) return lean_io_result_mk_ok(out);
+            lean_dec(out);
+            return jack_io_error_from_errno(err);
+        }
+        for (int i = 0; i < n; i++) {
+            int fd = evs[i].data.fd;
+            if (fd == rc->wake_rd) {
+                jack_rc_drain_wake(rc);
+                out = lean_array_push(out, lean_box_uint64(JACK_RC_WOKEN));
+            } else {
+                jack_rc_dispatch(rc, fd, jack_epoll_to_mask(evs[i].events), &out);
+            }
+        }
+        return lean_io_result_mk_ok(out);
+    }
+#endif
+    int count = 1;
+    for (int fd = 0; fd < rc->fdcap; fd++) {
+        if (rc->fds[fd].registered) count++;
+    }
+    if (count > rc->pcap) {
+        struct pollfd *pfds = realloc(rc->pfds, (size_t)count * sizeof(struct pollfd));
+        if (!pfds) {
+            lean_dec(out);
+            return jack_io_error_from_errno(ENOMEM);
+        }
+        rc->pfds = pfds;
+        rc->pcap = count;
+    }
+    rc->pfds[0].fd = rc->wake_rd;
+    rc->pfds[0].events = POLLIN;
+    rc->pfds[0].revents = 0;
+    int k = 1;
+    for (int fd = 0; fd < rc->fdcap; fd++) {
+        if (rc->fds[fd].registered) {
+            rc->pfds[k].fd = fd;
+            rc->pfds[k].events = jack_mask_to_poll(rc->fds[fd].registered);
+            rc->pfds[k].revents = 0;
+            k++;
+        }
+    }
+    int n = poll(rc->pfds, (nfds_t)count, timeout_ms);
+    if (n < 0) {
+        int err = errno;
+        if (err == EINTR) return lean_io_result_mk_ok(out);
+        lean_dec(out);
+        return jack_io_error_from_errno(err);
+    }
+    if (rc->pfds[0].revents) {
+        jack_rc_drain_wake(rc);
+        out = lean_array_push(out, lean_box_uint64(JACK_RC_WOKEN));
+    }
+    for (int i = 1; i < count && n > 0; i++) {
+        if (rc->pfds[i].revents) {
+            jack_rc_dispatch(rc, rc->pfds[i].fd, jack_poll_to_mask(rc->pfds[i].revents), &out);
+        }
+    }
+    return lean_io_result_mk_ok(out);
+}
+
+/* Interrupt a blocked `wait` (any thread) */
+LEAN_EXPORT lean_obj_res jack_reactor_core_wake(b_lean_obj_arg rc_obj, lean_obj_arg world) {
+    (void)world;
+    jack_rc_t *rc = jack_rc_unbox(rc_obj);
+#ifdef __linux__
+    if (rc->wake_wr == rc->wake_rd) {
+        uint64_t one = 1;
+        ssize_t w = write(rc->wake_wr, &one, sizeof(one));
+        (void)w;
+        return lean_io_result_mk_ok(lean_box(0));
+    }
+#endif
+    uint8_t byte = 1;
+    ssize_t w = write(rc->wake_wr, &byte, 1);
+    (void)w;
+    return lean_io_result_mk_ok(lean_box(0));
+}
+
+/* ========== RingBuffer ========== */
+
+/* Byte ring. On Linux the memfd backing store is mapped twice back-to-back, so
+ * any readable or writable span is contiguous in memory and recv/send work on a
+ * single pointer. Elsewhere (or if mapping fails) a plain buffer is used and
+ * wrapped spans are handled as two iovecs. `head`/`tail` are running totals of
+ * bytes consumed/produced; their difference is the readable length. */
+typedef struct {
+    uint8_t *base;
+    size_t cap;
+    uint64_t head;
+    uint64_t tail;
+    int double_mapped;
+} jack_ring_t;
+
+static lean_external_class *g_ring_class = NULL;
+
+static void jack_ring_finalizer(void *ptr) {
+    jack_ring_t *ring = (jack_ring_t *)ptr;
+    if (ring->base) {
+        if (ring->double_mapped) {
+            munmap(ring->base, ring->cap * 2);
+        } else {
+            free(ring->base);
+        }
+    }
+    free(ring);
+}
+
+static void jack_ring_foreach(void *ptr, b_lean_obj_arg f) {
+    /* No nested Lean objects */
+}
+
+static inline jack_ring_t *jack_ring_unbox(b_lean_obj_arg obj) {
+    return (jack_ring_t *)lean_get_external_data(obj);
+}
+
+static inline size_t jack_ring_readable(const jack_ring_t *ring) {
+    return (size_t)(ring->tail - ring->head);
+}
+
+static inline size_t jack_ring_free(const jack_ring_t *ring) {
+    return ring->cap - jack_ring_readable(ring);
+}
+
+#ifdef __linux__
+static uint8_t *jack_ring_map_twice(size_t cap) {
+    int fd = memfd_create("jack_ring", MFD_CLOEXEC);
+    if (fd < 0) {
+        return NULL;
+    }
+    if (ftruncate(fd, (off_t)cap) < 0) {
+        close(fd);
+        return NULL;
+    }
+    uint8_t *base = mmap(NULL, cap * 2, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (base == MAP_FAILED) {
+        close(fd);
+        return NULL;
+    }
+    if (mmap(base, cap, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_FIXED, fd, 0) == MAP_FAILED ||
+        mmap(base + cap, cap, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_FIXED, fd, 0) == MAP_FAILED) {
+        munmap(base, cap * 2);
+        close(fd);
+        return NULL;
+    }
+    /* The mappings keep the memfd alive */
+    close(fd);
+    return base;
+}
+#endif
+
+/* Split a span [pos, pos + len) of the ring into at most two iovecs */
+static int jack_ring_iov(const jack_ring_t *ring, uint64_t pos, size_t len, struct iovec iov[2]) {
+    size_t off = (size_t)(pos % ring->cap);
+    if (ring->double_mapped || off + len <= ring->cap) {
+        iov[0].iov_base = ring->base + off;
+        iov[0].iov_len = len;
+        return len > 0 ? 1 : 0;
+    }
+    iov[0].iov_base = ring->base + off;
+    iov[0].iov_len = ring->cap - off;
+    iov[1].iov_base = ring->base;
+    iov[1].iov_len = len - (ring->cap - off);
+    return 2;
+}
+
+/* Copy `len` readable bytes starting `skip` bytes past the head */
+static void jack_ring_copy_out(const jack_ring_t *ring, size_t skip, size_t len, uint8_t *dst) {
+    struct iovec iov[2];
+    int n = jack_ring_iov(ring, ring->head + skip, len, iov);
+    for (int i = 0; i < n; i++) {
+        memcpy(dst, iov[i].iov_base, iov[i].iov_len);
+        dst += iov[i].iov_len;
+    }
+}
+
+LEAN_EXPORT lean_obj_res jack_ring_create(uint32_t capacity, lean_obj_arg world) {
+    (void)world;
+    long page = sysconf(_SC_PAGESIZE);
+    if (page <= 0) page = 4096;
+    size_t cap = capacity == 0 ? (size_t)page : (size_t)capacity;
+    cap = (cap + (size_t)page - 1) / (size_t)page * (size_t)page;
+
+    jack_ring_t *ring = calloc(1, sizeof(jack_ring_t));
+    if (!ring) {
+        return lean_io_result_mk_error(lean_mk_io_user_error(
+            lean_mk_string("Failed to allocate ring buffer")));
+    }
+    ring->cap = cap;
+#ifdef __linux__
+    ring->base = jack_ring_map_twice(cap);
+    ring->double_mapped = ring->base != NULL;
+#endif
+    if (!ring->base) {
+        ring->base = malloc(cap);
+        if (!ring->base) {
+            free(ring);
+            return lean_io_result_mk_error(lean_mk_io_user_error(
+                lean_mk_string("Failed to allocate ring buffer")));
+        }
+    }
+    if (g_ring_class == NULL) {
+        g_ring_class = lean_register_external_class(jack_ring_finalizer, jack_ring_foreach);
+    }
+    return lean_io_result_mk_ok(lean_alloc_external(g_ring_class, ring));
+}
+
+LEAN_EXPORT lean_obj_res jack_ring_capacity(b_lean_obj_arg ring_obj, lean_obj_arg world) {
+    (void)world;
+    return lean_io_result_mk_ok(lean_box_uint32((uint32_t)jack_ring_unbox(ring_obj)->cap));
+}
+
+LEAN_EXPORT lean_obj_res jack_ring_readable_bytes(b_lean_obj_arg ring_obj, lean_obj_arg world) {
+    (void)world;
+    return lean_io_result_mk_ok(lean_box_uint32((uint32_t)jack_ring_readable(jack_ring_unbox(ring_obj))));
+}
+
+LEAN_EXPORT lean_obj_res jack_ring_writable_bytes(b_lean_obj_arg ring_obj, lean_obj_arg world) {
+    (void)world;
+    return lean_io_result_mk_ok(lean_box_uint32((uint32_t)jack_ring_free(jack_ring_unbox(ring_obj))));
+}
+
+LEAN_EXPORT lean_obj_res jack_ring_is_double_mapped(b_lean_obj_arg ring_obj, lean_obj_arg world) {
+    (void)world;
+    return lean_io_result_mk_ok(lean_box(jack_ring_unbox(ring_obj)->double_mapped ? 1 : 0));
+}
+
+/* Append bytes; returns how many fit */
+LEAN_EXPORT lean_obj_res jack_ring_write(
+    b_lean_obj_arg ring_obj,
+    b_lean_obj_arg data,
+    lean_obj_arg world
+) {
+    (void)world;
+    jack_ring_t *ring = jack_ring_unbox(ring_obj);
+    size_t len = lean_sarray_size(data);
+    size_t room = jack_ring_free(ring);
+    if (len > room) len = room;
+    struct iovec iov[2];
+    int n = jack_ring_iov(ring, ring->tail, len, iov);
+    const uint8_t *src = lean_sarray_cptr(data);
+    for (int i = 0; i < n; i++) {
+        memcpy(iov[i].iov_base, src, iov[i].iov_len);
+        src += iov[i].iov_len;
+    }
+    ring->tail += len;
+    return lean_io_result_mk_ok(lean_box_uint32((uint32_t)len));
+}
+
+/* Copy readable bytes [skip, skip + len) without consuming them */
+LEAN_EXPORT lean_obj_res jack_ring_peek(
+    b_lean_obj_arg ring_obj,
+    uint32_t skip,
+    uint32_t len,
+    lean_obj_arg world
+) {
+    (void)world;
+    jack_ring_t *ring = jack_ring_unbox(ring_obj);
+    size_t readable = jack_ring_readable(ring);
+    size_t start = skip > readable ? readable : skip;
+    size_t count = len > readable - start ? readable - start : len;
+    lean_obj_res arr = lean_alloc_sarray(1, count, count);
+    jack_ring_copy_out(ring, start, count, lean_sarray_cptr(arr));
+    return lean_io_result_mk_ok(arr);
+}
+
+/* Byte at readable offset `idx` */
+LEAN_EXPORT lean_obj_res jack_ring_byte_at(
+    b_lean_obj_arg ring_obj,
+    uint32_t idx,
+    lean_obj_arg world
+) {
+    (void)world;
+    jack_ring_t *ring = jack_ring_unbox(ring_obj);
+    if ((size_t)idx >= jack_ring_readable(ring)) {
+        return lean_io_result_mk_error(lean_mk_io_user_error(
+            lean_mk_string("Ring buffer index out of range")));
+    }
+    uint8_t b = ring->base[(size_t)((ring->head + idx) % ring->cap)];
+    return lean_io_result_mk_ok(lean_box(b));
+}
+
+/* Offset of the first occurrence of `pattern` in the readable bytes at or after `from` */
+LEAN_EXPORT lean_obj_res jack_ring_index_of(
+    b_lean_obj_arg ring_obj,
+    b_lean_obj_arg pattern,
+    uint32_t from,
+    lean_obj_arg world
+) {
+    (void)world;
+    jack_ring_t *ring = jack_ring_unbox(ring_obj);
+    size_t readable = jack_ring_readable(ring);
+    size_t plen = lean_sarray_size(pattern);
+    const uint8_t *pat = lean_sarray_cptr(pattern);
+    if ((size_t)from > readable || plen == 0 || plen > readable - from) {
+        return lean_io_result_mk_ok(lean_box(0)); /* Option.none */
+    }
+    size_t span = readable - from;
+    const uint8_t *hay;
+    uint8_t *tmp = NULL;
+    struct iovec iov[2];
+    if (jack_ring_iov(ring, ring->head + from, span, iov) == 1) {
+        hay = iov[0].iov_base;
+    } else {
+        /* Fallback buffer with a wrapped span: linearize once */
+        tmp = malloc(span);
+        if (!tmp) {
+            return lean_io_result_mk_error(lean_mk_io_user_error(
+                lean_mk_string("Failed to allocate scan buffer")));
+        }
+        jack_ring_copy_out(ring, from, span, tmp);
+        hay = tmp;
+    }
+    const uint8_t *hit = memmem(hay, span, pat, plen);
+    lean_obj_res result = lean_box(0);
+    if (hit) {
+        result = lean_alloc_ctor(1, 1, 0);
+        lean_ctor_set(result, 0, lean_box_uint32((uint32_t)(from + (size_t)(hit - hay))));
+    }
+    free(tmp);
+    return lean_io_result_mk_ok(result);
+}
+
+/* Drop `len` readable bytes */
+LEAN_EXPORT lean_obj_res jack_ring_consume(
+    b_lean_obj_arg ring_obj,
+    uint32_t len,
+    lean_obj_arg world
+) {
+    (void)world;
+    jack_ring_t *ring = jack_ring_unbox(ring_obj);
+    size_t readable = jack_ring_readable(ring);
+    ring->head += len > readable ? readable : len;
+    return lean_io_result_mk_ok(lean_box(0));
+}
+
+/* recv into the ring's free space (one contiguous span when double mapped,
+ * otherwise a two-segment recvmsg). Returns bytes received; 0 means EOF. */
+static lean_obj_res jack_ring_recv_impl(
+    b_lean_obj_arg sock_obj,
+    b_lean_obj_arg ring_obj,
+    uint32_t max_bytes,
+    int try_mode
+) {
+    jack_socket_t *sock = jack_socket_unbox(sock_obj);
+    jack_ring_t *ring = jack_ring_unbox(ring_obj);
+    size_t want = jack_ring_free(ring);
+    if (want > max_bytes) want = max_bytes;
+    if (want == 0) {
+        int err = ENOBUFS;
+        return try_mode ? lean_io_result_mk_ok(jack_socket_result_error(err))
+                        : jack_io_error_from_errno(err);
+    }
+
+    struct iovec iov[2];
+    struct msghdr msg;
+    memset(&msg, 0, sizeof(msg));
+    msg.msg_iov = iov;
+    msg.msg_iovlen = (size_t)jack_ring_iov(ring, ring->tail, want, iov);
+
+    ssize_t n;
+    do {
+        n = recvmsg(sock->fd, &msg, 0);
+    } while (n < 0 && errno == EINTR);
+    if (n < 0) {
+        int err = errno;
+        if (!try_mode) {
+            return jack_io_error_from_errno(err);
+        }
+        if (is_wouldblock_error(err)) {
+            return lean_io_result_mk_ok(jack_socket_result_wouldblock());
+        }
+        return lean_io_result_mk_ok(jack_socket_result_error(err));
+    }
+    ring->tail += (uint64_t)n;
+    lean_obj_res count = lean_box_uint32((uint32_t)n);
+    return try_mode ? lean_io_result_mk_ok(jack_socket_result_ok(count))
+                    : lean_io_result_mk_ok(count);
+}
+
+LEAN_EXPORT lean_obj_res jack_socket_recv_into_ring(
+    b_lean_obj_arg sock_obj,
+    b_lean_obj_arg ring_obj,
+    uint32_t max_bytes,
+    lean_obj_arg world
+) {
+    (void)world;
+    return jack_ring_recv_impl(sock_obj, ring_obj, max_bytes, 0);
+}
+
+LEAN_EXPORT lean_obj_res jack_socket_recv_into_ring_try(
+    b_lean_obj_arg sock_obj,
+    b_lean_obj_arg ring_obj,
+    uint32_t max_bytes,
+    lean_obj_arg world
+) {
+    (void)world;
+    return jack_ring_recv_impl(sock_obj, ring_obj, max_bytes, 1);
+}
+
+/* sendmsg from the ring's readable bytes, consuming what was sent */
+static lean_obj_res jack_ring_send_impl(
+    b_lean_obj_arg sock_obj,
+    b_lean_obj_arg ring_obj,
+    uint32_t max_bytes,
+    int try_mode
+) {
+    jack_socket_t *sock = jack_socket_unbox(sock_obj);
+    jack_ring_t *ring = jack_ring_unbox(ring_obj);
+    size_t want = jack_ring_readable(ring);
+    if (want > max_bytes) want = max_bytes;
+
+    struct iovec iov[2];
+    struct msghdr msg;
+    memset(&msg, 0, sizeof(msg));
+    msg.msg_iov = iov;
+    msg.msg_iovlen = (size_t)jack_ring_iov(ring, ring->head, want, iov);
+
+    ssize_t n = 0;
+    if (want > 0) {
+        do {
+#ifdef MSG_NOSIGNAL
+            n = sendmsg(sock->fd, &msg, MSG_NOSIGNAL);
+#else
+            n = sendmsg(sock->fd, &msg, 0);
+#endif
+        } while (n < 0 && errno == EINTR);
+    }
+    if (n < 0) {
+        int err = errno;
+        if (!try_mode) {
+            return jack_io_error_from_errno(err);
+        }
+        if (is_wouldblock_error(err)) {
+            return lean_io_result_mk_ok(jack_socket_result_wouldblock());
+        }
+        return lean_io_result_mk_ok(jack_socket_result_error(err));
+    }
+    ring->head += (uint64_t)n;
+    lean_obj_res count = lean_box_uint32((uint32_t)n);
+    return try_mode ? lean_io_result_mk_ok(jack_socket_result_ok(count))
+                    : lean_io_result_mk_ok(count);
+}
+
+LEAN_EXPORT lean_obj_res jack_socket_send_from_ring(
+    b_lean_obj_arg sock_obj,
+    b_lean_obj_arg ring_obj,
+    uint32_t max_bytes,
+    lean_obj_arg world
+) {
+    (void)world;
+    return jack_ring_send_impl(sock_obj, ring_obj, max_bytes, 0);
+}
+
+LEAN_EXPORT lean_obj_res jack_socket_send_from_ring_try(
+    b_lean_obj_arg sock_obj,
+    b_lean_obj_arg ring_obj,
+    uint32_t max_bytes,
+    lean_obj_arg world
+) {
+    (void)world;
+    return jack_ring_send_impl(sock_obj, ring_obj, max_bytes, 1);
+}
+
+/* ========== Shared-memory Channel ========== */
+
+/* A shared region holding two single-producer/single-consumer byte rings, one per
+ * direction. Layout: region header, two ring headers, then the two data areas.
+ * `head`/`tail` are running totals of bytes consumed/produced and live on separate
+ * cache lines; the producer publishes with a release store of `tail` and the
+ * consumer with a release store of `head`. The `*_waiting` flags tell the other
+ * side that a wakeup is needed; the wakeup itself travels over the Unix socket. */
+#define JACK_SHM_MAGIC 0x4d48534aU /* "JSHM" */
+#define JACK_SHM_VERSION 1U
+#define JACK_SHM_DATA_OFFSET 512
+
+typedef struct {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t ring_cap;
+    uint32_t reserved;
+    uint8_t pad[48];
+} jack_shm_header_t;
+
+typedef struct {
+    _Atomic uint64_t head;
+    uint8_t pad0[56];
+    _Atomic uint64_t tail;
+    uint8_t pad1[56];
+    _Atomic uint32_t reader_waiting;
+    _Atomic uint32_t writer_waiting;
+    uint8_t pad2[56];
+} jack_shm_ring_header_t;
+
+typedef struct {
+    uint8_t *base;
+    size_t len;
+    size_t cap;
+    int fd;
+    int corrupt;  /* the peer broke a ring invariant; every later access fails */
+} jack_shm_t;
+
+static lean_external_class *g_shm_class = NULL;
+
+static void jack_shm_finalizer(void *ptr) {
+    jack_shm_t *shm = (jack_shm_t *)ptr;
+    if (shm->base) {
+        munmap(shm->base, shm->len);
+    }
+    if (shm->fd >= 0) {
+        close(shm->fd);
+    }
+    free(shm);
+}
+
+static void jack_shm_foreach(void *ptr, b_lean_obj_arg f) {
+    /* No nested Lean objects */
+}
+
+static inline jack_shm_t *jack_shm_unbox(b_lean_obj_arg obj) {
+    return (jack_shm_t *)lean_get_external_data(obj);
+}
+
+static inline jack_shm_ring_header_t *jack_shm_ring_hdr(const jack_shm_t *shm, uint32_t ring) {
+    return (jack_shm_ring_header_t *)(shm->base + sizeof(jack_shm_header_t) +
+        (size_t)(ring & 1) * sizeof(jack_shm_ring_header_t));
+}
+
+static inline uint8_t *jack_shm_ring_data(const jack_shm_t *shm, uint32_t ring) {
+    return shm->base + JACK_SHM_DATA_OFFSET + (size_t)(ring & 1) * shm->cap;
+}
+
+static lean_obj_res jack_shm_box(jack_shm_t *shm) {
+    if (g_shm_class == NULL) {
+        g_shm_class = lean_register_external_class(jack_shm_finalizer, jack_shm_foreach);
+    }
+    return lean_io_result_mk_ok(lean_alloc_external(g_shm_class, shm));
+}
+
+/* Copy into the ring at running position `pos`, wrapping at the end of the data area */
+static void jack_shm_copy_in(const jack_shm_t *shm, uint32_t ring, uint64_t pos, const uint8_t *src, size_t len) {
+    uint8_t *data = jack_shm_ring_data(shm, ring);
+    size_t off = (size_t)(pos % shm->cap);
+    size_t first = len < shm->cap - off ? len : shm->cap - off;
+    memcpy(data + off, src, first);
+    if (len > first) {
+        memcpy(data, src + first, len - first);
+    }
+}
+
+static void jack_shm_copy_out(const jack_shm_t *shm, uint32_t ring, uint64_t pos, uint8_t *dst, size_t len) {
+    const uint8_t *data = jack_shm_ring_data(shm, ring);
+    size_t off = (size_t)(pos % shm->cap);
+    size_t first = len < shm->cap - off ? len : shm->cap - off;
+    memcpy(dst, data + off, first);
+    if (len > first) {
+        memcpy(dst + first, data, len - first);
+    }
+}
+
+/* `head` and `tail` are written by the peer process and must not be trusted: a span
+ * longer than the ring would send copies past the data area. Fails the channel. */
+static int jack_shm_check_span(jack_shm_t *shm, uint64_t head, uint64_t tail) {
+    if (shm->corrupt || tail - head > shm->cap) {
+        shm->corrupt = 1;
+        return -1;
+    }
+    return 0;
+}
+
+static lean_obj_res jack_shm_corrupt_error(void) {
+    return lean_io_result_mk_error(lean_mk_io_user_error(
+        lean_mk_string("Corrupt shared ring")));
+}
+
+LEAN_EXPORT lean_obj_res jack_shm_create(uint32_t ring_capacity, lean_obj_arg world) {
+    (void)world;
+#ifdef __linux__
+    size_t cap = ring_capacity < 4096 ? 4096 : (size_t)ring_capacity;
+    cap = (cap + 63) & ~(size_t)63;
+    size_t len = JACK_SHM_DATA_OFFSET + 2 * cap;
+
+    int fd = memfd_create("jack_shm", MFD_CLOEXEC);
+    if (fd < 0) {
+        return jack_io_error_from_errno(errno);
+    }
+    if (ftruncate(fd, (off_t)len) < 0) {
+        int err = errno;
+        close(fd);
+        return jack_io_error_from_errno(err);
+    }
+    uint8_t *base = mmap(NULL, len, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (base == MAP_FAILED) {
+        int err = errno;
+        close(fd);
+        return jack_io_error_from_errno(err);
+    }
+
+    jack_shm_t *shm = malloc(sizeof(jack_shm_t));
+    if (!shm) {
+        munmap(base, len);
+        close(fd);
+        return lean_io_result_mk_error(lean_mk_io_user_error(
+            lean_mk_string("Failed to allocate shared region")));
+    }
+    shm->base = base;
+    shm->len = len;
+    shm->cap = cap;
+    shm->fd = fd;
+    shm->corrupt = 0;
+
+    /* ftruncate zero-fills, so ring positions and flags start at 0 */
+    jack_shm_header_t *hdr = (jack_shm_header_t *)base;
+    hdr->version = JACK_SHM_VERSION;
+    hdr->ring_cap = (uint32_t)cap;
+    hdr->magic = JACK_SHM_MAGIC;
+    return jack_shm_box(shm);
+#else
+    return lean_io_result_mk_error(lean_mk_io_user_error(
+        lean_mk_string("Operation not supported")));
+#endif
+}
+
+LEAN_EXPORT lean_obj_res jack_shm_attach(uint32_t fd_arg, lean_obj_arg world) {
+    (void)world;
+    int fd = (int)fd_arg;
+    struct stat st;
+    if (fstat(fd, &st) < 0) {
+        int err = errno;
+        close(fd);
+        return jack_io_error_from_errno(err);
+    }
+    size_t len = (size_t)st.st_size;
+    if (len < JACK_SHM_DATA_OFFSET) {
+        close(fd);
+        return lean_io_result_mk_error(lean_mk_io_user_error(
+            lean_mk_string("Invalid shared region")));
+    }
+    uint8_t *base = mmap(NULL, len, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (base == MAP_FAILED) {
+        int err = errno;
+        close(fd);
+        return jack_io_error_from_errno(err);
+    }
+    /* The mapping keeps the memfd alive */
+    close(fd);
+
+    jack_shm_header_t *hdr = (jack_shm_header_t *)base;
+    size_t cap = hdr->ring_cap;
+    if (hdr->magic != JACK_SHM_MAGIC || hdr->version != JACK_SHM_VERSION ||
+        cap == 0 || JACK_SHM_DATA_OFFSET + 2 * cap > len) {
+        munmap(base, len);
+        return lean_io_result_mk_error(lean_mk_io_user_error(
+            lean_mk_string("Invalid shared region")));
+    }
+
+    jack_shm_t *shm = malloc(sizeof(jack_shm_t));
+    if (!shm) {
+        munmap(base, len);
+        return lean_io_result_mk_error(lean_mk_io_user_error(
+            lean_mk_string("Failed to allocate shared region")));
+    }
+    shm->base = base;
+    shm->len = len;
+    shm->cap = cap;
+    shm->fd = -1;
+    shm->corrupt = 0;
+    return jack_shm_box(shm);
+}
+
+LEAN_EXPORT lean_obj_res jack_shm_fd(b_lean_obj_arg shm_obj, lean_obj_arg world) {
+    (void)world;
+    jack_shm_t *shm = jack_shm_unbox(shm_obj);
+    if (shm->fd < 0) {
+        return lean_io_result_mk_error(lean_mk_io_user_error(
+            lean_mk_string("Shared region has no descriptor")));
+    }
+    return lean_io_result_mk_ok(lean_box_uint32((uint32_t)shm->fd));
+}
+
+LEAN_EXPORT lean_obj_res jack_shm_release_fd(b_lean_obj_arg shm_obj, lean_obj_arg world) {
+    (void)world;
+    jack_shm_t *shm = jack_shm_unbox(shm_obj);
+    if (shm->fd >= 0) {
+        close(shm->fd);
+        shm->fd = -1;
+    }
+    return lean_io_result_mk_ok(lean_box(0));
+}
+
+LEAN_EXPORT lean_obj_res jack_shm_capacity(b_lean_obj_arg shm_obj, lean_obj_arg world) {
+    (void)world;
+    return lean_io_result_mk_ok(lean_box_uint32((uint32_t)jack_shm_unbox(shm_obj)->cap));
+}
+
+LEAN_EXPORT lean_obj_res jack_shm_readable(b_lean_obj_arg shm_obj, uint32_t ring, lean_obj_arg world) {
+    (void)world;
+    jack_shm_t *shm = jack_shm_unbox(shm_obj);
+    jack_shm_ring_header_t *rh = jack_shm_ring_hdr(shm, ring);
+    uint64_t tail = atomic_load_explicit(&rh->tail, memory_order_seq_cst);
+    uint64_t head = atomic_load_explicit(&rh->head, memory_order_seq_cst);
+    if (jack_shm_check_span(shm, head, tail) < 0) {
+        return jack_shm_corrupt_error();
+    }
+    return lean_io_result_mk_ok(lean_box_uint32((uint32_t)(tail - head)));
+}
+
+LEAN_EXPORT lean_obj_res jack_shm_writable(b_lean_obj_arg shm_obj, uint32_t ring, lean_obj_arg world) {
+    (void)world;
+    jack_shm_t *shm = jack_shm_unbox(shm_obj);
+    jack_shm_ring_header_t *rh = jack_shm_ring_hdr(shm, ring);
+    uint64_t head = atomic_load_explicit(&rh->head, memory_order_seq_cst);
+    uint64_t tail = atomic_load_explicit(&rh->tail, memory_order_seq_cst);
+    if (jack_shm_check_span(shm, head, tail) < 0) {
+        return jack_shm_corrupt_error();
+    }
+    return lean_io_result_mk_ok(lean_box_uint32((uint32_t)(shm->cap - (tail - head))));
+}
+
+/* Producer side: write a u32 length prefix and the payload, all or nothing.
+ * Returns false when the ring lacks room (backpressure). */
+LEAN_EXPORT lean_obj_res jack_shm_write_message(
+    b_lean_obj_arg shm_obj,
+    uint32_t ring,
+    b_lean_obj_arg data,
+    lean_obj_arg world
+) {
+    (void)world;
+    jack_shm_t *shm = jack_shm_unbox(shm_obj);
+    jack_shm_ring_header_t *rh = jack_shm_ring_hdr(shm, ring);
+    size_t len = lean_sarray_size(data);
+    if (len + 4 > shm->cap) {
+        return lean_io_result_mk_error(lean_mk_io_user_error(
+            lean_mk_string("Message larger than shared ring")));
+    }
+    uint64_t tail = atomic_load_explicit(&rh->tail, memory_order_relaxed);
+    uint64_t head = atomic_load_explicit(&rh->head, memory_order_acquire);
+    if (jack_shm_check_span(shm, head, tail) < 0) {
+        return jack_shm_corrupt_error();
+    }
+    if (shm->cap - (size_t)(tail - head) < len + 4) {
+        return lean_io_result_mk_ok(lean_box(0));
+    }
+    uint32_t prefix = (uint32_t)len;
+    jack_shm_copy_in(shm, ring, tail, (const uint8_t *)&prefix, 4);
+    jack_shm_copy_in(shm, ring, tail + 4, lean_sarray_cptr(data), len);
+    atomic_store_explicit(&rh->tail, tail + 4 + len, memory_order_release);
+    return lean_io_result_mk_ok(lean_box(1));
+}
+
+/* Producer side: write as much of data[offset..] as fits; returns bytes written */
+LEAN_EXPORT lean_obj_res jack_shm_write_stream(
+    b_lean_obj_arg shm_obj,
+    uint32_t ring,
+    b_lean_obj_arg data,
+    uint32_t offset,
+    lean_obj_arg world
+) {
+    (void)world;
+    jack_shm_t *shm = jack_shm_unbox(shm_obj);
+    jack_shm_ring_header_t *rh = jack_shm_ring_hdr(shm, ring);
+    size_t size = lean_sarray_size(data);
+    size_t start = offset < size ? (size_t)offset : size;
+    uint64_t tail = atomic_load_explicit(&rh->tail, memory_order_relaxed);
+    uint64_t head = atomic_load_explicit(&rh->head, memory_order_acquire);
+    if (jack_shm_check_span(shm, head, tail) < 0) {
+        return jack_shm_corrupt_error();
+    }
+    size_t room = shm->cap - (size_t)(tail - head);
+    size_t n = size - start < room ? size - start : room;
+    if (n > 0) {
+        jack_shm_copy_in(shm, ring, tail, lean_sarray_cptr(data) + start, n);
+        atomic_store_explicit(&rh->tail, tail + n, memory_order_release);
+    }
+    return lean_io_result_mk_ok(lean_box_uint32((uint32_t)n));
+}
+
+/* Consumer side: pop one length-prefixed message, or none if the ring is empty */
+LEAN_EXPORT lean_obj_res jack_shm_read_message(b_lean_obj_arg shm_obj, uint32_t ring, lean_obj_arg world) {
+    (void)world;
+    jack_shm_t *shm = jack_shm_unbox(shm_obj);
+    jack_shm_ring_header_t *rh = jack_shm_ring_hdr(shm, ring);
+    uint64_t head = atomic_load_explicit(&rh->head, memory_order_relaxed);
+    uint64_t tail = atomic_load_explicit(&rh->tail, memory_order_acquire);
+    if (jack_shm_check_span(shm, head, tail) < 0) {
+        return jack_shm_corrupt_error();
+    }
+    if (tail - head < 4) {
+        return lean_io_result_mk_ok(lean_box(0));
+    }
+    uint32_t len;
+    jack_shm_copy_out(shm, ring, head, (uint8_t *)&len, 4);
+    if ((uint64_t)len + 4 > tail - head) {
+        shm->corrupt = 1;
+        return jack_shm_corrupt_error();
+    }
+    lean_obj_res arr = lean_alloc_sarray(1, len, len);
+    jack_shm_copy_out(shm, ring, head + 4, lean_sarray_cptr(arr), len);
+    atomic_store_explicit(&rh->head, head + 4 + len, memory_order_release);
+
+    lean_obj_res some = lean_alloc_ctor(1, 1, 0);
+    lean_ctor_set(some, 0, arr);
+    return lean_io_result_mk_ok(some);
+}
+
+/* Consumer side: copy out and consume up to `max_bytes` (empty if nothing is readable) */
+LEAN_EXPORT lean_obj_res jack_shm_read_stream(
+    b_lean_obj_arg shm_obj,
+    uint32_t ring,
+    uint32_t max_bytes,
+    lean_obj_arg world
+) {
+    (void)world;
+    jack_shm_t *shm = jack_shm_unbox(shm_obj);
+    jack_shm_ring_header_t *rh = jack_shm_ring_hdr(shm, ring);
+    uint64_t head = atomic_load_explicit(&rh->head, memory_order_relaxed);
+    uint64_t tail = atomic_load_explicit(&rh->tail, memory_order_acquire);
+    if (jack_shm_check_span(shm, head, tail) < 0) {
+        return jack_shm_corrupt_error();
+    }
+    size_t avail = (size_t)(tail - head);
+    size_t n = avail < max_bytes ? avail : (size_t)max_bytes;
+    lean_obj_res arr = lean_alloc_sarray(1, n, n);
+    if (n > 0) {
+        jack_shm_copy_out(shm, ring, head, lean_sarray_cptr(arr), n);
+        atomic_store_explicit(&rh->head, head + n, memory_order_release);
+    }
+    return lean_io_result_mk_ok(arr);
+}
+
+/* Announce that the reader (side 0) or writer (side 1) of `ring` is about to sleep */
+LEAN_EXPORT lean_obj_res jack_shm_set_waiting(
+    b_lean_obj_arg shm_obj,
+    uint32_t ring,
+    uint32_t side,
+    uint8_t waiting,
+    lean_obj_arg world
+) {
+    (void)world;
+    jack_shm_ring_header_t *rh = jack_shm_ring_hdr(jack_shm_unbox(shm_obj), ring);
+    _Atomic uint32_t *flag = side == 0 ? &rh->reader_waiting : &rh->writer_waiting;
+    atomic_store_explicit(flag, waiting ? 1U : 0U, memory_order_seq_cst);
+    return lean_io_result_mk_ok(lean_box(0));
+}
+
+/* Clear the reader/writer waiting flag of `ring`, returning whether it was set.
+ * The fence orders the preceding head/tail publish before the flag check, pairing
+ * with the sleeper's flag store followed by its re-check of the ring. */
+LEAN_EXPORT lean_obj_res jack_shm_take_waiting(
+    b_lean_obj_arg shm_obj,
+    uint32_t ring,
+    uint32_t side,
+    lean_obj_arg world
+) {
+    (void)world;
+    jack_shm_ring_header_t *rh = jack_shm_ring_hdr(jack_shm_unbox(shm_obj), ring);
+    _Atomic uint32_t *flag = side == 0 ? &rh->reader_waiting : &rh->writer_waiting;
+    atomic_thread_fence(memory_order_seq_cst);
+    if (atomic_load_explicit(flag, memory_order_relaxed) == 0) {
+        return lean_io_result_mk_ok(lean_box(0));
+    }
+    uint32_t was = atomic_exchange_explicit(flag, 0U, memory_order_seq_cst);
+    return lean_io_result_mk_ok(lean_box(was != 0 ? 1 : 0));
 }
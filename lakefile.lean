@@ -26,6 +26,12 @@ lean_lib Jack where
 lean_lib Tests where
   roots := #[`Tests]
 
+lean_lib Loadgen where
+  roots := #[`Loadgen.Histogram, `Loadgen.Runner]
+
+lean_exe jack_loadgen where
+  root := `Loadgen.Main
+
 @[test_driver]
 lean_exe jack_tests where
   root := `Tests.Main